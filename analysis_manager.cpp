@@ -0,0 +1,42 @@
+#include "analysis_manager.h"
+
+const CFG& AnalysisManager::cfg() {
+    if (!cachedCFG) cachedCFG.emplace(CFG::build(*function));
+    return *cachedCFG;
+}
+
+const Dominators& AnalysisManager::dominators() {
+    if (!cachedDominators) cachedDominators.emplace(Dominators::compute(cfg()));
+    return *cachedDominators;
+}
+
+const LoopForest& AnalysisManager::loops() {
+    if (!cachedLoops) cachedLoops.emplace(LoopForest::build(cfg(), dominators()));
+    return *cachedLoops;
+}
+
+const LocationIndex& AnalysisManager::locations() {
+    // Only depends on the number of pseudos.
+    if (cachedLocations && cachedLocations->size() != LocationIndex(*function).size()) {
+        cachedLocations.reset();
+        cachedLiveness.reset();
+    }
+    if (!cachedLocations) cachedLocations.emplace(*function);
+    return *cachedLocations;
+}
+
+const Liveness& AnalysisManager::liveness() {
+    const LocationIndex& index = locations();
+    if (!cachedLiveness) cachedLiveness.emplace(Liveness::compute(*function, cfg(), index));
+    return *cachedLiveness;
+}
+
+void AnalysisManager::invalidate(PreservedAnalyses preserved) {
+    // Liveness refers to the cached CFG, so it cannot outlive it.
+    if (!preserved.liveness || !preserved.controlFlow) cachedLiveness.reset();
+    if (!preserved.controlFlow) {
+        cachedLoops.reset();
+        cachedDominators.reset();
+        cachedCFG.reset();
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef COMPILER_ANALYSIS_MANAGER_H
+#define COMPILER_ANALYSIS_MANAGER_H
+
+#include <optional>
+#include "cfg.h"
+#include "ir.h"
+#include "ir_utils.h"
+#include "liveness.h"
+#include "loops.h"
+#include "remarks.h"
+
+// Analyses a pass leaves valid when it changes the function. A pass that
+// reports no change preserves everything.
+struct PreservedAnalyses {
+    // Blocks, instruction indices and edges: the CFG, dominators and loops.
+    bool controlFlow = false;
+    // Liveness, which also needs the control flow.
+    bool liveness = false;
+
+    static PreservedAnalyses none() { return {}; }
+    static PreservedAnalyses all() { return {true, true}; }
+    // Instructions changed in place, deleted ones left as IRNop, and no
+    // jump or label touched.
+    static PreservedAnalyses controlFlowOnly() { return {true, false}; }
+};
+
+// Analyses of one function, each computed on first request and kept until
+// invalidated. References returned stay valid until then. A pass that asks
+// for an analysis again after changing the function must first invalidate
+// what the change broke.
+//
+// It also hands passes the log to report statistics and remarks to, which
+// is never invalidated. Without one from the caller that log is disabled.
+class AnalysisManager {
+public:
+    explicit AnalysisManager(const IRFunction& fn, OptimizationRemarks* remarks = nullptr)
+        : function(&fn), log(remarks ? remarks : &disabled) {}
+
+    const CFG& cfg();
+    const Dominators& dominators();
+    const LoopForest& loops();
+    const LocationIndex& locations();
+    const Liveness& liveness();
+    OptimizationRemarks& remarks() { return *log; }
+
+    void invalidate(PreservedAnalyses preserved = PreservedAnalyses::none());
+
+private:
+    const IRFunction* function;
+    std::optional<CFG> cachedCFG;
+    std::optional<Dominators> cachedDominators;
+    std::optional<LoopForest> cachedLoops;
+    std::optional<LocationIndex> cachedLocations;
+    std::optional<Liveness> cachedLiveness;
+    OptimizationRemarks disabled{false};
+    OptimizationRemarks* log;
+};
+
+#endif // COMPILER_ANALYSIS_MANAGER_H
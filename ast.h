@@ -44,12 +44,14 @@ enum class TokenType {
     CLOSE_BRACE,
     QUESTION,
     COLON,
-    SEMICOLON
+    SEMICOLON,
+    PRAGMA_UNROLL // `#pragma unroll [N]`; value holds N or is empty
 };
 
 struct Token {
     TokenType type;
     std::string value;
+    int line = 0; // 1-based source line
 };
 
 // ========================
@@ -223,6 +225,8 @@ struct WhileStatement : public Statement {
     std::unique_ptr<Exp> condition;
     std::unique_ptr<Statement> body;
     std::string label;
+    int unroll = 0; // from #pragma unroll: 0 none, -1 without a count, else the factor
+    int line = 0;   // source line of the loop keyword
     WhileStatement(std::unique_ptr<Exp> c,
                    std::unique_ptr<Statement> b,
                    std::string l = "")
@@ -235,6 +239,8 @@ struct DoWhileStatement : public Statement {
     std::unique_ptr<Statement> body;
     std::unique_ptr<Exp> condition;
     std::string label;
+    int unroll = 0; // from #pragma unroll: 0 none, -1 without a count, else the factor
+    int line = 0;   // source line of the loop keyword
     DoWhileStatement(std::unique_ptr<Statement> b,
                      std::unique_ptr<Exp> c,
                      std::string l = "")
@@ -263,6 +269,8 @@ struct ForStatement : public Statement {
     std::unique_ptr<Exp> post;      // nullptr means no post-expression
     std::unique_ptr<Statement> body;
     std::string label;
+    int unroll = 0; // from #pragma unroll: 0 none, -1 without a count, else the factor
+    int line = 0;   // source line of the loop keyword
     ForStatement(std::unique_ptr<ForInit> i,
                  std::unique_ptr<Exp> c,
                  std::unique_ptr<Exp> p,
@@ -0,0 +1,16 @@
+int main(void) {
+    int acc = 0;
+    int seed = 12345;
+    for (int i = 0; i < 100000; i = i + 1) {
+        seed = (seed * 1103 + 12345) % 65536;
+        int small = seed < 32768;
+        int odd = seed % 2 == 1;
+        if (small && odd)
+            acc = acc + 3;
+        else if (small || odd)
+            acc = acc - 1;
+        else
+            acc = !acc ? 5 : acc;
+    }
+    return acc % 256;
+}
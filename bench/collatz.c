@@ -0,0 +1,17 @@
+int main(void) {
+    int longest = 0;
+    for (int n = 1; n < 3000; n = n + 1) {
+        int x = n;
+        int steps = 0;
+        while (x != 1) {
+            if (x % 2 == 0)
+                x = x / 2;
+            else
+                x = 3 * x + 1;
+            steps = steps + 1;
+        }
+        if (steps > longest)
+            longest = steps;
+    }
+    return longest % 256;
+}
@@ -0,0 +1,144 @@
+// Times the optimization presets, and every pass on its own, on synthetic
+// functions shaped like lowered code, doubling the size each step up to
+// 10M instructions, to check that compile time grows linearly. Not part of
+// the test suite:
+//
+//   cmake --build <dir> --target compile_time_bench && <dir>/compile_time_bench [max-instructions]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+#include "ir.h"
+#include "optimizer.h"
+
+namespace {
+constexpr int kVariables = 50;
+
+// Lowers a random mix of the statements generated code is made of: an
+// if/else, a counted loop, a loop around a division and a straight-line
+// expression, all over kVariables variables that live across the function.
+IRFunction makeFunction(size_t instructions) {
+    IRFunction fn("main", {});
+    std::vector<IROperand> variables;
+    for (int v = 0; v < kVariables; ++v) {
+        variables.push_back(fn.addPseudo("v" + std::to_string(v)));
+        fn.body.push_back(IRMov(IROperand::imm(v), variables.back()));
+    }
+    std::uint32_t seed = 12345;
+    auto random = [&](std::uint32_t bound) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 8) % bound;
+    };
+    auto variable = [&] { return variables[random(kVariables)]; };
+    auto temp = [&] { return fn.addPseudo("tmp"); };
+    // `dst op= src` through a temporary, as lowering emits it.
+    auto binary = [&](IRBinaryOperator op, IROperand src, IROperand dst) {
+        IROperand t = temp();
+        fn.body.push_back(IRMov(dst, t));
+        fn.body.push_back(IRBinary(op, src, t));
+        return t;
+    };
+    // Jumps to `target` when `a cond b` does not hold.
+    auto test = [&](IRCondCode cond, IROperand a, IROperand b, IRCondCode jump, int target) {
+        IROperand flag = temp();
+        fn.body.push_back(IRCmp(b, a));
+        fn.body.push_back(IRMov(IROperand::imm(0), flag));
+        fn.body.push_back(IRSetCC(cond, flag));
+        fn.body.push_back(IRCmp(IROperand::imm(0), flag));
+        fn.body.push_back(IRJumpCC(jump, target));
+    };
+
+    while (fn.body.size() < instructions) {
+        IROperand a = variable();
+        IROperand b = variable();
+        IROperand c = variable();
+        switch (random(8)) {
+            case 0: { // if (a < b) c = a + 1; else c = b * 3;
+                int elseLabel = fn.addLabel();
+                int joinLabel = fn.addLabel();
+                test(IRCondCode::L, a, b, IRCondCode::E, elseLabel);
+                fn.body.push_back(IRMov(binary(IRBinaryOperator::Add, IROperand::imm(1), a), c));
+                fn.body.push_back(IRJump(joinLabel));
+                fn.body.push_back(IRLabel(elseLabel));
+                fn.body.push_back(IRMov(binary(IRBinaryOperator::Mul, IROperand::imm(3), b), c));
+                fn.body.push_back(IRLabel(joinLabel));
+                break;
+            }
+            case 1: { // for (int i = 0; i < 10; i = i + 1) c = c + (a + b) * i;
+                IROperand i = fn.addPseudo("i");
+                int bodyLabel = fn.addLabel();
+                int exitLabel = fn.addLabel();
+                fn.body.push_back(IRMov(IROperand::imm(0), i));
+                test(IRCondCode::L, i, IROperand::imm(10), IRCondCode::E, exitLabel);
+                fn.body.push_back(IRLabel(bodyLabel));
+                IROperand product = binary(IRBinaryOperator::Mul, i, binary(IRBinaryOperator::Add, b, a));
+                fn.body.push_back(IRMov(binary(IRBinaryOperator::Add, product, c), c));
+                fn.body.push_back(IRMov(binary(IRBinaryOperator::Add, IROperand::imm(1), i), i));
+                test(IRCondCode::L, i, IROperand::imm(10), IRCondCode::NE, bodyLabel);
+                fn.body.push_back(IRLabel(exitLabel));
+                break;
+            }
+            case 2: { // while (a > 1000) a = a / 2;
+                int bodyLabel = fn.addLabel();
+                int exitLabel = fn.addLabel();
+                test(IRCondCode::G, a, IROperand::imm(1000), IRCondCode::E, exitLabel);
+                fn.body.push_back(IRLabel(bodyLabel));
+                fn.body.push_back(IRMov(a, IROperand::reg(IRRegister::AX)));
+                fn.body.push_back(IRCdq());
+                fn.body.push_back(IRIdiv(IROperand::imm(2)));
+                IROperand quotient = temp();
+                fn.body.push_back(IRMov(IROperand::reg(IRRegister::AX), quotient));
+                fn.body.push_back(IRMov(quotient, a));
+                test(IRCondCode::G, a, IROperand::imm(1000), IRCondCode::NE, bodyLabel);
+                fn.body.push_back(IRLabel(exitLabel));
+                break;
+            }
+            default: { // c = (a + b) * k - c;
+                IROperand sum = binary(IRBinaryOperator::Add, b, a);
+                IROperand product = binary(IRBinaryOperator::Mul, IROperand::imm(static_cast<int>(random(5)) + 1), sum);
+                fn.body.push_back(IRMov(binary(IRBinaryOperator::Sub, c, product), c));
+                break;
+            }
+        }
+    }
+    IROperand sum = variables[0];
+    for (int v = 1; v < kVariables; ++v) sum = binary(IRBinaryOperator::Add, variables[v], sum);
+    fn.body.push_back(IRMov(sum, IROperand::reg(IRRegister::AX)));
+    fn.body.push_back(IRRet());
+    return fn;
+}
+
+double seconds(const std::function<void()>& work) {
+    auto start = std::chrono::steady_clock::now();
+    work();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double optimize(const IRFunction& fn, const std::string& passes) {
+    IRProgram program(std::make_unique<IRFunction>(fn));
+    return seconds([&] { Optimizer::optimize(program, passes); });
+}
+}
+
+int main(int argc, char** argv) {
+    size_t limit = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+    const char* passes[] = {"unreachable", "sccp", "value-numbering", "local-value-numbering", "licm", "scev",
+                            "induction-variables", "copy-propagation", "sparse-copy-propagation", "dead-code", "unused-definitions", "unswitch", "unroll",
+                            "graph-coloring", "linear-scan"};
+    std::printf("%10s %8s", "instrs", "pseudos");
+    for (const char* pass : passes) std::printf(" %9.9s", pass);
+    std::printf(" %9s %9s %9s  (us per instruction)\n", "-O0", "-O1", "-O2");
+    for (size_t size = 78'125; size <= limit; size *= 2) {
+        IRFunction fn = makeFunction(size);
+        double n = static_cast<double>(fn.body.size());
+        std::printf("%10zu %8zu", fn.body.size(), fn.pseudos.size());
+        for (const char* pass : passes) std::printf(" %9.2f", optimize(fn, pass) * 1e6 / n);
+        for (int level = 0; level <= 2; ++level) std::printf(" %9.2f", optimize(fn, Optimizer::pipeline(level)) * 1e6 / n);
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Times the dataflow clients on synthetic functions of up to 50k blocks and
+// 200k pseudos, doubling the size each step, to check that the solver
+// scales linearly. Not part of the test suite:
+//
+//   cmake --build <dir> --target dataflow_bench && <dir>/dataflow_bench
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include "cfg.h"
+#include "copy_propagation.h"
+#include "ir.h"
+#include "ir_utils.h"
+#include "liveness.h"
+
+namespace {
+constexpr int kVariables = 2000;
+constexpr int kTempsPerBlock = 4;
+
+// Repeats an if/else followed by a single-block loop, four blocks in all.
+// Each block chains fresh temporaries through a few of kVariables variables
+// that live across blocks, the way lowering uses temporaries.
+IRFunction makeFunction(int blocks) {
+    IRFunction fn("main", {});
+    for (int v = 0; v < kVariables; ++v) fn.addPseudo("v" + std::to_string(v));
+    std::uint32_t seed = 12345;
+    auto variable = [&] {
+        seed = seed * 1103515245 + 12345;
+        return IROperand::pseudo(static_cast<int>((seed >> 8) % kVariables));
+    };
+    auto chain = [&] {
+        IROperand temp = fn.addPseudo("t");
+        fn.body.push_back(IRMov(variable(), temp));
+        for (int k = 1; k < kTempsPerBlock; ++k) {
+            IROperand next = fn.addPseudo("t");
+            fn.body.push_back(IRMov(temp, next));
+            fn.body.push_back(IRBinary(IRBinaryOperator::Add, variable(), next));
+            temp = next;
+        }
+        fn.body.push_back(IRMov(temp, variable()));
+        return temp;
+    };
+
+    for (int v = 0; v < kVariables; ++v) fn.body.push_back(IRMov(IROperand::imm(v), IROperand::pseudo(v)));
+    for (int segment = 0; segment < blocks / 4; ++segment) {
+        int elseLabel = fn.addLabel();
+        int joinLabel = fn.addLabel();
+        fn.body.push_back(IRCmp(IROperand::imm(0), chain()));
+        fn.body.push_back(IRJumpCC(IRCondCode::E, elseLabel));
+        chain();
+        fn.body.push_back(IRJump(joinLabel));
+        fn.body.push_back(IRLabel(elseLabel));
+        chain();
+        fn.body.push_back(IRLabel(joinLabel));
+        fn.body.push_back(IRCmp(IROperand::imm(100), chain()));
+        fn.body.push_back(IRJumpCC(IRCondCode::L, joinLabel));
+    }
+    fn.body.push_back(IRMov(IROperand::pseudo(0), IROperand::reg(IRRegister::AX)));
+    fn.body.push_back(IRRet());
+    return fn;
+}
+
+double milliseconds(const std::function<void()>& work) {
+    auto start = std::chrono::steady_clock::now();
+    work();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+int main() {
+    std::printf("%8s %8s %10s %12s %12s\n", "blocks", "pseudos", "instrs", "liveness ms", "copyprop ms");
+    for (int blocks = 6250; blocks <= 50000; blocks *= 2) {
+        IRFunction fn = makeFunction(blocks);
+        CFG cfg = CFG::build(fn);
+        LocationIndex locations(fn);
+        double liveness = milliseconds([&] { Liveness::compute(fn, cfg, locations); });
+        size_t pseudos = fn.pseudos.size();
+        size_t instructions = fn.body.size();
+        double copies = milliseconds([&] { CopyPropagation::run(fn); });
+        std::printf("%8zu %8zu %10zu %12.1f %12.1f\n", cfg.blocks.size(), pseudos, instructions, liveness, copies);
+    }
+    return 0;
+}
@@ -0,0 +1,14 @@
+int main(void) {
+    int result = 0;
+    for (int round = 0; round < 2000; round = round + 1) {
+        int a = 0;
+        int b = 1;
+        for (int i = 0; i < 40; i = i + 1) {
+            int next = a + b;
+            a = b;
+            b = next % 1000007;
+        }
+        result = (result + a) % 1000;
+    }
+    return result % 256;
+}
@@ -0,0 +1,16 @@
+int main(void) {
+    int total = 0;
+    for (int a = 1; a < 150; a = a + 1) {
+        for (int b = 1; b < 150; b = b + 1) {
+            int x = a;
+            int y = b;
+            while (y != 0) {
+                int r = x % y;
+                x = y;
+                y = r;
+            }
+            total = total + (x == 1 ? 1 : 0);
+        }
+    }
+    return total % 256;
+}
@@ -0,0 +1,33 @@
+// Counts the user-space instructions a program retires by single-stepping it
+// under ptrace. Linux/x86-64 only; used by run.sh.
+#include <stdio.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: icount <program> [args...]\n");
+        return 2;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        ptrace(PTRACE_TRACEME, 0, 0, 0);
+        execv(argv[1], argv + 1);
+        return 127;
+    }
+    int status;
+    long count = 0;
+    waitpid(pid, &status, 0);
+    for (;;) {
+        if (ptrace(PTRACE_SINGLESTEP, pid, 0, 0) < 0) {
+            perror("ptrace");
+            return 1;
+        }
+        waitpid(pid, &status, 0);
+        if (WIFEXITED(status)) break;
+        ++count;
+    }
+    printf("%ld %d\n", count, WEXITSTATUS(status));
+    return 0;
+}
@@ -0,0 +1,15 @@
+int main(void) {
+    int scale = 0;
+    int bias = 0;
+    for (int k = 0; k < 5; k = k + 1) {
+        scale = scale + k;
+        bias = bias + 2 * k;
+    }
+    int acc = 0;
+    for (int i = 0; i < 100000; i = i + 1) {
+        int step = scale * bias + (bias - scale) * 3;
+        int limit = bias / 4;
+        acc = acc + step + limit + (scale < bias);
+    }
+    return acc % 256;
+}
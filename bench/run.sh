@@ -0,0 +1,42 @@
+#!/bin/sh
+# Compares dynamic instruction counts of the benchmark programs between two
+# sets of compiler flags. Counts exclude the C runtime start-up, measured on
+# an empty program.
+#
+#   bench/run.sh <compiler> [flagsA] [flagsB]      (defaults: -O0 -O2)
+set -e
+COMPILER=$1
+FLAGS_A=${2:--O0}
+FLAGS_B=${3:--O2}
+DIR=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+if [ -z "$COMPILER" ]; then
+    echo "usage: $0 <compiler> [flagsA] [flagsB]" >&2
+    exit 2
+fi
+cc -O2 -o "$WORK/icount" "$DIR/icount.c"
+
+count() { # flags source
+    "$COMPILER" $1 --codegen "$2" > "$WORK/prog.s"
+    cc -o "$WORK/prog" "$WORK/prog.s"
+    "$WORK/icount" "$WORK/prog"
+}
+
+echo 'int main(void) { return 0; }' > "$WORK/empty.c"
+BASE=$(count "$FLAGS_A" "$WORK/empty.c" | cut -d' ' -f1)
+
+printf '%-12s %14s %14s %8s\n' benchmark "$FLAGS_A" "$FLAGS_B" change
+for src in "$DIR"/*.c; do
+    name=$(basename "$src" .c)
+    case "$name" in icount|timer) continue ;; esac
+    set -- $(count "$FLAGS_A" "$src"); a=$(($1 - BASE)); ra=$2
+    set -- $(count "$FLAGS_B" "$src"); b=$(($1 - BASE)); rb=$2
+    if [ "$ra" != "$rb" ]; then
+        echo "$name: exit status differs ($ra vs $rb)" >&2
+        exit 1
+    fi
+    printf '%-12s %14d %14d %7s%%\n' "$name" "$a" "$b" \
+        "$(awk "BEGIN { printf \"%.1f\", ($b - $a) * 100.0 / $a }")"
+done
@@ -0,0 +1,15 @@
+int main(void) {
+    int s = 0;
+    for (int i = 0; i < 100000; i = i + 1)
+        s = s + i * i % 7;
+    int n = 0;
+    int k = 1;
+    while (k < 100000) {
+        k = k * 3;
+        n = n + 10000;
+    }
+    int t = 0;
+    for (int j = 0; j < n; j = j + 1)
+        t = t + j * j % 5;
+    return (s + t) % 256;
+}
@@ -0,0 +1,11 @@
+int main(void) {
+    int total = 0;
+    for (int round = 0; round < 1000; round = round + 1) {
+        int s = 0;
+        for (int i = 0; i < 200; i = i + 1) {
+            s = s + i * 12 + i * round;
+        }
+        total = total + s % 97;
+    }
+    return total % 256;
+}
@@ -0,0 +1,9 @@
+int main(void) {
+    int sum = 0;
+    for (int i = 0; i < 200000; i = i + 1) {
+        int t = i * 3;
+        int u = t + 7;
+        sum = sum + u - i;
+    }
+    return sum % 256;
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Compares the running time of the benchmark programs between two sets of
+# compiler flags: the fastest of ROUNDS calls to each program's main.
+#
+#   bench/time.sh <compiler> [flagsA] [flagsB]      (defaults: -O0 -O2)
+set -e
+COMPILER=$1
+FLAGS_A=${2:--O0}
+FLAGS_B=${3:--O2}
+ROUNDS=${ROUNDS:-200}
+DIR=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+if [ -z "$COMPILER" ]; then
+    echo "usage: $0 <compiler> [flagsA] [flagsB]" >&2
+    exit 2
+fi
+cc -O2 -c -o "$WORK/timer.o" "$DIR/timer.c"
+
+measure() { # flags source
+    "$COMPILER" $1 --codegen "$2" | sed 's/\bmain\b/bench_main/' > "$WORK/prog.s"
+    cc -o "$WORK/prog" "$WORK/timer.o" "$WORK/prog.s"
+    "$WORK/prog" "$ROUNDS"
+}
+
+printf '%-12s %12s %12s %8s\n' benchmark "$FLAGS_A (us)" "$FLAGS_B (us)" change
+for src in "$DIR"/*.c; do
+    name=$(basename "$src" .c)
+    case "$name" in icount|timer) continue ;; esac
+    set -- $(measure "$FLAGS_A" "$src"); a=$1; ra=$2
+    set -- $(measure "$FLAGS_B" "$src"); b=$1; rb=$2
+    if [ "$ra" != "$rb" ]; then
+        echo "$name: result differs ($ra vs $rb)" >&2
+        exit 1
+    fi
+    printf '%-12s %12s %12s %8s\n' "$name" "$a" "$b" \
+        "$(awk "BEGIN { if ($a > 0) printf \"%.1f%%\", ($b - $a) * 100.0 / $a; else print \"-\" }")"
+done
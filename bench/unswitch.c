@@ -0,0 +1,13 @@
+int main(void) {
+    int mode = 0;
+    int k = 1;
+    while (k < 1000) { k = k * 3; mode = mode + 1; }
+    int s = 0;
+    for (int i = 0; i < 100000; i = i + 1) {
+        if (mode == 7)
+            s = s + i % 3;
+        else
+            s = s - i % 5;
+    }
+    return s % 256;
+}
@@ -0,0 +1,109 @@
+#include "cfg.h"
+
+#include <stdexcept>
+#include <string>
+#include "ir_utils.h"
+
+CFG CFG::build(const IRFunction& fn) {
+    CFG cfg;
+    const auto& body = fn.body;
+
+    // Split the body into blocks.
+    size_t start = 0;
+    for (size_t i = 0; i < body.size(); ++i) {
+        const auto& inst = body[i];
+        if (std::get_if<IRLabel>(&inst) && i > start) {
+            cfg.blocks.push_back(BasicBlock{static_cast<int>(cfg.blocks.size()), start, i, {}, {}, -1});
+            start = i;
+        }
+        if (isTerminator(inst)) {
+            cfg.blocks.push_back(BasicBlock{static_cast<int>(cfg.blocks.size()), start, i + 1, {}, {}, -1});
+            start = i + 1;
+        }
+    }
+    if (start < body.size()) {
+        cfg.blocks.push_back(BasicBlock{static_cast<int>(cfg.blocks.size()), start, body.size(), {}, {}, -1});
+    }
+
+    cfg.labelToBlock.assign(fn.labelCount, -1);
+    for (const auto& block : cfg.blocks) {
+        if (auto* label = std::get_if<IRLabel>(&body[block.begin])) {
+            cfg.labelToBlock.at(label->id) = block.id;
+        }
+    }
+
+    auto addEdge = [&](int from, int to) {
+        auto& succs = cfg.blocks[from].succs;
+        for (int s : succs) {
+            if (s == to) return;
+        }
+        succs.push_back(to);
+        cfg.blocks[to].preds.push_back(from);
+    };
+    auto blockFor = [&](int label) {
+        if (label < 0 || label >= fn.labelCount || cfg.labelToBlock[label] < 0) {
+            throw std::runtime_error("CFG error: jump to unknown label L" + std::to_string(label));
+        }
+        return cfg.labelToBlock[label];
+    };
+
+    for (auto& block : cfg.blocks) {
+        const auto& last = body[block.end - 1];
+        int next = block.id + 1 < static_cast<int>(cfg.blocks.size()) ? block.id + 1 : -1;
+        if (std::get_if<IRRet>(&last)) {
+            continue;
+        }
+        if (auto* j = std::get_if<IRJump>(&last)) {
+            addEdge(block.id, blockFor(j->target));
+            continue;
+        }
+        if (auto* j = std::get_if<IRJumpCC>(&last)) {
+            addEdge(block.id, blockFor(j->target));
+        }
+        if (next >= 0) {
+            block.fallthrough = next;
+            addEdge(block.id, next);
+        }
+    }
+    return cfg;
+}
+
+std::vector<int> CFG::postOrder() const {
+    std::vector<int> order;
+    if (blocks.empty()) {
+        return order;
+    }
+    std::vector<bool> visited(blocks.size(), false);
+    // Iterative DFS: (block, next successor index).
+    std::vector<std::pair<int, size_t>> stack;
+    stack.emplace_back(0, 0);
+    visited[0] = true;
+    while (!stack.empty()) {
+        auto& [id, next] = stack.back();
+        const auto& succs = blocks[id].succs;
+        if (next < succs.size()) {
+            int s = succs[next++];
+            if (!visited[s]) {
+                visited[s] = true;
+                stack.emplace_back(s, 0);
+            }
+            continue;
+        }
+        order.push_back(id);
+        stack.pop_back();
+    }
+    return order;
+}
+
+std::vector<int> CFG::reversePostOrder() const {
+    auto order = postOrder();
+    return {order.rbegin(), order.rend()};
+}
+
+std::vector<bool> CFG::reachable() const {
+    std::vector<bool> result(blocks.size(), false);
+    for (int id : postOrder()) {
+        result[id] = true;
+    }
+    return result;
+}
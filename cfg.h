@@ -0,0 +1,39 @@
+#ifndef COMPILER_CFG_H
+#define COMPILER_CFG_H
+
+#include <vector>
+#include "ir.h"
+
+// A maximal straight-line run of instructions in IRFunction::body.
+// A block starts at a Label (or after a terminator) and ends after a
+// Jump, JumpCC or Ret. Instructions are referenced by index, so a CFG is
+// only valid until the function body is modified.
+struct BasicBlock {
+    int id = 0;
+    size_t begin = 0;                // first instruction index
+    size_t end = 0;                  // one past the last instruction index
+    std::vector<int> preds;
+    std::vector<int> succs;
+    // Block laid out directly after this one that control falls into, or -1.
+    int fallthrough = -1;
+};
+
+// Control-flow graph over a linear IR function. Block 0 is the entry block.
+// Blocks are numbered in layout order.
+//
+// Lowering only consumes condition flags in the block that set them, so the
+// flags are never live across an edge of this graph.
+struct CFG {
+    std::vector<BasicBlock> blocks;
+    std::vector<int> labelToBlock; // label id -> block it starts, -1 if unplaced
+
+    static CFG build(const IRFunction& fn);
+
+    // Blocks reachable from the entry, in reverse post-order.
+    std::vector<int> reversePostOrder() const;
+    // Blocks reachable from the entry, in post-order.
+    std::vector<int> postOrder() const;
+    std::vector<bool> reachable() const;
+};
+
+#endif // COMPILER_CFG_H
@@ -1,7 +1,13 @@
 #include "codegen.h"
+#include "frame_layout.h"
+#include "instruction_selection.h"
 #include "lowering.h"
+#include "ir_utils.h"
+#include "register_allocation.h"
+#include <algorithm>
 #include <sstream>
-#include <unordered_map>
+#include <stdexcept>
+#include <vector>
 
 #if defined(__APPLE__)
     #define IS_MAC 1
@@ -19,6 +25,8 @@ std::string CodeGenerator::generate(const IRProgram& program) {
 
 std::string CodeGenerator::generate(const Program& program) {
     auto ir = Lowering::toIR(program);
+    FrameLayout::run(*ir->function);
+    InstructionSelection::run(*ir->function);
     return generate(*ir);
 }
 
@@ -28,6 +36,16 @@ static const char* regToAsm32(IRRegister reg) {
         case IRRegister::DX: return "%edx";
         case IRRegister::R10: return "%r10d";
         case IRRegister::R11: return "%r11d";
+        case IRRegister::CX: return "%ecx";
+        case IRRegister::SI: return "%esi";
+        case IRRegister::DI: return "%edi";
+        case IRRegister::R8: return "%r8d";
+        case IRRegister::R9: return "%r9d";
+        case IRRegister::BX: return "%ebx";
+        case IRRegister::R12: return "%r12d";
+        case IRRegister::R13: return "%r13d";
+        case IRRegister::R14: return "%r14d";
+        case IRRegister::R15: return "%r15d";
     }
     return "%eax";
 }
@@ -38,47 +56,64 @@ static const char* regToAsm8(IRRegister reg) {
         case IRRegister::DX: return "%dl";
         case IRRegister::R10: return "%r10b";
         case IRRegister::R11: return "%r11b";
+        case IRRegister::CX: return "%cl";
+        case IRRegister::SI: return "%sil";
+        case IRRegister::DI: return "%dil";
+        case IRRegister::R8: return "%r8b";
+        case IRRegister::R9: return "%r9b";
+        case IRRegister::BX: return "%bl";
+        case IRRegister::R12: return "%r12b";
+        case IRRegister::R13: return "%r13b";
+        case IRRegister::R14: return "%r14b";
+        case IRRegister::R15: return "%r15b";
     }
     return "%al";
 }
 
-static std::string formatOperand(
-    const IROperand& op,
-    const std::unordered_map<std::string, int>& pseudoOffsets) {
-    if (auto* imm = dynamic_cast<const IRImm*>(&op)) {
-        return "$" + std::to_string(imm->value);
-    }
-    if (auto* reg = dynamic_cast<const IRReg*>(&op)) {
-        return regToAsm32(reg->reg);
-    }
-    if (auto* pseudo = dynamic_cast<const IRPseudo*>(&op)) {
-        auto it = pseudoOffsets.find(pseudo->name);
-        int offset = (it == pseudoOffsets.end()) ? 0 : it->second;
-        return std::to_string(offset) + "(%rbp)";
+static const char* regToAsm64(IRRegister reg) {
+    switch (reg) {
+        case IRRegister::AX: return "%rax";
+        case IRRegister::DX: return "%rdx";
+        case IRRegister::R10: return "%r10";
+        case IRRegister::R11: return "%r11";
+        case IRRegister::CX: return "%rcx";
+        case IRRegister::SI: return "%rsi";
+        case IRRegister::DI: return "%rdi";
+        case IRRegister::R8: return "%r8";
+        case IRRegister::R9: return "%r9";
+        case IRRegister::BX: return "%rbx";
+        case IRRegister::R12: return "%r12";
+        case IRRegister::R13: return "%r13";
+        case IRRegister::R14: return "%r14";
+        case IRRegister::R15: return "%r15";
     }
-    if (auto* stack = dynamic_cast<const IRStack*>(&op)) {
-        return std::to_string(stack->offset) + "(%rbp)";
+    return "%rax";
+}
+
+static std::string formatOperand(const IROperand& op, const IRFunction& func) {
+    switch (op.kind) {
+        case IROperandKind::Imm:
+            return "$" + std::to_string(op.asImm());
+        case IROperandKind::Reg:
+            return regToAsm32(op.asReg());
+        case IROperandKind::Pseudo:
+            throw std::runtime_error("Codegen error: pseudo " + func.pseudos.at(op.asPseudo()) + " has no stack slot");
+        case IROperandKind::Stack:
+            return std::to_string(op.asStack()) + "(%rbp)";
     }
     return "0(%rbp)";
 }
 
-static std::string formatLabel(const std::string& label) {
-    if (label.rfind(".L", 0) == 0) {
-        return label;
-    }
-    if (label.rfind("L", 0) == 0) {
-        return "." + label;
-    }
-    return ".L" + label;
+static std::string formatLabel(int label) {
+    return ".L" + std::to_string(label);
 }
 
 static bool isMemoryOperand(const IROperand& op) {
-    return dynamic_cast<const IRPseudo*>(&op) != nullptr
-        || dynamic_cast<const IRStack*>(&op) != nullptr;
+    return op.isStack();
 }
 
 static bool isImmediateOperand(const IROperand& op) {
-    return dynamic_cast<const IRImm*>(&op) != nullptr;
+    return op.isImm();
 }
 
 static const char* condToSuffix(IRCondCode cond) {
@@ -93,49 +128,37 @@ static const char* condToSuffix(IRCondCode cond) {
     return "e";
 }
 
+// For each instruction, whether the flags it leaves are read before being
+// written again. Flags never cross block boundaries.
+static std::vector<bool> flagsLiveAfter(const IRFunction& func) {
+    std::vector<bool> liveAfter(func.body.size());
+    bool live = false;
+    for (size_t i = func.body.size(); i-- > 0;) {
+        const auto& inst = func.body[i];
+        if (isTerminator(inst)) live = false;
+        liveAfter[i] = live;
+        if (writesFlags(inst)) live = false;
+        if (readsFlags(inst)) live = true;
+        if (std::holds_alternative<IRLabel>(inst)) live = false;
+    }
+    return liveAfter;
+}
+
 std::string CodeGenerator::genFunctionIR(const IRFunction& func) {
     std::stringstream ss;
     std::string funcName = mangleFuncName(func.name);
 
-    // First pass: collect pseudos to allocate stack slots.
-    // We assign each unique pseudo name a 4-byte slot at negative offsets from %rbp.
-    std::unordered_map<std::string, int> pseudoOffsets; // name -> offset
-    int nextOffset = -4; // start at -4(%rbp), grow negatively
-    auto ensurePseudo = [&](const IROperand* op) {
-        if (auto* p = dynamic_cast<const IRPseudo*>(op)) {
-            if (!pseudoOffsets.count(p->name)) {
-                pseudoOffsets[p->name] = nextOffset;
-                nextOffset -= 4;
-            }
+    // Callee-saved registers the allocator handed out, saved below %rbp's
+    // slot so the frame offsets do not move.
+    std::vector<IRRegister> saved;
+    auto noteRegister = [&](const IROperand& op) {
+        if (op.isReg() && isCalleeSaved(op.asReg()) && std::find(saved.begin(), saved.end(), op.asReg()) == saved.end()) {
+            saved.push_back(op.asReg());
         }
     };
 
-    bool hasAllocate = false;
-    for (const auto& instPtr : func.body) {
-        if (auto* m = dynamic_cast<const IRMov*>(instPtr.get())) {
-            ensurePseudo(m->src.get());
-            ensurePseudo(m->dst.get());
-        } else if (auto* u = dynamic_cast<const IRUnary*>(instPtr.get())) {
-            ensurePseudo(u->operand.get());
-        } else if (auto* b = dynamic_cast<const IRBinary*>(instPtr.get())) {
-            ensurePseudo(b->src.get());
-            ensurePseudo(b->dst.get());
-        } else if (auto* c = dynamic_cast<const IRCmp*>(instPtr.get())) {
-            ensurePseudo(c->src.get());
-            ensurePseudo(c->dst.get());
-        } else if (auto* d = dynamic_cast<const IRIdiv*>(instPtr.get())) {
-            ensurePseudo(d->divisor.get());
-        } else if (auto* s = dynamic_cast<const IRSetCC*>(instPtr.get())) {
-            ensurePseudo(s->dst.get());
-        } else if (dynamic_cast<const IRAllocateStack*>(instPtr.get())) {
-            hasAllocate = true;
-        }
-    }
-
-    int frameSize = -nextOffset - 4;
-    if (frameSize < 0) frameSize = 0;
-    if (frameSize % 16 != 0) {
-        frameSize += (16 - (frameSize % 16));
+    for (const auto& inst : func.body) {
+        forEachOperand(inst, [&](const IROperand& op, OperandRole) { noteRegister(op); });
     }
 
     ss << "    .text\n";
@@ -143,44 +166,50 @@ std::string CodeGenerator::genFunctionIR(const IRFunction& func) {
     ss << funcName << ":\n";
 
     // Prologue
+    for (IRRegister reg : saved) {
+        ss << "    pushq " << regToAsm64(reg) << "\n";
+    }
     ss << "    pushq %rbp\n";
     ss << "    movq %rsp, %rbp\n";
-    if (!hasAllocate && frameSize > 0) {
-        ss << "    subq $" << frameSize << ", %rsp\n";
-    }
 
     // Body
     bool sawRet = false;
-    for (const auto& instPtr : func.body) {
-        if (auto* m = dynamic_cast<const IRMov*>(instPtr.get())) {
-            std::string src = formatOperand(*m->src, pseudoOffsets);
-            std::string dst = formatOperand(*m->dst, pseudoOffsets);
-            if (isMemoryOperand(*m->src) && isMemoryOperand(*m->dst)) {
+    std::vector<bool> flagsLive = flagsLiveAfter(func);
+    for (size_t index = 0; index < func.body.size(); ++index) {
+        const auto& inst = func.body[index];
+        if (auto* m = std::get_if<IRMov>(&inst)) {
+            std::string src = formatOperand(m->src, func);
+            std::string dst = formatOperand(m->dst, func);
+            if (m->src == IROperand::imm(0) && m->dst.isReg() && !flagsLive[index]) {
+                // The zero idiom: shorter, and it breaks the dependency on
+                // the register's old value, e.g. for a setcc to come.
+                ss << "    xorl " << dst << ", " << dst << "\n";
+            } else if (isMemoryOperand(m->src) && isMemoryOperand(m->dst)) {
                 ss << "    movl " << src << ", %r10d\n";
                 ss << "    movl %r10d, " << dst << "\n";
             } else {
                 ss << "    movl " << src << ", " << dst << "\n";
             }
-        } else if (auto* u = dynamic_cast<const IRUnary*>(instPtr.get())) {
+        } else if (auto* u = std::get_if<IRUnary>(&inst)) {
             const char* op = (u->op == IRUnaryOperator::Neg) ? "negl" : "notl";
-            ss << "    " << op << " " << formatOperand(*u->operand, pseudoOffsets) << "\n";
-        } else if (auto* b = dynamic_cast<const IRBinary*>(instPtr.get())) {
+            ss << "    " << op << " " << formatOperand(u->operand, func) << "\n";
+        } else if (auto* b = std::get_if<IRBinary>(&inst)) {
             const char* op = "addl";
             switch (b->op) {
                 case IRBinaryOperator::Add: op = "addl"; break;
                 case IRBinaryOperator::Sub: op = "subl"; break;
                 case IRBinaryOperator::Mul: op = "imull"; break;
             }
-            std::string src = formatOperand(*b->src, pseudoOffsets);
-            std::string dst = formatOperand(*b->dst, pseudoOffsets);
+            std::string src = formatOperand(b->src, func);
+            std::string dst = formatOperand(b->dst, func);
             if (b->op == IRBinaryOperator::Mul) {
-                if (isMemoryOperand(*b->dst)) {
+                if (isMemoryOperand(b->dst)) {
                     // Always load destination from memory into temp, multiply, store back
                     ss << "    movl " << dst << ", %r10d\n";
-                    if (isImmediateOperand(*b->src) || isMemoryOperand(*b->src)) {
+                    if (isImmediateOperand(b->src) || isMemoryOperand(b->src)) {
                         // Ensure src is in a register if it's imm or memory
-                        ss << "    movl " << src << ", %eax\n";
-                        ss << "    imull %eax, %r10d\n";
+                        ss << "    movl " << src << ", %r11d\n";
+                        ss << "    imull %r11d, %r10d\n";
                     } else {
                         // src is already a register
                         ss << "    imull " << src << ", %r10d\n";
@@ -188,11 +217,11 @@ std::string CodeGenerator::genFunctionIR(const IRFunction& func) {
                     ss << "    movl %r10d, " << dst << "\n";
                 } else {
                     // dst is a register; we can use imull src, dst directly
-                    if (isMemoryOperand(*b->src) && isMemoryOperand(*b->dst)) {
+                    if (isMemoryOperand(b->src) && isMemoryOperand(b->dst)) {
                         // unreachable due to dst not memory, but keep structure consistent
                         ss << "    movl " << src << ", %r10d\n";
                         ss << "    imull %r10d, " << dst << "\n";
-                    } else if (isImmediateOperand(*b->src) || isMemoryOperand(*b->src)) {
+                    } else if (isImmediateOperand(b->src) || isMemoryOperand(b->src)) {
                         // Some assemblers accept imull imm, reg; GAS does. Use it directly.
                         ss << "    imull " << src << ", " << dst << "\n";
                     } else {
@@ -200,58 +229,91 @@ std::string CodeGenerator::genFunctionIR(const IRFunction& func) {
                         ss << "    imull " << src << ", " << dst << "\n";
                     }
                 }
-            } else if (isMemoryOperand(*b->src) && isMemoryOperand(*b->dst)) {
+            } else if (isMemoryOperand(b->src) && isMemoryOperand(b->dst)) {
                 ss << "    movl " << src << ", %r10d\n";
                 ss << "    " << op << " %r10d, " << dst << "\n";
             } else {
                 ss << "    " << op << " " << src << ", " << dst << "\n";
             }
-        } else if (auto* c = dynamic_cast<const IRCmp*>(instPtr.get())) {
-            std::string src = formatOperand(*c->src, pseudoOffsets);
-            std::string dst = formatOperand(*c->dst, pseudoOffsets);
-            if (isImmediateOperand(*c->dst)) {
+        } else if (auto* c = std::get_if<IRCmp>(&inst)) {
+            std::string src = formatOperand(c->src, func);
+            std::string dst = formatOperand(c->dst, func);
+            if (c->src == IROperand::imm(0) && c->dst.isReg()) {
+                // Same flags as the compare, and no immediate to encode.
+                ss << "    testl " << dst << ", " << dst << "\n";
+            } else if (isImmediateOperand(c->dst)) {
                 ss << "    movl " << dst << ", %r11d\n";
                 ss << "    cmpl " << src << ", %r11d\n";
-            } else if (isMemoryOperand(*c->src) && isMemoryOperand(*c->dst)) {
+            } else if (isMemoryOperand(c->src) && isMemoryOperand(c->dst)) {
                 ss << "    movl " << src << ", %r10d\n";
                 ss << "    cmpl %r10d, " << dst << "\n";
             } else {
                 ss << "    cmpl " << src << ", " << dst << "\n";
             }
-        } else if (auto* d = dynamic_cast<const IRIdiv*>(instPtr.get())) {
-            std::string divisor = formatOperand(*d->divisor, pseudoOffsets);
-            if (isImmediateOperand(*d->divisor)) {
+        } else if (auto* d = std::get_if<IRIdiv>(&inst)) {
+            std::string divisor = formatOperand(d->divisor, func);
+            if (isImmediateOperand(d->divisor)) {
                 ss << "    movl " << divisor << ", %r10d\n";
                 ss << "    idivl %r10d\n";
             } else {
                 ss << "    idivl " << divisor << "\n";
             }
-        } else if (dynamic_cast<const IRCdq*>(instPtr.get())) {
+        } else if (std::get_if<IRCdq>(&inst)) {
             ss << "    cdq\n";
-        } else if (auto* j = dynamic_cast<const IRJump*>(instPtr.get())) {
+        } else if (auto* j = std::get_if<IRJump>(&inst)) {
             ss << "    jmp " << formatLabel(j->target) << "\n";
-        } else if (auto* j = dynamic_cast<const IRJumpCC*>(instPtr.get())) {
+        } else if (auto* j = std::get_if<IRJumpCC>(&inst)) {
             ss << "    j" << condToSuffix(j->cond) << " " << formatLabel(j->target) << "\n";
-        } else if (auto* s = dynamic_cast<const IRSetCC*>(instPtr.get())) {
-            if (auto* reg = dynamic_cast<const IRReg*>(s->dst.get())) {
-                ss << "    set" << condToSuffix(s->cond) << " " << regToAsm8(reg->reg) << "\n";
+        } else if (auto* s = std::get_if<IRSetCC>(&inst)) {
+            if (s->dst.isReg()) {
+                ss << "    set" << condToSuffix(s->cond) << " " << regToAsm8(s->dst.asReg()) << "\n";
             } else {
-                std::string dst = formatOperand(*s->dst, pseudoOffsets);
-                ss << "    set" << condToSuffix(s->cond) << " " << dst << "\n";
+                // A byte store would stall the 32-bit load of the value that
+                // follows; set the byte in a register and store all of it.
+                std::string dst = formatOperand(s->dst, func);
+                ss << "    movl " << dst << ", %r11d\n";
+                ss << "    set" << condToSuffix(s->cond) << " %r11b\n";
+                ss << "    movl %r11d, " << dst << "\n";
             }
-        } else if (auto* l = dynamic_cast<const IRLabel*>(instPtr.get())) {
-            ss << formatLabel(l->name) << ":\n";
-        } else if (auto* a = dynamic_cast<const IRAllocateStack*>(instPtr.get())) {
+        } else if (auto* c = std::get_if<IRCMov>(&inst)) {
+            // cmov takes no immediate and writes only registers; the movs
+            // around it leave the flags alone.
+            std::string op = std::string("cmov") + condToSuffix(c->cond);
+            std::string src = formatOperand(c->src, func);
+            std::string dst = formatOperand(c->dst, func);
+            if (isImmediateOperand(c->src)) {
+                ss << "    movl " << src << ", %r10d\n";
+                src = "%r10d";
+            }
+            if (isMemoryOperand(c->dst)) {
+                ss << "    movl " << dst << ", %r11d\n";
+                ss << "    " << op << " " << src << ", %r11d\n";
+                ss << "    movl %r11d, " << dst << "\n";
+            } else {
+                ss << "    " << op << " " << src << ", " << dst << "\n";
+            }
+        } else if (auto* l = std::get_if<IRLea>(&inst)) {
+            ss << "    leal ";
+            if (l->disp != 0) ss << l->disp;
+            ss << "(" << regToAsm64(l->base.asReg());
+            if (l->scale != 0) ss << "," << regToAsm64(l->index.asReg());
+            if (l->scale > 1) ss << "," << l->scale;
+            ss << "), " << formatOperand(l->dst, func) << "\n";
+        } else if (auto* m = std::get_if<IRImul>(&inst)) {
+            ss << "    imull $" << m->factor << ", " << formatOperand(m->src, func) << ", "
+               << formatOperand(m->dst, func) << "\n";
+        } else if (auto* l = std::get_if<IRLabel>(&inst)) {
+            ss << formatLabel(l->id) << ":\n";
+        } else if (auto* a = std::get_if<IRAllocateStack>(&inst)) {
             if (a->amount > 0) {
-                int amount = a->amount;
-                if (frameSize > amount) {
-                    amount = frameSize;
-                }
-                ss << "    subq $" << amount << ", %rsp\n";
+                ss << "    subq $" << a->amount << ", %rsp\n";
             }
-        } else if (dynamic_cast<const IRRet*>(instPtr.get())) {
+        } else if (std::get_if<IRRet>(&inst)) {
             ss << "    movq %rbp, %rsp\n";
             ss << "    popq %rbp\n";
+            for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+                ss << "    popq " << regToAsm64(*it) << "\n";
+            }
             ss << "    ret\n";
             sawRet = true;
         }
@@ -262,6 +324,9 @@ std::string CodeGenerator::genFunctionIR(const IRFunction& func) {
         ss << "    movl $0, %eax\n";
         ss << "    movq %rbp, %rsp\n";
         ss << "    popq %rbp\n";
+        for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+            ss << "    popq " << regToAsm64(*it) << "\n";
+        }
         ss << "    ret\n";
     }
 #if defined(__linux__)
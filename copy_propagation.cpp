@@ -0,0 +1,453 @@
+#include "copy_propagation.h"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <utility>
+#include <vector>
+#include "analysis_manager.h"
+#include "bit_vector.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "def_use.h"
+#include "ir_utils.h"
+#include "loops.h"
+
+namespace {
+    // A `mov src, dst` whose destination is a pseudo and whose source is an
+    // immediate or another pseudo.
+    struct Copy {
+        IROperand src;
+        int dst = 0;
+        int block = 0;
+    };
+
+    template <typename F>
+    void forEachWrittenPseudo(const IRInstruction& inst, F&& fn) {
+        forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+            if (op.isPseudo() && role != OperandRole::Read) fn(op.asPseudo());
+        });
+    }
+
+    // The copies of a function. Most of them die in their own block or can
+    // only be used there, so just the global ones are carried across blocks
+    // by a must-dataflow over bit vectors.
+    class ReachingCopies {
+    public:
+        ReachingCopies(const IRFunction& fn, const CFG& cfg) : copyAt(fn.body.size(), -1) {
+            size_t pseudoCount = fn.pseudos.size();
+            for (const auto& block : cfg.blocks) {
+                for (size_t i = block.begin; i < block.end; ++i) {
+                    auto* m = std::get_if<IRMov>(&fn.body[i]);
+                    if (m == nullptr) continue;
+                    bool srcOk = m->src.isPseudo() || m->src.isImm();
+                    if (!m->dst.isPseudo() || !srcOk || m->src == m->dst) continue;
+                    copyAt[i] = static_cast<int>(copies.size());
+                    copies.push_back(Copy{m->src, m->dst.asPseudo(), block.id});
+                }
+            }
+            definitions.assign(pseudoCount, 0);
+            for (const auto& inst : fn.body) {
+                forEachWrittenPseudo(inst, [&](int pseudo) { ++definitions[pseudo]; });
+            }
+            selectGlobals(fn, cfg, pseudoCount);
+            mentionsGlobal.resize(pseudoCount);
+            globalsIn.resize(cfg.blocks.size());
+            for (size_t g = 0; g < globals.size(); ++g) {
+                const Copy& copy = copies[globals[g]];
+                globalsIn[copy.block].push_back(static_cast<int>(g));
+                mentionsGlobal[copy.dst].push_back(static_cast<int>(g));
+                if (copy.src.isPseudo()) mentionsGlobal[copy.src.asPseudo()].push_back(static_cast<int>(g));
+            }
+        }
+
+        bool empty() const { return copies.empty(); }
+        const Copy& copy(int id) const { return copies[id]; }
+        // Forwarding `mov s, d` into reads of a d that has other definitions
+        // rarely kills the copy; it only stretches s and blocks coalescing.
+        bool forwardable(int id) const {
+            return !copies[id].src.isPseudo() || definitions[copies[id].dst] == 1;
+        }
+
+        // Forward must-analysis over the global copies: one reaches a block
+        // only if it reaches along every predecessor. Returns the set
+        // reaching each block.
+        std::vector<BitVector> solve(const IRFunction& fn, const CFG& cfg) const {
+            GenKillProblem problem(DataflowDirection::Forward, DataflowMeet::Intersection, cfg.blocks.size(),
+                                   static_cast<int>(globals.size()));
+            for (const auto& block : cfg.blocks) {
+                for (size_t i = block.begin; i < block.end; ++i) {
+                    forEachWrittenPseudo(fn.body[i], [&](int pseudo) {
+                        for (int g : mentionsGlobal[pseudo]) problem.kill(block.id).set(g);
+                    });
+                    if (copyAt[i] >= 0 && globalOf[copyAt[i]] >= 0) problem.gen(block.id).set(globalOf[copyAt[i]]);
+                }
+            }
+            return solveDataflow(cfg, problem).in;
+        }
+
+        // Copies reaching each point of one block, updated an instruction at
+        // a time. Arrays are stamped with the block being walked so that they
+        // need no clearing between blocks.
+        //
+        // A global copy reaching a block along every path is generated in a
+        // dominator, and of the global copies into one pseudo only the one in
+        // the nearest dominator can reach. Blocks must therefore be entered
+        // in dominator-tree preorder, which keeps those copies on a stack per
+        // pseudo.
+        class Walk {
+        public:
+            Walk(const ReachingCopies& copies, const Dominators& dominators, size_t pseudoCount)
+                : copies(copies), dominators(dominators), writtenIn(pseudoCount, -1), into(pseudoCount, -1),
+                  sourcedIn(pseudoCount, -1), sourceOf(pseudoCount), dominating(pseudoCount) {}
+
+            void enter(int blockId, const BitVector& reaching) {
+                if (block >= 0) {
+                    for (int g : copies.globalsIn[block]) dominating[copies.copies[copies.globals[g]].dst].push_back(g);
+                    open.push_back(block);
+                }
+                while (!open.empty() && !dominators.dominates(open.back(), blockId)) {
+                    for (int g : copies.globalsIn[open.back()]) dominating[copies.copies[copies.globals[g]].dst].pop_back();
+                    open.pop_back();
+                }
+                block = blockId;
+                entry = &reaching;
+            }
+
+            // Copy reaching with the given destination, or -1.
+            int reachingInto(int dst) const {
+                if (writtenIn[dst] == block) return into[dst];
+                if (dominating[dst].empty() || !entry->test(dominating[dst].back())) return -1;
+                int id = copies.globals[dominating[dst].back()];
+                const IROperand& src = copies.copies[id].src;
+                return src.isPseudo() && writtenIn[src.asPseudo()] == block ? -1 : id;
+            }
+
+            // Applies the effect of instruction `index`.
+            void transfer(const IRInstruction& inst, size_t index) {
+                forEachWrittenPseudo(inst, [&](int pseudo) { write(pseudo); });
+                int id = copies.copyAt[index];
+                if (id < 0) return;
+                const Copy& copy = copies.copies[id];
+                into[copy.dst] = id;
+                if (copy.src.isPseudo()) {
+                    int src = copy.src.asPseudo();
+                    if (sourcedIn[src] != block) {
+                        sourcedIn[src] = block;
+                        sourceOf[src].clear();
+                    }
+                    sourceOf[src].push_back(copy.dst);
+                }
+            }
+
+        private:
+            void write(int pseudo) {
+                writtenIn[pseudo] = block;
+                into[pseudo] = -1;
+                if (sourcedIn[pseudo] != block) return;
+                for (int dst : sourceOf[pseudo]) {
+                    if (into[dst] >= 0 && copies.copies[into[dst]].src == IROperand::pseudo(pseudo)) into[dst] = -1;
+                }
+                sourceOf[pseudo].clear();
+            }
+
+            const ReachingCopies& copies;
+            const Dominators& dominators;
+            int block = -1;
+            const BitVector* entry = nullptr;
+            // Pseudos written in the block so far, and the copy that last
+            // wrote each of them if it still holds.
+            std::vector<int> writtenIn;
+            std::vector<int> into;
+            // Destinations of the block's copies reading each pseudo.
+            std::vector<int> sourcedIn;
+            std::vector<std::vector<int>> sourceOf;
+            // Blocks on the dominator-tree path to the current one, and the
+            // global copies into each pseudo they generate, nearest last.
+            std::vector<int> open;
+            std::vector<std::vector<int>> dominating;
+        };
+
+    private:
+        // A copy is global if it holds at the end of its block and another
+        // block may use it: to forward it into a read of its destination, to
+        // find the same copy or its reverse redundant, or to continue a chain
+        // of forwarded copies.
+        void selectGlobals(const IRFunction& fn, const CFG& cfg, size_t pseudoCount) {
+            // Block in which each pseudo is read, and in which each copy or
+            // its reverse appears; -2 if several.
+            std::vector<int> readIn(pseudoCount, -1);
+            std::map<std::pair<IROperand, IROperand>, int> copiedIn;
+            auto note = [](int& seen, int blockId) {
+                if (seen == -1) seen = blockId;
+                else if (seen != blockId) seen = -2;
+            };
+            auto pair = [](const Copy& copy) {
+                IROperand dst = IROperand::pseudo(copy.dst);
+                return copy.src < dst ? std::make_pair(copy.src, dst) : std::make_pair(dst, copy.src);
+            };
+            // Surviving copies by destination, in reverse block order.
+            std::vector<std::vector<int>> survivingInto(pseudoCount);
+            std::vector<int> writtenAfter(pseudoCount, -1);
+            for (const auto& block : cfg.blocks) {
+                for (size_t i = block.end; i-- > block.begin;) {
+                    int id = copyAt[i];
+                    if (id >= 0) {
+                        const Copy& copy = copies[id];
+                        bool srcWritten = copy.src.isPseudo() && writtenAfter[copy.src.asPseudo()] == block.id;
+                        if (writtenAfter[copy.dst] != block.id && !srcWritten) survivingInto[copy.dst].push_back(id);
+                        note(copiedIn.try_emplace(pair(copy), -1).first->second, block.id);
+                    }
+                    forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole role) {
+                        if (!op.isPseudo()) return;
+                        if (role != OperandRole::Write) note(readIn[op.asPseudo()], block.id);
+                        if (role != OperandRole::Read) writtenAfter[op.asPseudo()] = block.id;
+                    });
+                }
+            }
+            auto elsewhere = [](int seen, int blockId) { return seen != -1 && seen != blockId; };
+
+            globalOf.assign(copies.size(), -1);
+            std::vector<bool> carried(pseudoCount, false);
+            std::vector<int> pending;
+            auto makeGlobal = [&](int id) {
+                if (globalOf[id] >= 0) return;
+                globalOf[id] = static_cast<int>(globals.size());
+                globals.push_back(id);
+                pending.push_back(id);
+            };
+            for (int p = 0; p < static_cast<int>(pseudoCount); ++p) {
+                for (int id : survivingInto[p]) {
+                    int block = copies[id].block;
+                    if ((forwardable(id) && elsewhere(readIn[p], block)) || elsewhere(copiedIn.at(pair(copies[id])), block)) {
+                        makeGlobal(id);
+                    }
+                }
+            }
+            while (!pending.empty()) {
+                int id = pending.back();
+                pending.pop_back();
+                const IROperand& src = copies[id].src;
+                if (!forwardable(id) || !src.isPseudo() || carried[src.asPseudo()]) continue;
+                carried[src.asPseudo()] = true;
+                for (int id : survivingInto[src.asPseudo()]) makeGlobal(id);
+            }
+        }
+
+        std::vector<Copy> copies;
+        std::vector<int> copyAt;      // copy defined by each instruction, or -1
+        std::vector<int> definitions; // number of definitions of each pseudo
+        std::vector<int> globalOf;    // index of each copy among the globals, or -1
+        std::vector<int> globals;
+        std::vector<std::vector<int>> mentionsGlobal; // global copies naming each pseudo
+        std::vector<std::vector<int>> globalsIn;      // global copies generated by each block
+    };
+
+    static bool propagate(IRFunction& fn, AnalysisManager& analyses) {
+        const CFG& cfg = analyses.cfg();
+        if (cfg.blocks.empty()) return false;
+        ReachingCopies copies(fn, cfg);
+        if (copies.empty()) return false;
+        auto in = copies.solve(fn, cfg);
+        auto reachable = cfg.reachable();
+
+        const Dominators& dominators = analyses.dominators();
+        std::vector<int> preorder;
+        for (const auto& block : cfg.blocks) {
+            if (reachable[block.id]) preorder.push_back(block.id);
+        }
+        std::sort(preorder.begin(), preorder.end(), [&](int a, int b) { return dominators.enter[a] < dominators.enter[b]; });
+
+        bool changed = false;
+        long forwarded = 0;
+        std::vector<bool> redundant(fn.body.size(), false);
+        ReachingCopies::Walk walk(copies, dominators, fn.pseudos.size());
+        for (int id : preorder) {
+            const auto& block = cfg.blocks[id];
+            walk.enter(block.id, in[block.id]);
+            for (size_t i = block.begin; i < block.end; ++i) {
+                auto& inst = fn.body[i];
+                // A copy whose effect already holds is redundant.
+                auto* m = std::get_if<IRMov>(&inst);
+                if (m && m->dst.isPseudo()) {
+                    int id = walk.reachingInto(m->dst.asPseudo());
+                    if (id >= 0 && copies.copy(id).src == m->src) {
+                        redundant[i] = true;
+                    }
+                    if (m->src.isPseudo()) {
+                        int back = walk.reachingInto(m->src.asPseudo());
+                        if (back >= 0 && copies.copy(back).src == m->dst) {
+                            redundant[i] = true;
+                        }
+                    }
+                }
+                // Rewriting reads leaves the writes, and so the transfer, unchanged.
+                forEachOperand(inst, [&](IROperand& op, OperandRole role) {
+                    if (role != OperandRole::Read || !op.isPseudo()) return;
+                    // Follow chains of copies (a = 4; b = a; c = b) back to their origin.
+                    const IROperand* origin = nullptr;
+                    for (int id = walk.reachingInto(op.asPseudo()); id >= 0 && copies.forwardable(id);) {
+                        origin = &copies.copy(id).src;
+                        id = origin->isPseudo() ? walk.reachingInto(origin->asPseudo()) : -1;
+                    }
+                    if (origin != nullptr) {
+                        op = *origin;
+                        ++forwarded;
+                        changed = true;
+                    }
+                });
+                walk.transfer(inst, i);
+            }
+        }
+        for (size_t i = 0; i < fn.body.size(); ++i) {
+            auto* m = std::get_if<IRMov>(&fn.body[i]);
+            if (redundant[i] || (m && m->src == m->dst)) {
+                fn.body[i] = IRNop{};
+                changed = true;
+            }
+        }
+        eraseNops(fn);
+        analyses.remarks().count("reads forwarded", forwarded);
+        return changed;
+    }
+
+    // Forwards `mov s, d` into every read of d it dominates when the copy is
+    // d's only definition and s is an immediate or a pseudo whose only
+    // definition dominates the copy. Both then hold the same value wherever
+    // d is read, so no dataflow is needed.
+    static bool forwardSingleDefinitions(IRFunction& fn, AnalysisManager& analyses) {
+        const CFG& cfg = analyses.cfg();
+        if (cfg.blocks.empty()) return false;
+        const Dominators& dominators = analyses.dominators();
+        std::vector<int> blockOf(fn.body.size());
+        for (const auto& block : cfg.blocks) {
+            for (size_t i = block.begin; i < block.end; ++i) blockOf[i] = block.id;
+        }
+        auto dominates = [&](size_t a, size_t b) {
+            return blockOf[a] == blockOf[b] ? a < b : dominators.dominates(blockOf[a], blockOf[b]);
+        };
+
+        DefUseChains chains = DefUseChains::build(fn);
+        bool changed = false;
+        long forwarded = 0;
+        for (size_t i = 0; i < fn.body.size(); ++i) {
+            auto* m = std::get_if<IRMov>(&fn.body[i]);
+            if (m == nullptr || !m->dst.isPseudo() || chains.defs(m->dst.asPseudo()).size() != 1) continue;
+            IROperand src = m->src;
+            IROperand dst = m->dst;
+            if (src.isPseudo()) {
+                const auto& srcDefs = chains.defs(src.asPseudo());
+                if (src == dst || srcDefs.size() != 1 || !dominates(srcDefs[0].inst, i)) continue;
+            } else if (!src.isImm()) {
+                continue;
+            }
+            std::vector<OperandRef> reached;
+            for (const auto& use : chains.uses(dst.asPseudo())) {
+                if (dominates(i, use.inst)) reached.push_back(use);
+            }
+            for (const auto& use : reached) chains.setOperand(use, src);
+            forwarded += static_cast<long>(reached.size());
+            changed |= !reached.empty();
+        }
+        analyses.remarks().count("reads forwarded", forwarded);
+        return changed;
+    }
+
+    // Renames `mov X, T ... mov T, Y` to compute directly into Y when T lives
+    // only between those two instructions and Y is untouched in between.
+    static bool coalesceTemporaries(IRFunction& fn, AnalysisManager& analyses) {
+        const CFG& cfg = analyses.cfg();
+        std::vector<int> blockOf(fn.body.size());
+        for (const auto& block : cfg.blocks) {
+            for (size_t i = block.begin; i < block.end; ++i) blockOf[i] = block.id;
+        }
+        DefUseChains chains = DefUseChains::build(fn);
+        auto mentions = [&](size_t index, IROperand pseudo) {
+            bool found = false;
+            forEachOperand(fn.body[index], [&](const IROperand& op, OperandRole) { found |= op == pseudo; });
+            return found;
+        };
+
+        bool changed = false;
+        long coalesced = 0;
+        std::vector<OperandRef> refs;
+        for (size_t i = 0; i < fn.body.size(); ++i) {
+            auto* first = std::get_if<IRMov>(&fn.body[i]);
+            if (first == nullptr || !first->dst.isPseudo()) continue;
+            IROperand temp = first->dst;
+
+            // Every reference to T lies in this block, from here on.
+            refs.clear();
+            size_t last = i;
+            bool confined = true;
+            for (const auto* list : {&chains.uses(temp.asPseudo()), &chains.defs(temp.asPseudo())}) {
+                for (const auto& ref : *list) {
+                    confined = ref.inst >= i && blockOf[ref.inst] == blockOf[i];
+                    if (!confined) break;
+                    last = std::max(last, ref.inst);
+                    refs.push_back(ref);
+                }
+                if (!confined) break;
+            }
+            if (!confined || last == i) continue;
+            auto* final = std::get_if<IRMov>(&fn.body[last]);
+            if (final == nullptr || !final->dst.isPseudo() || final->src != temp || final->dst == temp) continue;
+            IROperand dst = final->dst;
+
+            bool clobbered = false;
+            for (size_t k = i + 1; k < last && !clobbered; ++k) {
+                clobbered = mentions(k, dst);
+            }
+            if (clobbered) continue;
+
+            for (const auto& ref : refs) chains.setOperand(ref, dst);
+            ++coalesced;
+            changed = true;
+        }
+        for (size_t i = 0; i < fn.body.size(); ++i) {
+            auto* m = std::get_if<IRMov>(&fn.body[i]);
+            if (m && m->src == m->dst) {
+                chains.erase(i);
+                changed = true;
+            }
+        }
+        eraseNops(fn);
+        analyses.remarks().count("temporaries coalesced", coalesced);
+        return changed;
+    }
+}
+
+bool CopyPropagation::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool CopyPropagation::run(IRFunction& fn, AnalysisManager& analyses) {
+    bool changed = false;
+    auto step = [&](bool stepChanged, PreservedAnalyses preserved = PreservedAnalyses::none()) {
+        if (stepChanged) analyses.invalidate(preserved);
+        changed |= stepChanged;
+    };
+    // Coalesce first: forwarding `mov tmp, v` would otherwise rewrite later
+    // reads of v into reads of tmp and keep both alive.
+    step(coalesceTemporaries(fn, analyses));
+    // Copies forwarded here leave the dataflow below fewer copies to track.
+    // Only operands change, so the blocks stay as they were.
+    step(forwardSingleDefinitions(fn, analyses), PreservedAnalyses::controlFlowOnly());
+    step(removeUnusedPseudoDefinitions(fn));
+    step(propagate(fn, analyses));
+    step(removeUnusedPseudoDefinitions(fn));
+    return changed;
+}
+
+bool CopyPropagation::runSparse(IRFunction& fn, AnalysisManager& analyses) {
+    bool changed = false;
+    auto step = [&](bool stepChanged, PreservedAnalyses preserved = PreservedAnalyses::none()) {
+        if (stepChanged) analyses.invalidate(preserved);
+        changed |= stepChanged;
+    };
+    step(coalesceTemporaries(fn, analyses));
+    step(forwardSingleDefinitions(fn, analyses), PreservedAnalyses::controlFlowOnly());
+    step(removeUnusedPseudoDefinitions(fn));
+    return changed;
+}
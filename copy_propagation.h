@@ -0,0 +1,23 @@
+#ifndef COMPILER_COPY_PROPAGATION_H
+#define COMPILER_COPY_PROPAGATION_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class CopyPropagation {
+public:
+    // Forwards the source of `mov src, pseudo` copies into later reads of the
+    // pseudo wherever the copy reaches on every path, coalesces temporaries
+    // that only shuttle a value into another pseudo, and deletes the copies
+    // that become dead. Returns true if the function changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+
+    // The same without the dataflow over copies, whose sets grow with blocks
+    // times copies: only copies that are the single definition of their
+    // pseudo are forwarded, along def-use chains.
+    static bool runSparse(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_COPY_PROPAGATION_H
@@ -0,0 +1,125 @@
+#ifndef COMPILER_DATAFLOW_H
+#define COMPILER_DATAFLOW_H
+
+#include <vector>
+#include "bit_vector.h"
+#include "cfg.h"
+
+enum class DataflowDirection { Forward, Backward };
+enum class DataflowMeet { Union, Intersection };
+
+// Values at the start and at the end of every block, in program order
+// whatever the direction of the problem.
+template <typename Value>
+struct DataflowResult {
+    std::vector<Value> in;
+    std::vector<Value> out;
+};
+
+// Solves a monotone dataflow problem over the blocks of a CFG. The problem
+// supplies the lattice and the block transfer functions:
+//
+//   using Value = ...;
+//   DataflowDirection direction() const;
+//   Value boundary() const; // flowing into the entry, or out of blocks without successors
+//   Value top() const;      // initial value of every block; identity of meet
+//   void meet(Value& into, const Value& other) const;
+//   // output = f_block(input); returns true if output changed.
+//   bool transfer(int block, const Value& input, Value& output) const;
+//
+// Blocks are visited in reverse post-order for forward problems and in
+// post-order for backward ones, so that most values settle in the first
+// sweep; later sweeps only revisit blocks whose incoming value changed.
+// Forward problems skip unreachable blocks and the edges leaving them, whose
+// values stay top. Backward problems also solve unreachable blocks, last.
+template <typename Problem>
+DataflowResult<typename Problem::Value> solveDataflow(const CFG& cfg, const Problem& problem) {
+    using Value = typename Problem::Value;
+    bool forward = problem.direction() == DataflowDirection::Forward;
+    size_t n = cfg.blocks.size();
+    const Value top = problem.top();
+    const Value boundary = problem.boundary();
+    DataflowResult<Value> result{std::vector<Value>(n, top), std::vector<Value>(n, top)};
+    auto& before = forward ? result.in : result.out;
+    auto& after = forward ? result.out : result.in;
+
+    auto reachable = cfg.reachable();
+    std::vector<int> order = forward ? cfg.reversePostOrder() : cfg.postOrder();
+    if (!forward) {
+        for (const auto& block : cfg.blocks) {
+            if (!reachable[block.id]) order.push_back(block.id);
+        }
+    }
+    std::vector<int> position(n, -1);
+    for (size_t p = 0; p < order.size(); ++p) position[order[p]] = static_cast<int>(p);
+
+    // Positions in `order` of the blocks left to visit.
+    BitVector pending(static_cast<int>(order.size()));
+    pending.setAll();
+    bool again = true;
+    while (again) {
+        again = false;
+        for (size_t p = 0; p < order.size(); ++p) {
+            if (!pending.test(static_cast<int>(p))) continue;
+            pending.reset(static_cast<int>(p));
+            int id = order[p];
+            const auto& block = cfg.blocks[id];
+            const auto& sources = forward ? block.preds : block.succs;
+            Value& input = before[id];
+            bool atBoundary = forward ? id == 0 : block.succs.empty();
+            input = atBoundary ? boundary : top;
+            for (int source : sources) {
+                if (!forward || reachable[source]) problem.meet(input, after[source]);
+            }
+            if (!problem.transfer(id, input, after[id])) continue;
+            for (int next : forward ? block.succs : block.preds) {
+                if (position[next] < 0) continue;
+                pending.set(position[next]);
+                again = again || position[next] <= static_cast<int>(p);
+            }
+        }
+    }
+    return result;
+}
+
+// A problem on bit vectors whose block transfer is gen | (x & ~kill), such
+// as liveness (backward, union) or available copies (forward,
+// intersection). The boundary is the empty set.
+class GenKillProblem {
+public:
+    using Value = BitVector;
+
+    GenKillProblem(DataflowDirection direction, DataflowMeet meetOperator, size_t blocks, int size)
+        : flow(direction), meetOperator(meetOperator), gens(blocks, BitVector(size)),
+          kills(blocks, BitVector(size)), size(size) {}
+
+    BitVector& gen(int block) { return gens[block]; }
+    BitVector& kill(int block) { return kills[block]; }
+
+    DataflowDirection direction() const { return flow; }
+    BitVector boundary() const { return BitVector(size); }
+    BitVector top() const {
+        BitVector value(size);
+        if (meetOperator == DataflowMeet::Intersection) value.setAll();
+        return value;
+    }
+    void meet(BitVector& into, const BitVector& other) const {
+        if (meetOperator == DataflowMeet::Union) {
+            into.unionWith(other);
+        } else {
+            into.intersectWith(other);
+        }
+    }
+    bool transfer(int block, const BitVector& input, BitVector& output) const {
+        return output.assignGenKill(input, gens[block], kills[block]);
+    }
+
+private:
+    DataflowDirection flow;
+    DataflowMeet meetOperator;
+    std::vector<BitVector> gens;
+    std::vector<BitVector> kills;
+    int size;
+};
+
+#endif // COMPILER_DATAFLOW_H
@@ -0,0 +1,98 @@
+#include "dead_code.h"
+
+#include <utility>
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "def_use.h"
+#include "ir_utils.h"
+#include "liveness.h"
+
+namespace {
+    // idiv may trap and jumps/ret/labels shape control flow; everything else
+    // only produces values.
+    static bool isRemovableKind(const IRInstruction& inst) {
+        return std::get_if<IRMov>(&inst) != nullptr
+            || std::get_if<IRUnary>(&inst) != nullptr
+            || std::get_if<IRBinary>(&inst) != nullptr
+            || std::get_if<IRSetCC>(&inst) != nullptr
+            || std::get_if<IRCMov>(&inst) != nullptr
+            || std::get_if<IRCmp>(&inst) != nullptr
+            || std::get_if<IRCdq>(&inst) != nullptr;
+    }
+
+    static bool isDead(const IRInstruction& inst, const LocationIndex& locations,
+                       const BitVector& liveAfter, bool flagsLive) {
+        if (!isRemovableKind(inst) || (writesFlags(inst) && flagsLive)) {
+            return false;
+        }
+        bool dead = true;
+        forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+            if (role == OperandRole::Read) return;
+            int loc = locations.find(op);
+            // Writes to memory that is not a pseudo are always observable.
+            if (loc < 0 || liveAfter.test(loc)) dead = false;
+        });
+        for (IRRegister r : implicitWrites(inst)) {
+            if (liveAfter.test(locations.reg(r))) dead = false;
+        }
+        return dead;
+    }
+
+    // Erases the instructions whose results are dead on every path, then
+    // whatever only fed them.
+    static bool sweep(IRFunction& fn, DefUseChains& chains, AnalysisManager& analyses) {
+        const CFG& cfg = analyses.cfg();
+        const LocationIndex& locations = analyses.locations();
+        const Liveness& liveness = analyses.liveness();
+
+        std::vector<size_t> dead;
+        BitVector live(locations.size());
+        for (const auto& block : cfg.blocks) {
+            // Flags never live across an edge, so they start dead at the block end.
+            bool flagsLive = false;
+            liveness.forEachLiveOut(block.id, [&](int loc) { live.set(loc); });
+            for (size_t i = block.end; i-- > block.begin;) {
+                const auto& inst = fn.body[i];
+                if (isDead(inst, locations, live, flagsLive)) {
+                    dead.push_back(i);
+                    continue;
+                }
+                Liveness::transfer(inst, locations, live);
+                if (writesFlags(inst)) flagsLive = false;
+                if (readsFlags(inst)) flagsLive = true;
+            }
+            // Skipping dead instructions only leaves fewer uses, so what
+            // remains is within the live-in set.
+            liveness.forEachLiveIn(block.id, [&](int loc) { live.reset(loc); });
+        }
+        std::vector<int> fed;
+        for (size_t i : dead) {
+            forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole role) {
+                if (op.isPseudo() && role == OperandRole::Read) fed.push_back(op.asPseudo());
+            });
+            chains.erase(i);
+        }
+        chains.eraseUnusedDefinitions(std::move(fed));
+        return !dead.empty();
+    }
+}
+
+bool DeadCodeElimination::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool DeadCodeElimination::run(IRFunction& fn, AnalysisManager& analyses) {
+    DefUseChains chains = DefUseChains::build(fn);
+    bool changed = false;
+    // A definition can also die because a later one overwrites the value
+    // before every use, which only a new liveness sweep notices. Erased
+    // instructions stay as nops until the end, so the blocks survive sweeps.
+    while (sweep(fn, chains, analyses)) {
+        analyses.invalidate(PreservedAnalyses::controlFlowOnly());
+        changed = true;
+    }
+    eraseNops(fn);
+    return changed;
+}
@@ -0,0 +1,18 @@
+#ifndef COMPILER_DEAD_CODE_H
+#define COMPILER_DEAD_CODE_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class DeadCodeElimination {
+public:
+    // Deletes side-effect-free instructions (moves, arithmetic other than
+    // idiv, setcc, cmp, cdq) whose results are dead according to liveness,
+    // including stores to variables that are overwritten before being read.
+    // Returns true if the function changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_DEAD_CODE_H
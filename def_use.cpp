@@ -0,0 +1,123 @@
+#include "def_use.h"
+
+DefUseChains DefUseChains::build(IRFunction& fn) {
+    DefUseChains chains(fn);
+    chains.useLists.resize(fn.pseudos.size());
+    chains.defLists.resize(fn.pseudos.size());
+    chains.positions.resize(fn.body.size());
+    for (size_t i = 0; i < fn.body.size(); ++i) {
+        chains.link(i);
+    }
+    return chains;
+}
+
+std::vector<OperandRef>& DefUseChains::listFor(const IROperand& op, OperandRole role) {
+    // Passes may add pseudos after the chains were built.
+    if (static_cast<size_t>(op.asPseudo()) >= useLists.size()) {
+        useLists.resize(function->pseudos.size());
+        defLists.resize(function->pseudos.size());
+    }
+    return role == OperandRole::Read ? useLists[op.asPseudo()] : defLists[op.asPseudo()];
+}
+
+void DefUseChains::link(size_t index) {
+    auto& slots = positions[index];
+    slots.fill(-1);
+    int slot = 0;
+    forEachOperand(function->body[index], [&](const IROperand& op, OperandRole role) {
+        if (op.isPseudo()) {
+            auto& list = listFor(op, role);
+            slots[slot] = static_cast<int>(list.size());
+            list.push_back(OperandRef{index, slot});
+        }
+        ++slot;
+    });
+}
+
+void DefUseChains::unlink(size_t index) {
+    auto& slots = positions[index];
+    int slot = 0;
+    forEachOperand(function->body[index], [&](const IROperand& op, OperandRole role) {
+        if (op.isPseudo()) {
+            // Swap the last entry into the vacated position.
+            auto& list = listFor(op, role);
+            int position = slots[slot];
+            OperandRef moved = list.back();
+            list[position] = moved;
+            positions[moved.inst][moved.slot] = position;
+            list.pop_back();
+            slots[slot] = -1;
+        }
+        ++slot;
+    });
+}
+
+IROperand DefUseChains::operand(OperandRef ref) const {
+    IROperand result;
+    int slot = 0;
+    forEachOperand(function->body[ref.inst], [&](const IROperand& op, OperandRole) {
+        if (slot++ == ref.slot) result = op;
+    });
+    return result;
+}
+
+void DefUseChains::setOperand(OperandRef ref, IROperand value) {
+    unlink(ref.inst);
+    int slot = 0;
+    forEachOperand(function->body[ref.inst], [&](IROperand& op, OperandRole) {
+        if (slot++ == ref.slot) op = value;
+    });
+    link(ref.inst);
+}
+
+void DefUseChains::replaceAllUses(IROperand from, IROperand to) {
+    if (!from.isPseudo() || from == to) return;
+    const auto& list = useLists[from.asPseudo()];
+    while (!list.empty()) {
+        setOperand(list.back(), to);
+    }
+}
+
+void DefUseChains::erase(size_t index) {
+    unlink(index);
+    function->body[index] = IRNop{};
+}
+
+void DefUseChains::replace(size_t index, IRInstruction inst) {
+    unlink(index);
+    function->body[index] = inst;
+    link(index);
+}
+
+void DefUseChains::insert(size_t index, IRInstruction inst) {
+    for (auto* lists : {&useLists, &defLists}) {
+        for (auto& list : *lists) {
+            for (auto& ref : list) {
+                if (ref.inst >= index) ++ref.inst;
+            }
+        }
+    }
+    function->body.insert(function->body.begin() + static_cast<std::ptrdiff_t>(index), inst);
+    positions.insert(positions.begin() + static_cast<std::ptrdiff_t>(index), {});
+    link(index);
+}
+
+bool DefUseChains::eraseUnusedDefinitions(std::vector<int> candidates) {
+    bool changed = false;
+    while (!candidates.empty()) {
+        int pseudo = candidates.back();
+        candidates.pop_back();
+        if (static_cast<size_t>(pseudo) >= useLists.size() || !useLists[pseudo].empty()) continue;
+        // Every definition is a Mov, Unary, Binary or SetCC writing only the pseudo.
+        auto& defs = defLists[pseudo];
+        while (!defs.empty()) {
+            size_t index = defs.back().inst;
+            forEachOperand(function->body[index], [&](const IROperand& op, OperandRole role) {
+                if (op.isPseudo() && role == OperandRole::Read) candidates.push_back(op.asPseudo());
+            });
+            erase(index);
+            changed = true;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,69 @@
+#ifndef COMPILER_DEF_USE_H
+#define COMPILER_DEF_USE_H
+
+#include <array>
+#include <vector>
+#include "ir.h"
+#include "ir_utils.h"
+
+// One explicit operand of an instruction: the slot-th operand that
+// forEachOperand visits in fn.body[inst].
+struct OperandRef {
+    size_t inst = 0;
+    int slot = 0;
+};
+
+// Use and definition lists of every pseudo, kept up to date while a pass
+// rewrites operands or erases, replaces and inserts instructions through
+// this class.
+//
+// A Read operand is a use. A Write or ReadWrite operand is a definition: an
+// in-place update (add $1, x) only feeds x itself, the same view that
+// removeUnusedPseudoDefinitions takes. Lists are in no particular order.
+//
+// Erased instructions are left as IRNop so that indices stay stable; the
+// chains are only valid until the body is compacted or changed behind
+// their back.
+class DefUseChains {
+public:
+    static DefUseChains build(IRFunction& fn);
+
+    const std::vector<OperandRef>& uses(int pseudo) const { return useLists[pseudo]; }
+    const std::vector<OperandRef>& defs(int pseudo) const { return defLists[pseudo]; }
+
+    IROperand operand(OperandRef ref) const;
+    // Rewrites one operand, moving it to the lists of its new value.
+    void setOperand(OperandRef ref, IROperand value);
+    // Rewrites every use of `from` to read `to` instead. Definitions of
+    // `from` are left alone.
+    void replaceAllUses(IROperand from, IROperand to);
+
+    void erase(size_t index);
+    void replace(size_t index, IRInstruction inst);
+    // Shifts every later instruction, and so costs a pass over all chains;
+    // passes inserting many instructions should rebuild instead.
+    void insert(size_t index, IRInstruction inst);
+
+    // Erases every definition of the given pseudos that nothing uses, then of
+    // the pseudos those definitions read, and so on. Returns true if
+    // anything was erased.
+    bool eraseUnusedDefinitions(std::vector<int> candidates);
+
+private:
+    static constexpr int kMaxOperands = 2;
+
+    explicit DefUseChains(IRFunction& fn) : function(&fn) {}
+
+    void link(size_t index);
+    void unlink(size_t index);
+    std::vector<OperandRef>& listFor(const IROperand& op, OperandRole role);
+
+    IRFunction* function;
+    std::vector<std::vector<OperandRef>> useLists;
+    std::vector<std::vector<OperandRef>> defLists;
+    // Per instruction and slot: position of the slot in its list, -1 if the
+    // operand is not a pseudo.
+    std::vector<std::array<int, kMaxOperands>> positions;
+};
+
+#endif // COMPILER_DEF_USE_H
@@ -0,0 +1,60 @@
+#include "frame_layout.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "cfg.h"
+#include "ir_utils.h"
+#include "live_intervals.h"
+
+namespace {
+    constexpr int kSlotSize = 4;
+    constexpr int kFrameAlignment = 16;
+}
+
+bool FrameLayout::run(IRFunction& fn) {
+    CFG cfg = CFG::build(fn);
+    LocationIndex locations(fn);
+    if (locations.size() == kIRRegisterCount) return false;
+    auto intervals = buildLiveIntervals(fn, cfg, locations);
+
+    std::vector<int> order;
+    for (int loc = kIRRegisterCount; loc < locations.size(); ++loc) {
+        if (!intervals[loc].empty()) order.push_back(loc);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](int a, int b) { return intervals[a].start() < intervals[b].start(); });
+
+    // Interval-graph coloring by extent: visiting intervals by start and
+    // reusing any slot whose occupant has ended needs the fewest slots.
+    std::vector<int> slot(locations.size(), -1);
+    using Occupied = std::pair<int, int>; // end, slot
+    std::priority_queue<Occupied, std::vector<Occupied>, std::greater<>> occupied;
+    std::vector<int> freeSlots;
+    int slots = 0;
+    for (int loc : order) {
+        while (!occupied.empty() && occupied.top().first <= intervals[loc].start()) {
+            freeSlots.push_back(occupied.top().second);
+            occupied.pop();
+        }
+        if (freeSlots.empty()) {
+            slot[loc] = slots++;
+        } else {
+            slot[loc] = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        occupied.emplace(intervals[loc].end(), slot[loc]);
+    }
+
+    for (auto& inst : fn.body) {
+        forEachOperand(inst, [&](IROperand& op, OperandRole) {
+            if (op.isPseudo()) op = IROperand::stack(-kSlotSize * (slot[locations.find(op)] + 1));
+        });
+    }
+    int frameSize = slots * kSlotSize;
+    frameSize = (frameSize + kFrameAlignment - 1) / kFrameAlignment * kFrameAlignment;
+    fn.body.insert(fn.body.begin(), IRAllocateStack(frameSize));
+    return true;
+}
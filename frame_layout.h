@@ -0,0 +1,17 @@
+#ifndef COMPILER_FRAME_LAYOUT_H
+#define COMPILER_FRAME_LAYOUT_H
+
+#include "ir.h"
+
+class FrameLayout {
+public:
+    // Gives every pseudo left after register allocation a 4-byte slot below
+    // %rbp, rewriting it to a Stack operand, and puts an AllocateStack for
+    // the frame, rounded up to 16 bytes, at the start of the function.
+    // Pseudos whose live intervals do not overlap share a slot: the frame
+    // needs only as many slots as values are live at once. Returns true if
+    // the function changed.
+    static bool run(IRFunction& fn);
+};
+
+#endif // COMPILER_FRAME_LAYOUT_H
@@ -0,0 +1,278 @@
+#include "graph_coloring.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "ir_utils.h"
+#include "liveness.h"
+#include "loops.h"
+#include "register_allocation.h"
+
+namespace {
+    // Uses nested deeper than this weigh no more than at this depth.
+    constexpr int kMaxWeightedDepth = 6;
+
+    struct Move {
+        int a;
+        int b;
+        double weight;
+    };
+
+    // Nodes are the locations of a LocationIndex; the hard registers are
+    // precolored and never simplified.
+    class Allocator {
+    public:
+        Allocator(IRFunction& fn, AnalysisManager& analyses)
+            : fn(fn), analyses(analyses), cfg(analyses.cfg()), locations(analyses.locations()),
+              colors(static_cast<int>(allocatableRegisters().size())),
+              adjacency(locations.size()), cost(locations.size(), 0.0),
+              partners(locations.size()), parent(locations.size()) {
+            for (int loc = 0; loc < locations.size(); ++loc) parent[loc] = loc;
+        }
+
+        bool run() {
+            build();
+            coalesce();
+            simplify();
+            return select();
+        }
+
+    private:
+        IRFunction& fn;
+        AnalysisManager& analyses;
+        const CFG& cfg;
+        const LocationIndex& locations;
+        int colors;
+        std::vector<std::unordered_set<int>> adjacency;
+        std::vector<double> cost;
+        std::vector<Move> moves;
+        std::vector<std::vector<int>> partners;
+        std::vector<int> parent;
+        std::vector<int> stack;
+        std::unordered_map<int, IRRegister> color;
+
+        bool precolored(int loc) const { return locations.isRegister(loc); }
+
+        int find(int loc) {
+            while (parent[loc] != loc) {
+                parent[loc] = parent[parent[loc]];
+                loc = parent[loc];
+            }
+            return loc;
+        }
+
+        void addEdge(int a, int b) {
+            if (a == b || (precolored(a) && precolored(b))) return;
+            adjacency[a].insert(b);
+            adjacency[b].insert(a);
+        }
+
+        // Precolored nodes count as having unbounded degree.
+        bool significant(int loc) const {
+            return precolored(loc) || static_cast<int>(adjacency[loc].size()) >= colors;
+        }
+
+        void build() {
+            const LoopForest& forest = analyses.loops();
+            const Liveness& liveness = analyses.liveness();
+            std::vector<int> uses;
+            std::vector<int> defs;
+            for (const auto& block : cfg.blocks) {
+                double weight = std::pow(10.0, std::min(forest.depth(block.id), kMaxWeightedDepth));
+                liveness.forEachInstructionBackward(block.id, [&](size_t i, const BitVector& liveAfter) {
+                    const auto& inst = fn.body[i];
+                    Liveness::usesAndDefs(inst, locations, uses, defs);
+                    // A copy does not make its source interfere with its
+                    // destination: both may share a register.
+                    int source = -1;
+                    if (auto* m = std::get_if<IRMov>(&inst)) {
+                        source = locations.find(m->src);
+                        int dst = locations.find(m->dst);
+                        if (source >= 0 && dst >= 0 && source != dst) {
+                            moves.push_back(Move{source, dst, weight});
+                        }
+                    }
+                    for (int d : defs) {
+                        liveAfter.forEach([&](int live) {
+                            if (live != source) addEdge(d, live);
+                        });
+                    }
+                    for (int loc : uses) cost[loc] += weight;
+                    for (int loc : defs) cost[loc] += weight;
+                });
+            }
+        }
+
+        // Briggs: the merged node has fewer than K significant neighbors.
+        bool briggs(int a, int b) const {
+            std::unordered_set<int> neighbors(adjacency[a].begin(), adjacency[a].end());
+            neighbors.insert(adjacency[b].begin(), adjacency[b].end());
+            int high = 0;
+            for (int t : neighbors) {
+                if (significant(t)) ++high;
+            }
+            return high < colors;
+        }
+
+        // George: every neighbor of the pseudo already conflicts with the
+        // register, or is insignificant.
+        bool george(int reg, int pseudo) const {
+            for (int t : adjacency[pseudo]) {
+                if (precolored(t) || !significant(t) || adjacency[t].count(reg)) continue;
+                return false;
+            }
+            return true;
+        }
+
+        void merge(int into, int from) {
+            for (int t : adjacency[from]) {
+                adjacency[t].erase(from);
+                addEdge(into, t);
+            }
+            adjacency[from].clear();
+            cost[into] += cost[from];
+            parent[from] = into;
+        }
+
+        bool allocatable(int loc) const {
+            const auto& regs = allocatableRegisters();
+            return std::find(regs.begin(), regs.end(), static_cast<IRRegister>(loc)) != regs.end();
+        }
+
+        void coalesce() {
+            std::stable_sort(moves.begin(), moves.end(),
+                             [](const Move& x, const Move& y) { return x.weight > y.weight; });
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (const auto& move : moves) {
+                    int a = find(move.a);
+                    int b = find(move.b);
+                    if (a == b || adjacency[a].count(b)) continue;
+                    if (precolored(b)) std::swap(a, b);
+                    if (precolored(b)) continue;
+                    if (precolored(a) ? allocatable(a) && george(a, b) : briggs(a, b)) {
+                        merge(a, b);
+                        changed = true;
+                    }
+                }
+            }
+            for (const auto& move : moves) {
+                int a = find(move.a);
+                int b = find(move.b);
+                if (a == b) continue;
+                partners[a].push_back(b);
+                partners[b].push_back(a);
+            }
+        }
+
+        // Removes nodes of degree < K onto the stack; when none is left,
+        // optimistically pushes the cheapest node per remaining neighbor.
+        void simplify() {
+            std::vector<int> degree(locations.size(), 0);
+            std::vector<bool> removed(locations.size(), false);
+            std::vector<int> low;
+            using Candidate = std::pair<double, int>;
+            std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> spill;
+            auto metric = [&](int loc) { return cost[loc] / std::max(degree[loc], 1); };
+            int remaining = 0;
+            for (int loc = kIRRegisterCount; loc < locations.size(); ++loc) {
+                if (find(loc) != loc) continue;
+                degree[loc] = static_cast<int>(adjacency[loc].size());
+                ++remaining;
+                if (degree[loc] < colors) {
+                    low.push_back(loc);
+                } else {
+                    spill.emplace(metric(loc), loc);
+                }
+            }
+            auto remove = [&](int loc) {
+                removed[loc] = true;
+                stack.push_back(loc);
+                --remaining;
+                for (int t : adjacency[loc]) {
+                    if (precolored(t) || removed[t]) continue;
+                    if (--degree[t] == colors - 1) low.push_back(t);
+                }
+            };
+            while (remaining > 0) {
+                if (!low.empty()) {
+                    int loc = low.back();
+                    low.pop_back();
+                    if (!removed[loc]) remove(loc);
+                    continue;
+                }
+                // Degrees only fall, so a stale entry's metric only grows.
+                auto [key, loc] = spill.top();
+                spill.pop();
+                if (removed[loc]) continue;
+                if (key != metric(loc)) {
+                    spill.emplace(metric(loc), loc);
+                    continue;
+                }
+                remove(loc);
+            }
+        }
+
+        std::optional<IRRegister> colorOf(int loc) const {
+            if (precolored(loc)) return static_cast<IRRegister>(loc);
+            auto it = color.find(loc);
+            if (it == color.end()) return std::nullopt;
+            return it->second;
+        }
+
+        bool select() {
+            const auto& regs = allocatableRegisters();
+            while (!stack.empty()) {
+                int loc = stack.back();
+                stack.pop_back();
+                std::vector<bool> taken(kIRRegisterCount, false);
+                for (int t : adjacency[loc]) {
+                    if (auto c = colorOf(t)) taken[static_cast<int>(*c)] = true;
+                }
+                std::optional<IRRegister> choice;
+                // Prefer a register a move partner already holds, so the move disappears.
+                for (int p : partners[loc]) {
+                    auto c = colorOf(find(p));
+                    if (c && !taken[static_cast<int>(*c)] && allocatable(static_cast<int>(*c))) {
+                        choice = c;
+                        break;
+                    }
+                }
+                for (size_t r = 0; r < regs.size() && !choice; ++r) {
+                    if (!taken[static_cast<int>(regs[r])]) choice = regs[r];
+                }
+                if (choice) color[loc] = *choice;
+            }
+
+            RegisterAssignment assignment(fn.pseudos.size());
+            bool assigned = false;
+            for (int loc = kIRRegisterCount; loc < locations.size(); ++loc) {
+                assignment[locations.pseudoAt(loc)] = colorOf(find(loc));
+                assigned = assigned || assignment[locations.pseudoAt(loc)];
+            }
+            reportAssignment(fn, assignment, analyses.remarks());
+            if (!assigned) return false;
+            assignRegisters(fn, assignment);
+            return true;
+        }
+    };
+}
+
+bool GraphColoringAllocator::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool GraphColoringAllocator::run(IRFunction& fn, AnalysisManager& analyses) {
+    if (analyses.cfg().blocks.empty()) return false;
+    Allocator allocator(fn, analyses);
+    return allocator.run();
+}
@@ -0,0 +1,22 @@
+#ifndef COMPILER_GRAPH_COLORING_H
+#define COMPILER_GRAPH_COLORING_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class GraphColoringAllocator {
+public:
+    // Chaitin-Briggs register allocation. Builds the interference graph from
+    // liveness, conservatively coalesces moves (Briggs' test between pseudos,
+    // George's test against AX and DX), simplifies with optimistic spilling
+    // ordered by use counts weighted by loop depth, and rewrites colored
+    // pseudos to hard registers. Pseudos left uncolored keep their stack
+    // slots, which the code generator already addresses through its scratch
+    // registers, so no spill code is needed. Returns true if the function
+    // changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_GRAPH_COLORING_H
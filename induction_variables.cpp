@@ -0,0 +1,312 @@
+#include "induction_variables.h"
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "ir_utils.h"
+#include "loops.h"
+
+namespace {
+    struct BasicIV {
+        IROperand pseudo;
+        size_t update = 0;             // index of `add step, pseudo` in the loop
+        IROperand step;
+    };
+
+    // `mov a, t; mul b, t` in the loop where {a, b} = {iv, factor}.
+    struct Product {
+        size_t mov = 0;
+        const BasicIV* iv = nullptr;
+        IROperand factor;
+    };
+
+    static std::optional<int> fitsInt(int64_t v) {
+        if (v < std::numeric_limits<int>::min() || v > std::numeric_limits<int>::max()) return std::nullopt;
+        return static_cast<int>(v);
+    }
+
+    class LoopReducer {
+    public:
+        LoopReducer(IRFunction& fn, const CFG& cfg, const Dominators& dominators,
+                    const LoopForest& forest, const Loop& loop)
+            : fn(fn), cfg(cfg), dominators(dominators), forest(forest), loop(loop) {
+            for (int id : loop.blocks) {
+                const auto& block = cfg.blocks[id];
+                for (size_t i = block.begin; i < block.end; ++i) {
+                    inLoop[i] = id;
+                    forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole role) {
+                        if (op.isPseudo() && role != OperandRole::Read) definitions[op.asPseudo()].push_back(i);
+                    });
+                }
+            }
+        }
+
+        // Multiplications strength-reduced by the last successful run().
+        size_t reduced() const { return products.size(); }
+
+        bool run() {
+            findBasicIVs();
+            findProducts();
+            if (products.empty()) return false;
+            rewrite();
+            return true;
+        }
+
+    private:
+        IRFunction& fn;
+        const CFG& cfg;
+        const Dominators& dominators;
+        const LoopForest& forest;
+        const Loop& loop;
+        std::map<size_t, int> inLoop; // instruction index -> block
+        std::map<int, std::vector<size_t>> definitions; // pseudo -> its writes in the loop
+        std::map<int, BasicIV> ivs;
+        std::vector<Product> products;
+
+        bool isInvariant(const IROperand& op) const {
+            if (op.isImm()) return true;
+            return op.isPseudo() && definitions.count(op.asPseudo()) == 0;
+        }
+
+        bool flagsDeadAfter(size_t index) const {
+            const auto& block = cfg.blocks[inLoop.at(index)];
+            for (size_t i = index + 1; i < block.end; ++i) {
+                if (readsFlags(fn.body[i])) return false;
+                if (writesFlags(fn.body[i])) return true;
+            }
+            return true;
+        }
+
+        void findBasicIVs() {
+            for (const auto& [pseudo, defs] : definitions) {
+                if (defs.size() != 1) continue;
+                auto* b = std::get_if<IRBinary>(&fn.body[defs[0]]);
+                if (b == nullptr || !isInvariant(b->src) || !flagsDeadAfter(defs[0])) continue;
+                IROperand step;
+                if (b->op == IRBinaryOperator::Add) {
+                    step = b->src;
+                } else if (b->op == IRBinaryOperator::Sub && b->src.isImm()
+                           && b->src.asImm() != std::numeric_limits<int>::min()) {
+                    step = IROperand::imm(-b->src.asImm());
+                } else {
+                    continue;
+                }
+                ivs.emplace(pseudo, BasicIV{IROperand::pseudo(pseudo), defs[0], step});
+            }
+        }
+
+        void findProducts() {
+            for (const auto& [index, block] : inLoop) {
+                size_t next = index + 1;
+                if (inLoop.count(next) == 0 || inLoop.at(next) != block) continue;
+                auto* m = std::get_if<IRMov>(&fn.body[index]);
+                auto* mul = std::get_if<IRBinary>(&fn.body[next]);
+                if (!m || !mul || mul->op != IRBinaryOperator::Mul || !flagsDeadAfter(next)) continue;
+                if (!m->dst.isPseudo() || m->dst != mul->dst || ivs.count(m->dst.asPseudo())) continue;
+                IROperand factor;
+                const BasicIV* iv = nullptr;
+                if (m->src.isPseudo() && ivs.count(m->src.asPseudo()) && isInvariant(mul->src)) {
+                    iv = &ivs.at(m->src.asPseudo());
+                    factor = mul->src;
+                } else if (mul->src.isPseudo() && ivs.count(mul->src.asPseudo()) && isInvariant(m->src)) {
+                    iv = &ivs.at(mul->src.asPseudo());
+                    factor = m->src;
+                }
+                if (iv == nullptr) continue;
+                products.push_back(Product{index, iv, factor});
+            }
+        }
+
+        void rewrite() {
+            std::vector<IRInstruction> preheader;
+            // Instructions to append after each basic IV update, keyed by the update's index.
+            std::map<size_t, std::vector<IRInstruction>> afterUpdate;
+            std::map<std::pair<IROperand, IROperand>, IROperand> reduced; // (iv, factor) -> reduced IV
+            std::optional<std::pair<IROperand, int>> lftrCandidate; // iv -> reduced with constant factor
+
+            for (auto& product : products) {
+                const BasicIV& iv = *product.iv;
+                auto key = std::make_pair(iv.pseudo, product.factor);
+                auto it = reduced.find(key);
+                if (it == reduced.end()) {
+                    IROperand temp = makePassTemp(fn, "iv");
+                    // temp = iv * factor on entry; temp += step * factor per update.
+                    preheader.push_back(IRMov(iv.pseudo, temp));
+                    preheader.push_back(IRBinary(IRBinaryOperator::Mul, product.factor, temp));
+                    IROperand increment;
+                    if (iv.step.isImm() && product.factor.isImm()) {
+                        int64_t wide = static_cast<int64_t>(iv.step.asImm()) * product.factor.asImm();
+                        increment = IROperand::imm(static_cast<int>(static_cast<uint32_t>(wide)));
+                    } else {
+                        increment = makePassTemp(fn, "iv.step");
+                        preheader.push_back(IRMov(iv.step, increment));
+                        preheader.push_back(IRBinary(IRBinaryOperator::Mul, product.factor, increment));
+                    }
+                    afterUpdate[iv.update].push_back(
+                        IRBinary(IRBinaryOperator::Add, increment, temp));
+                    it = reduced.emplace(key, temp).first;
+                    if (product.factor.isImm() && product.factor.asImm() != 0 && !lftrCandidate) {
+                        lftrCandidate = std::make_pair(iv.pseudo, product.factor.asImm());
+                    }
+                }
+                auto* m = std::get_if<IRMov>(&fn.body[product.mov]);
+                fn.body[product.mov] = IRMov(it->second, m->dst);
+                fn.body[product.mov + 1] = IRNop{};
+            }
+
+            if (lftrCandidate) {
+                auto [iv, factor] = *lftrCandidate;
+                if (auto init = replaceTest(iv, factor, reduced.at({iv, IROperand::imm(factor)}))) {
+                    // The original IV is gone; seed the reduced ones from its constant start.
+                    for (auto& inst : preheader) {
+                        auto* m = std::get_if<IRMov>(&inst);
+                        if (m && m->src == iv) m->src = IROperand::imm(*init);
+                    }
+                }
+            }
+
+            // The preheader goes in front of the header, shifting everything from there on.
+            size_t headerBegin = cfg.blocks[loop.header].begin;
+            size_t oldSize = fn.body.size();
+            insertPreheader(fn, cfg, loop, std::move(preheader));
+            size_t shift = fn.body.size() - oldSize;
+            std::vector<IRInstruction> body;
+            body.reserve(fn.body.size() + afterUpdate.size());
+            auto it = afterUpdate.begin();
+            for (size_t i = 0; i < fn.body.size(); ++i) {
+                if (!isNop(fn.body[i])) body.push_back(fn.body[i]);
+                while (it != afterUpdate.end() && it->first + (it->first >= headerBegin ? shift : 0) == i) {
+                    for (auto& extra : it->second) body.push_back(extra);
+                    ++it;
+                }
+            }
+            fn.body = std::move(body);
+        }
+
+        // Value the IV holds on every entry to the loop: a constant assigned
+        // once outside it, on every path from the enclosing loop's header
+        // (or the function entry) to this loop's header.
+        std::optional<int> initialValue(IROperand iv) const {
+            std::optional<int> value;
+            int blockIndex = 0;
+            for (size_t i = 0; i < fn.body.size(); ++i) {
+                while (cfg.blocks[blockIndex].end <= i) ++blockIndex;
+                if (isNop(fn.body[i]) || inLoop.count(i)) continue;
+                bool defines = false;
+                forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole role) {
+                    if (op == iv && role != OperandRole::Read) defines = true;
+                });
+                if (!defines) continue;
+                auto* m = std::get_if<IRMov>(&fn.body[i]);
+                if (m == nullptr || !m->src.isImm() || value) return std::nullopt;
+                if (!dominators.dominates(blockIndex, loop.header) || forest.innermost[blockIndex] != loop.parent) {
+                    return std::nullopt;
+                }
+                value = m->src.asImm();
+            }
+            return value;
+        }
+
+        // Replaces `cmp $n, iv` with `cmp $(n*factor), reduced` when iv has no
+        // other use, then deletes iv entirely. Returns the IV's initial value
+        // on success.
+        std::optional<int> replaceTest(IROperand iv, int factor, IROperand reducedIV) {
+            auto init = initialValue(iv);
+            if (!init) return std::nullopt;
+            std::optional<size_t> test;
+            std::vector<size_t> others;
+            for (size_t i = 0; i < fn.body.size(); ++i) {
+                if (isNop(fn.body[i])) continue;
+                bool reads = false;
+                forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole role) {
+                    if (op == iv && role != OperandRole::Write) reads = true;
+                });
+                if (!reads) continue;
+                auto* cmp = std::get_if<IRCmp>(&fn.body[i]);
+                if (cmp && inLoop.count(i) && !test && cmp->src.isImm()) {
+                    test = i;
+                } else if (i != ivs.at(iv.asPseudo()).update) {
+                    return std::nullopt;
+                }
+            }
+            if (!test) return std::nullopt;
+            auto* cmp = std::get_if<IRCmp>(&fn.body[*test]);
+            int bound = cmp->src.asImm();
+            // Every value the reduced IV takes lies between these two products.
+            auto limit = fitsInt(static_cast<int64_t>(bound) * factor);
+            if (!limit || !fitsInt(static_cast<int64_t>(*init) * factor)) return std::nullopt;
+
+            cmp->src = IROperand::imm(*limit);
+            cmp->dst = reducedIV;
+            if (factor < 0) {
+                const auto& block = cfg.blocks[inLoop.at(*test)];
+                for (size_t i = *test + 1; i < block.end && !writesFlags(fn.body[i]); ++i) {
+                    if (auto* j = std::get_if<IRJumpCC>(&fn.body[i])) j->cond = swapCondition(j->cond);
+                    if (auto* s = std::get_if<IRSetCC>(&fn.body[i])) s->cond = swapCondition(s->cond);
+                    if (auto* c = std::get_if<IRCMov>(&fn.body[i])) c->cond = swapCondition(c->cond);
+                }
+            }
+            // The IV is now only updated and initialised.
+            for (size_t i = 0; i < fn.body.size(); ++i) {
+                if (isNop(fn.body[i])) continue;
+                bool writes = false;
+                forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole role) {
+                    if (op == iv && role != OperandRole::Read) writes = true;
+                });
+                if (writes && i != ivs.at(iv.asPseudo()).update) fn.body[i] = IRNop{};
+            }
+            // Keep the update as the anchor for the reduced IV's increment; it
+            // becomes dead code for DCE once the anchor has been used.
+            pendingDeadUpdate = iv;
+            return init;
+        }
+
+    public:
+        std::optional<IROperand> pendingDeadUpdate;
+    };
+}
+
+bool InductionVariables::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool InductionVariables::run(IRFunction& fn, AnalysisManager& analyses) {
+    bool changed = false;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        const CFG& cfg = analyses.cfg();
+        if (cfg.blocks.empty()) break;
+        const Dominators& dominators = analyses.dominators();
+        const LoopForest& forest = analyses.loops();
+        for (int id : forest.innermostFirst()) {
+            LoopReducer reducer(fn, cfg, dominators, forest, forest.loops[id]);
+            int line = sourceLine(fn, cfg, forest.loops[id]);
+            if (!reducer.run()) continue;
+            OptimizationRemarks& remarks = analyses.remarks();
+            remarks.count("multiplications strength-reduced", static_cast<long>(reducer.reduced()));
+            if (remarks.enabled()) {
+                remarks.applied("StrengthReduced", line,
+                                "replaced " + std::to_string(reducer.reduced())
+                                    + " multiplications of an induction variable by additions");
+            }
+            if (reducer.pendingDeadUpdate) {
+                IROperand iv = *reducer.pendingDeadUpdate;
+                std::erase_if(fn.body, [&](const auto& inst) {
+                    auto* b = std::get_if<IRBinary>(&inst);
+                    return b && b->dst == iv;
+                });
+            }
+            analyses.invalidate();
+            progress = changed = true;
+            break;
+        }
+    }
+    return changed;
+}
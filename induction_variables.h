@@ -0,0 +1,21 @@
+#ifndef COMPILER_INDUCTION_VARIABLES_H
+#define COMPILER_INDUCTION_VARIABLES_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class InductionVariables {
+public:
+    // Finds basic induction variables (pseudos whose only update in a loop
+    // is `add c, i` with c invariant) and products of them with invariant
+    // values, replaces each product by a new induction variable stepped with
+    // an addition, and, when the original variable then only feeds the exit
+    // test, rewrites that test against the new variable (linear-function
+    // test replacement) and deletes the original.
+    // Returns true if the function changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_INDUCTION_VARIABLES_H
@@ -0,0 +1,406 @@
+#include "instruction_selection.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+#include "cfg.h"
+#include "ir_utils.h"
+#include "liveness.h"
+
+namespace {
+    // Tile costs: two per instruction, and more for the slow ones. imul
+    // takes three cycles, and so may a lea that adds base, index and
+    // displacement.
+    constexpr int kInstructionCost = 2;
+    constexpr int kMultiplyCost = 4;
+    constexpr int kComplexLeaCost = 3;
+
+    // Longest run of instructions a single tile may cover.
+    constexpr size_t kMaxTileLength = 8;
+
+    // Coefficients past this cannot be an x86 scale; stopping there also
+    // keeps the arithmetic from overflowing.
+    constexpr std::int64_t kMaxCoefficient = 64;
+
+    static bool isMemory(const IROperand& op) {
+        return op.isStack();
+    }
+
+    // Instructions the code generator emits for an instruction, scratch
+    // register moves included. Matches the templates in codegen.cpp.
+    static int emittedInstructions(const IRInstruction& inst) {
+        if (auto* m = std::get_if<IRMov>(&inst)) {
+            return isMemory(m->src) && isMemory(m->dst) ? 2 : 1;
+        }
+        if (auto* b = std::get_if<IRBinary>(&inst)) {
+            if (b->op == IRBinaryOperator::Mul && isMemory(b->dst)) {
+                return b->src.isReg() ? 3 : 4;
+            }
+            return isMemory(b->src) && isMemory(b->dst) ? 2 : 1;
+        }
+        if (auto* c = std::get_if<IRCmp>(&inst)) {
+            return c->dst.isImm() || (isMemory(c->src) && isMemory(c->dst)) ? 2 : 1;
+        }
+        if (auto* d = std::get_if<IRIdiv>(&inst)) {
+            return d->divisor.isImm() ? 2 : 1;
+        }
+        if (auto* s = std::get_if<IRSetCC>(&inst)) {
+            return isMemory(s->dst) ? 3 : 1;
+        }
+        if (auto* c = std::get_if<IRCMov>(&inst)) {
+            return (c->src.isImm() ? 1 : 0) + (isMemory(c->dst) ? 3 : 1);
+        }
+        return 1;
+    }
+
+    // Compares against an immediate the other way round, so the immediate
+    // is the source operand x86 can encode, and swaps the conditions of the
+    // instructions that read the flags it sets.
+    static void turnAround(IRFunction& fn, size_t cmp) {
+        auto& c = std::get<IRCmp>(fn.body[cmp]);
+        std::swap(c.src, c.dst);
+        for (size_t i = cmp + 1; i < fn.body.size(); ++i) {
+            auto& inst = fn.body[i];
+            if (std::holds_alternative<IRLabel>(inst) || writesFlags(inst)) break;
+            if (auto* j = std::get_if<IRJumpCC>(&inst)) {
+                j->cond = swapCondition(j->cond);
+            } else if (auto* s = std::get_if<IRSetCC>(&inst)) {
+                s->cond = swapCondition(s->cond);
+            } else if (auto* m = std::get_if<IRCMov>(&inst)) {
+                m->cond = swapCondition(m->cond);
+            }
+            if (isTerminator(inst)) break;
+        }
+    }
+
+    static bool turnsAround(const IRCmp& c) {
+        return c.dst.isImm() && !c.src.isImm();
+    }
+
+    // Hard registers live after each instruction, one bit per IRRegister.
+    static std::vector<std::uint32_t> liveRegistersAfter(const IRFunction& fn) {
+        CFG cfg = CFG::build(fn);
+        LocationIndex locations(fn);
+        Liveness liveness = Liveness::compute(fn, cfg, locations);
+        std::vector<std::uint32_t> live(fn.body.size());
+        for (const auto& block : cfg.blocks) {
+            liveness.forEachInstructionBackward(block.id, [&](size_t i, const BitVector& after) {
+                for (int r = 0; r < kIRRegisterCount; ++r) {
+                    if (after.test(locations.reg(static_cast<IRRegister>(r)))) live[i] |= 1u << r;
+                }
+            });
+        }
+        return live;
+    }
+
+    static bool mentions(std::span<const IRRegister> registers, const IROperand& op) {
+        if (!op.isReg()) return false;
+        for (IRRegister r : registers) {
+            if (r == op.asReg()) return true;
+        }
+        return false;
+    }
+
+    // Whether an instruction reads or writes a register, named or implicitly.
+    static bool touches(const IRInstruction& inst, const IROperand& reg) {
+        bool found = mentions(implicitReads(inst), reg) || mentions(implicitWrites(inst), reg);
+        forEachOperand(inst, [&](const IROperand& op, OperandRole) { found |= op == reg; });
+        return found;
+    }
+
+    static bool writes(const IRInstruction& inst, const IROperand& location) {
+        bool found = mentions(implicitWrites(inst), location);
+        forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+            found |= op == location && role != OperandRole::Read;
+        });
+        return found;
+    }
+
+    // `mov x, r` followed, before anything else touches r or writes x, by
+    // the one read of r before it dies: read x there instead, when that
+    // emits fewer instructions (`mov -8(%rbp), r; cmp r, s` is `cmp -8(%rbp), s`).
+    static bool foldOperands(IRFunction& fn) {
+        std::vector<std::uint32_t> live = liveRegistersAfter(fn);
+        bool changed = false;
+        for (size_t i = 0; i < fn.body.size(); ++i) {
+            auto* m = std::get_if<IRMov>(&fn.body[i]);
+            if (!m || !m->dst.isReg() || m->src == m->dst) continue;
+            IROperand value = m->src;
+            IROperand reg = m->dst;
+            size_t use = i + 1;
+            while (use < fn.body.size() && !std::holds_alternative<IRLabel>(fn.body[use])
+                   && !touches(fn.body[use], reg) && !writes(fn.body[use], value)
+                   && !isTerminator(fn.body[use])) {
+                ++use;
+            }
+            if (use == fn.body.size() || !touches(fn.body[use], reg)) continue;
+            if (live[use] & (1u << static_cast<int>(reg.asReg()))) continue;
+
+            IRInstruction folded = fn.body[use];
+            if (mentions(implicitReads(folded), reg) || mentions(implicitWrites(folded), reg)) continue;
+            int reads = 0;
+            bool other = false;
+            forEachOperand(folded, [&](IROperand& op, OperandRole role) {
+                if (op != reg) return;
+                if (role == OperandRole::Read) {
+                    op = value;
+                    ++reads;
+                } else {
+                    other = true;
+                }
+            });
+            if (reads != 1 || other) continue;
+            auto* cmp = std::get_if<IRCmp>(&folded);
+            if (cmp && cmp->src.isImm() && cmp->dst.isImm()) continue;
+            bool turn = cmp && turnsAround(*cmp);
+            if (turn) std::swap(cmp->src, cmp->dst);
+            if (emittedInstructions(folded) >= emittedInstructions(fn.body[i]) + emittedInstructions(fn.body[use])) {
+                continue;
+            }
+            if (turn) std::swap(cmp->src, cmp->dst);
+            fn.body[use] = folded;
+            if (turn) turnAround(fn, use);
+            fn.body[i] = IRNop{};
+            changed = true;
+        }
+        eraseNops(fn);
+        return changed;
+    }
+
+    // The value of a register as base + index * scale + disp form would
+    // see it: a linear combination of registers, plus a displacement that
+    // wraps like 32-bit arithmetic.
+    struct Linear {
+        std::array<std::int64_t, kIRRegisterCount> coefficients{};
+        std::uint32_t disp = 0;
+
+        bool add(const Linear& other, std::int64_t factor) {
+            for (int r = 0; r < kIRRegisterCount; ++r) {
+                coefficients[r] += other.coefficients[r] * factor;
+                if (std::abs(coefficients[r]) > kMaxCoefficient) return false;
+            }
+            disp += other.disp * static_cast<std::uint32_t>(factor);
+            return true;
+        }
+
+        bool scale(std::int32_t factor) {
+            for (auto& c : coefficients) {
+                c *= factor;
+                if (std::abs(c) > kMaxCoefficient) return false;
+            }
+            disp *= static_cast<std::uint32_t>(factor);
+            return true;
+        }
+    };
+
+    static std::optional<Linear> linearOperand(const IROperand& op) {
+        Linear value;
+        if (op.isImm()) {
+            value.disp = static_cast<std::uint32_t>(op.asImm());
+        } else if (op.isReg()) {
+            value.coefficients[static_cast<int>(op.asReg())] = 1;
+        } else {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    // Applies one step of a run on `reg` to its value; false when the
+    // result is no longer linear.
+    static bool apply(const IRInstruction& inst, const IROperand& reg, Linear& value) {
+        auto* b = std::get_if<IRBinary>(&inst);
+        if (!b) return false;
+        std::optional<Linear> operand = b->src == reg ? value : linearOperand(b->src);
+        if (!operand) return false;
+        switch (b->op) {
+            case IRBinaryOperator::Add: return value.add(*operand, 1);
+            case IRBinaryOperator::Sub: return value.add(*operand, -1);
+            case IRBinaryOperator::Mul: return b->src.isImm() && value.scale(b->src.asImm());
+        }
+        return false;
+    }
+
+    struct Tile {
+        int cost = 0;
+        std::optional<IRInstruction> inst; // none when the value is already in place
+    };
+
+    // The single instruction that leaves `value` in `reg`, if there is one.
+    static std::optional<Tile> tileFor(const Linear& value, const IROperand& reg) {
+        std::vector<std::pair<IROperand, std::int64_t>> terms;
+        for (int r = 0; r < kIRRegisterCount; ++r) {
+            if (value.coefficients[r] < 0) return std::nullopt;
+            if (value.coefficients[r] > 0) terms.emplace_back(IROperand::reg(static_cast<IRRegister>(r)), value.coefficients[r]);
+        }
+        int disp = static_cast<int>(value.disp);
+        if (terms.empty()) {
+            return Tile{kInstructionCost, IRMov(IROperand::imm(disp), reg)};
+        }
+        if (terms.size() == 1) {
+            auto [r, c] = terms.front();
+            if (c == 1 && disp == 0) {
+                if (r == reg) return Tile{};
+                return Tile{kInstructionCost, IRMov(r, reg)};
+            }
+            if (c == 1) return Tile{kInstructionCost, IRLea(r, r, 0, disp, reg)};
+            // r * c as r + r * (c - 1).
+            if (c == 2 || c == 3 || c == 5 || c == 9) {
+                return Tile{disp == 0 ? kInstructionCost : kComplexLeaCost,
+                            IRLea(r, r, static_cast<int>(c - 1), disp, reg)};
+            }
+            return std::nullopt;
+        }
+        if (terms.size() == 2) {
+            if (terms[0].second != 1) std::swap(terms[0], terms[1]);
+            auto [base, one] = terms[0];
+            auto [index, scale] = terms[1];
+            if (one != 1 || (scale != 1 && scale != 2 && scale != 4 && scale != 8)) return std::nullopt;
+            return Tile{disp == 0 ? kInstructionCost : kComplexLeaCost,
+                        IRLea(base, index, static_cast<int>(scale), disp, reg)};
+        }
+        return std::nullopt;
+    }
+
+    static int plainCost(const IRInstruction& inst) {
+        auto* b = std::get_if<IRBinary>(&inst);
+        return b && b->op == IRBinaryOperator::Mul ? kMultiplyCost : kInstructionCost;
+    }
+
+    // Tiles a run of instructions computing a value in `reg` by dynamic
+    // programming over its prefixes: the cheapest cover of the first j
+    // steps ends in a tile covering steps i..j-1 on top of the cheapest
+    // cover of the first i. Rewrites the run if that beats
+    // emitting every step as it is, and returns whether it did.
+    static bool tileRun(std::vector<IRInstruction>& run, const IROperand& reg) {
+        size_t n = run.size();
+        constexpr int kUnreached = std::numeric_limits<int>::max();
+        std::vector<int> best(n + 1, kUnreached);
+        std::vector<size_t> from(n + 1);
+        std::vector<std::optional<Tile>> chosen(n + 1);
+        best[0] = 0;
+        int plain = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const IRInstruction& first = run[i];
+            plain += plainCost(first);
+            auto relax = [&](size_t j, Tile tile) {
+                if (best[i] + tile.cost < best[j]) {
+                    best[j] = best[i] + tile.cost;
+                    from[j] = i;
+                    chosen[j] = std::move(tile);
+                }
+            };
+            relax(i + 1, Tile{plainCost(first), first});
+
+            // `mov x, reg; imul $k, reg` is `imul $k, x, reg`.
+            auto* m = std::get_if<IRMov>(&first);
+            if (m && i + 1 < n) {
+                auto* b = std::get_if<IRBinary>(&run[i + 1]);
+                if (b && b->op == IRBinaryOperator::Mul && b->src.isImm() && !m->src.isImm()) {
+                    relax(i + 2, Tile{kMultiplyCost, IRImul(b->src.asImm(), m->src, reg)});
+                }
+            }
+
+            Linear value;
+            if (m) {
+                std::optional<Linear> source = linearOperand(m->src);
+                if (!source) continue;
+                value = *source;
+            } else {
+                value.coefficients[static_cast<int>(reg.asReg())] = 1;
+                if (!apply(first, reg, value)) continue;
+            }
+            for (size_t j = i + 1; j <= n && j - i <= kMaxTileLength; ++j) {
+                if (j > i + 1 && !apply(run[j - 1], reg, value)) break;
+                if (auto tile = tileFor(value, reg)) relax(j, *tile);
+            }
+        }
+        if (best[n] >= plain) return false;
+
+        std::vector<IRInstruction> code;
+        for (size_t j = n; j > 0; j = from[j]) {
+            if (chosen[j]->inst) code.push_back(*chosen[j]->inst);
+        }
+        run.assign(code.rbegin(), code.rend());
+        return true;
+    }
+
+    // A run on a stack slot: every memory-to-memory step goes through
+    // %r10d anyway, so when that saves instructions the whole run is
+    // computed in %r10d and stored once. The code generator only uses
+    // %r10d within the template of one instruction, and none is needed
+    // for arithmetic into a register.
+    static bool accumulate(std::vector<IRInstruction>& run, const IROperand& slot) {
+        const IROperand scratch = IROperand::reg(IRRegister::R10);
+        int plain = 0;
+        for (const auto& inst : run) plain += emittedInstructions(inst);
+        std::vector<IRInstruction> code;
+        if (!std::holds_alternative<IRMov>(run.front())) code.push_back(IRMov(slot, scratch));
+        for (auto inst : run) {
+            forEachOperand(inst, [&](IROperand& op, OperandRole) {
+                if (op == slot) op = scratch;
+            });
+            code.push_back(inst);
+        }
+        if (static_cast<int>(code.size()) + 1 >= plain) return false;
+        tileRun(code, scratch);
+        code.push_back(IRMov(scratch, slot));
+        run = std::move(code);
+        return true;
+    }
+
+    // Finds the runs: a mov into a register or stack slot, or an update of
+    // it, and the updates of that location that follow it directly. Only
+    // the location is written along a run and nothing else reads it in
+    // between, so the run is one expression tree.
+    static bool tileExpressions(IRFunction& fn) {
+        std::vector<IRInstruction> body;
+        body.reserve(fn.body.size());
+        bool changed = false;
+        size_t i = 0;
+        while (i < fn.body.size()) {
+            IROperand location;
+            if (auto* m = std::get_if<IRMov>(&fn.body[i])) {
+                location = m->dst;
+            } else if (auto* b = std::get_if<IRBinary>(&fn.body[i])) {
+                location = b->dst;
+            } else {
+                body.push_back(fn.body[i++]);
+                continue;
+            }
+            size_t end = i + 1;
+            while (end < fn.body.size()) {
+                auto* b = std::get_if<IRBinary>(&fn.body[end]);
+                if (!b || b->dst != location) break;
+                ++end;
+            }
+            std::vector<IRInstruction> run(fn.body.begin() + i, fn.body.begin() + end);
+            if (location.isReg()) {
+                changed |= tileRun(run, location);
+            } else if (location.isStack() && run.size() > 1) {
+                changed |= accumulate(run, location);
+            }
+            body.insert(body.end(), run.begin(), run.end());
+            i = end;
+        }
+        fn.body = std::move(body);
+        return changed;
+    }
+}
+
+bool InstructionSelection::run(IRFunction& fn) {
+    bool changed = false;
+    for (size_t i = 0; i < fn.body.size(); ++i) {
+        if (auto* c = std::get_if<IRCmp>(&fn.body[i]); c && turnsAround(*c)) {
+            turnAround(fn, i);
+            changed = true;
+        }
+    }
+    changed |= foldOperands(fn);
+    changed |= tileExpressions(fn);
+    return changed;
+}
@@ -0,0 +1,21 @@
+#ifndef COMPILER_INSTRUCTION_SELECTION_H
+#define COMPILER_INSTRUCTION_SELECTION_H
+
+#include "ir.h"
+
+class InstructionSelection {
+public:
+    // Picks x86 instructions for an allocated function whose pseudos have
+    // stack slots, just before code generation. The two-address IR spells
+    // an expression out one operation at a time on the register that holds
+    // it; each such run (`mov a, t; add b, t; add $4, t`) is a left-deep
+    // tree, which is tiled at least cost with lea, three-operand imul, mov
+    // and the plain instructions (`lea 4(a, b), t`). A load or copy into a
+    // register read once before it dies is folded into the reader as a
+    // memory, register or immediate operand, and a compare against an
+    // immediate is turned around so the immediate can be encoded. Returns
+    // true if the function changed.
+    static bool run(IRFunction& fn);
+};
+
+#endif // COMPILER_INSTRUCTION_SELECTION_H
@@ -1,16 +1,21 @@
 #ifndef COMPILER_IR_H
 #define COMPILER_IR_H
 
+#include <compare>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <memory>
 #include <utility>
+#include <variant>
 
 /*
 Assembly AST Grammar:
 
 program = Program(function_definition)
-function_definition = Function(identifier name, instruction* instructions)
+function_definition = Function(identifier name, instruction* instructions, identifier* pseudos, int labels)
 instruction = Mov(operand src, operand dst)
             | Unary(unary_operator, operand)
             | Binary(binary_operator, operand src, operand dst)
@@ -20,14 +25,21 @@ instruction = Mov(operand src, operand dst)
             | Jump(label)
             | JumpCC(cond_code, label)
             | SetCC(cond_code, operand)
+            | CMov(cond_code, operand src, operand dst)
+            | Lea(operand base, operand index, int scale, int disp, operand dst)
+            | Imul(int factor, operand src, operand dst)
             | Label(label)
             | AllocateStack(int)
             | Ret
 unary_operator = Neg | Not
 binary_operator = Add | Sub | Mul
-operand = Imm(int) | Reg(reg) | Pseudo(identifier) | Stack(int)
-reg = AX | DX | R10 | R11
+operand = Imm(int) | Reg(reg) | Pseudo(int index into pseudos) | Stack(int)
+reg = AX | DX | R10 | R11 | CX | SI | DI | R8 | R9 | BX | R12 | R13 | R14 | R15
 cond_code = E | NE | G | GE | L | LE
+label = int, numbered per function; names exist only in printed IR and assembly
+
+Lea and Imul are only produced by instruction selection, after register
+allocation and frame layout; the optimization passes never see them.
 */
 
 enum class IRUnaryOperator {
@@ -41,13 +53,27 @@ enum class IRBinaryOperator {
     Mul
 };
 
+// AX and DX carry division and return values; R10 and R11 are scratch for
+// code generation. The others only appear after register allocation.
 enum class IRRegister {
     AX,
     DX,
     R10,
-    R11
+    R11,
+    CX,
+    SI,
+    DI,
+    R8,
+    R9,
+    BX,  // callee-saved from here on
+    R12,
+    R13,
+    R14,
+    R15
 };
 
+constexpr int kIRRegisterCount = 14;
+
 enum class IRCondCode {
     E,
     NE,
@@ -57,107 +83,163 @@ enum class IRCondCode {
     LE
 };
 
-struct IROperand {
-    virtual ~IROperand() = default;
+enum class IROperandKind : std::uint8_t {
+    Imm,
+    Reg,
+    Pseudo,
+    Stack
 };
 
-struct IRImm : public IROperand {
-    int value;
-    explicit IRImm(int v) : value(v) {}
-};
+// An instruction operand: a kind tag and a 32-bit payload holding the
+// immediate, the register, the pseudo's index into IRFunction::pseudos or
+// the offset from %rbp. Operands are plain values, copied and compared
+// without touching the heap.
+struct IROperand {
+    IROperandKind kind = IROperandKind::Imm;
+    std::int32_t payload = 0;
 
-struct IRReg : public IROperand {
-    IRRegister reg;
-    explicit IRReg(IRRegister r) : reg(r) {}
-};
+    static constexpr IROperand imm(int value) { return {IROperandKind::Imm, value}; }
+    static constexpr IROperand reg(IRRegister r) { return {IROperandKind::Reg, static_cast<std::int32_t>(r)}; }
+    static constexpr IROperand pseudo(int id) { return {IROperandKind::Pseudo, id}; }
+    static constexpr IROperand stack(int offset) { return {IROperandKind::Stack, offset}; }
 
-struct IRPseudo : public IROperand {
-    std::string name;
-    explicit IRPseudo(std::string n) : name(std::move(n)) {}
-};
+    bool isImm() const { return kind == IROperandKind::Imm; }
+    bool isReg() const { return kind == IROperandKind::Reg; }
+    bool isPseudo() const { return kind == IROperandKind::Pseudo; }
+    bool isStack() const { return kind == IROperandKind::Stack; }
 
-struct IRStack : public IROperand {
-    int offset;
-    explicit IRStack(int o) : offset(o) {}
+    int asImm() const { return payload; }
+    IRRegister asReg() const { return static_cast<IRRegister>(payload); }
+    int asPseudo() const { return payload; }
+    int asStack() const { return payload; }
+
+    auto operator<=>(const IROperand&) const = default;
 };
+static_assert(std::is_trivially_copyable_v<IROperand> && sizeof(IROperand) == 8);
 
-struct IRInstruction {
-    virtual ~IRInstruction() = default;
+template <>
+struct std::hash<IROperand> {
+    size_t operator()(const IROperand& op) const noexcept {
+        return std::hash<std::uint64_t>()((std::uint64_t{static_cast<std::uint8_t>(op.kind)} << 32)
+                                          | static_cast<std::uint32_t>(op.payload));
+    }
 };
 
-struct IRMov : public IRInstruction {
-    std::unique_ptr<IROperand> src;
-    std::unique_ptr<IROperand> dst;
-    IRMov(std::unique_ptr<IROperand> s, std::unique_ptr<IROperand> d)
-        : src(std::move(s)), dst(std::move(d)) {}
+struct IRMov {
+    IROperand src;
+    IROperand dst;
+    IRMov(IROperand s, IROperand d) : src(s), dst(d) {}
 };
 
-struct IRUnary : public IRInstruction {
+struct IRUnary {
     IRUnaryOperator op;
-    std::unique_ptr<IROperand> operand;
-    IRUnary(IRUnaryOperator o, std::unique_ptr<IROperand> e)
-        : op(o), operand(std::move(e)) {}
+    IROperand operand;
+    IRUnary(IRUnaryOperator o, IROperand e) : op(o), operand(e) {}
 };
 
-struct IRBinary : public IRInstruction {
+struct IRBinary {
     IRBinaryOperator op;
-    std::unique_ptr<IROperand> src;
-    std::unique_ptr<IROperand> dst;
-    IRBinary(IRBinaryOperator o, std::unique_ptr<IROperand> s, std::unique_ptr<IROperand> d)
-        : op(o), src(std::move(s)), dst(std::move(d)) {}
+    IROperand src;
+    IROperand dst;
+    IRBinary(IRBinaryOperator o, IROperand s, IROperand d) : op(o), src(s), dst(d) {}
 };
 
-struct IRCmp : public IRInstruction {
-    std::unique_ptr<IROperand> src;
-    std::unique_ptr<IROperand> dst;
-    IRCmp(std::unique_ptr<IROperand> s, std::unique_ptr<IROperand> d)
-        : src(std::move(s)), dst(std::move(d)) {}
+struct IRCmp {
+    IROperand src;
+    IROperand dst;
+    IRCmp(IROperand s, IROperand d) : src(s), dst(d) {}
 };
 
-struct IRIdiv : public IRInstruction {
-    std::unique_ptr<IROperand> divisor;
-    explicit IRIdiv(std::unique_ptr<IROperand> d) : divisor(std::move(d)) {}
+struct IRIdiv {
+    IROperand divisor;
+    explicit IRIdiv(IROperand d) : divisor(d) {}
 };
 
-struct IRCdq : public IRInstruction {
+struct IRCdq {
 };
 
-struct IRJump : public IRInstruction {
-    std::string target;
-    explicit IRJump(std::string t) : target(std::move(t)) {}
+struct IRJump {
+    int target;
+    explicit IRJump(int t) : target(t) {}
 };
 
-struct IRJumpCC : public IRInstruction {
+struct IRJumpCC {
     IRCondCode cond;
-    std::string target;
-    IRJumpCC(IRCondCode c, std::string t) : cond(c), target(std::move(t)) {}
+    int target;
+    IRJumpCC(IRCondCode c, int t) : cond(c), target(t) {}
 };
 
-struct IRSetCC : public IRInstruction {
+struct IRSetCC {
     IRCondCode cond;
-    std::unique_ptr<IROperand> dst;
-    IRSetCC(IRCondCode c, std::unique_ptr<IROperand> d)
-        : cond(c), dst(std::move(d)) {}
+    IROperand dst;
+    IRSetCC(IRCondCode c, IROperand d) : cond(c), dst(d) {}
 };
 
-struct IRLabel : public IRInstruction {
-    std::string name;
-    explicit IRLabel(std::string n) : name(std::move(n)) {}
+// dst = src if the condition holds, else dst keeps its value.
+struct IRCMov {
+    IRCondCode cond;
+    IROperand src;
+    IROperand dst;
+    IRCMov(IRCondCode c, IROperand s, IROperand d) : cond(c), src(s), dst(d) {}
+};
+
+// dst = base + index * scale + disp, computed by lea: no flags are written.
+// base, index and dst are registers; there is no index when scale is 0.
+struct IRLea {
+    IROperand base;
+    IROperand index;
+    int scale;
+    int disp;
+    IROperand dst;
+    IRLea(IROperand b, IROperand i, int s, int d, IROperand t) : base(b), index(i), scale(s), disp(d), dst(t) {}
+};
+
+// dst = src * factor, the three-operand imul; dst is a register.
+struct IRImul {
+    int factor;
+    IROperand src;
+    IROperand dst;
+    IRImul(int f, IROperand s, IROperand d) : factor(f), src(s), dst(d) {}
 };
 
-struct IRAllocateStack : public IRInstruction {
+struct IRLabel {
+    int id;
+    int unroll = 0; // on loop headers: #pragma unroll hint (0 none, -1 without a count)
+    int line = 0;   // on loop headers: source line of the loop, 0 if unknown
+    explicit IRLabel(int i, int u = 0, int l = 0) : id(i), unroll(u), line(l) {}
+};
+
+struct IRAllocateStack {
     int amount;
     explicit IRAllocateStack(int a) : amount(a) {}
 };
 
-struct IRRet : public IRInstruction {
+struct IRRet {
 };
 
+// Stands in for an instruction a pass deleted until the pass compacts the
+// body; never reaches the code generator.
+struct IRNop {
+};
+
+// Instructions are stored by value; std::get_if selects the kind.
+using IRInstruction = std::variant<IRMov, IRUnary, IRBinary, IRCmp, IRIdiv, IRCdq, IRJump, IRJumpCC,
+                                   IRSetCC, IRCMov, IRLea, IRImul, IRLabel, IRAllocateStack, IRRet, IRNop>;
+static_assert(std::is_trivially_copyable_v<IRInstruction>);
+
 struct IRFunction {
     std::string name;
-    std::vector<std::unique_ptr<IRInstruction>> body;
-    IRFunction(std::string n, std::vector<std::unique_ptr<IRInstruction>> b)
-        : name(std::move(n)), body(std::move(b)) {}
+    std::vector<IRInstruction> body;
+    std::vector<std::string> pseudos; // names, indexed by IROperand::asPseudo()
+    int labelCount = 0;               // labels are numbered 0 .. labelCount-1
+    IRFunction(std::string n, std::vector<IRInstruction> b, std::vector<std::string> p = {}, int labels = 0)
+        : name(std::move(n)), body(std::move(b)), pseudos(std::move(p)), labelCount(labels) {}
+
+    IROperand addPseudo(std::string pseudoName) {
+        pseudos.push_back(std::move(pseudoName));
+        return IROperand::pseudo(static_cast<int>(pseudos.size()) - 1);
+    }
+    int addLabel() { return labelCount++; }
 };
 
 struct IRProgram {
@@ -38,13 +38,23 @@ static const char* toString(IRRegister reg) {
         case IRRegister::DX: return "%edx";
         case IRRegister::R10: return "%r10d";
         case IRRegister::R11: return "%r11d";
+        case IRRegister::CX: return "%ecx";
+        case IRRegister::SI: return "%esi";
+        case IRRegister::DI: return "%edi";
+        case IRRegister::R8: return "%r8d";
+        case IRRegister::R9: return "%r9d";
+        case IRRegister::BX: return "%ebx";
+        case IRRegister::R12: return "%r12d";
+        case IRRegister::R13: return "%r13d";
+        case IRRegister::R14: return "%r14d";
+        case IRRegister::R15: return "%r15d";
     }
     return "%?";
 }
 
 std::string IRPrinter::print(const IRProgram& program) {
     std::ostringstream oss;
-    IRPrinter printer(oss);
+    IRPrinter printer(oss, program.function.get());
     printer.emit(program);
     return oss.str();
 }
@@ -60,96 +70,112 @@ void IRPrinter::emit(const IRProgram& program) const {
 void IRPrinter::emit(const IRFunction& fn) const {
     out << "func " << fn.name << "() {\n";
     for (const auto& inst : fn.body) {
-        emit(*inst);
+        emit(inst);
     }
     out << "}\n";
 }
 
 void IRPrinter::emit(const IRInstruction& inst) const {
-    if (auto m = dynamic_cast<const IRMov*>(&inst)) {
+    if (auto m = std::get_if<IRMov>(&inst)) {
         emit(*m);
         return;
     }
-    if (auto u = dynamic_cast<const IRUnary*>(&inst)) {
+    if (auto u = std::get_if<IRUnary>(&inst)) {
         emit(*u);
         return;
     }
-    if (auto b = dynamic_cast<const IRBinary*>(&inst)) {
+    if (auto b = std::get_if<IRBinary>(&inst)) {
         emit(*b);
         return;
     }
-    if (auto c = dynamic_cast<const IRCmp*>(&inst)) {
+    if (auto c = std::get_if<IRCmp>(&inst)) {
         emit(*c);
         return;
     }
-    if (auto d = dynamic_cast<const IRIdiv*>(&inst)) {
+    if (auto d = std::get_if<IRIdiv>(&inst)) {
         emit(*d);
         return;
     }
-    if (auto c = dynamic_cast<const IRCdq*>(&inst)) {
+    if (auto c = std::get_if<IRCdq>(&inst)) {
         emit(*c);
         return;
     }
-    if (auto j = dynamic_cast<const IRJump*>(&inst)) {
+    if (auto j = std::get_if<IRJump>(&inst)) {
         emit(*j);
         return;
     }
-    if (auto j = dynamic_cast<const IRJumpCC*>(&inst)) {
+    if (auto j = std::get_if<IRJumpCC>(&inst)) {
         emit(*j);
         return;
     }
-    if (auto s = dynamic_cast<const IRSetCC*>(&inst)) {
+    if (auto s = std::get_if<IRSetCC>(&inst)) {
         emit(*s);
         return;
     }
-    if (auto l = dynamic_cast<const IRLabel*>(&inst)) {
+    if (auto c = std::get_if<IRCMov>(&inst)) {
+        emit(*c);
+        return;
+    }
+    if (auto l = std::get_if<IRLea>(&inst)) {
         emit(*l);
         return;
     }
-    if (auto a = dynamic_cast<const IRAllocateStack*>(&inst)) {
+    if (auto m = std::get_if<IRImul>(&inst)) {
+        emit(*m);
+        return;
+    }
+    if (auto l = std::get_if<IRLabel>(&inst)) {
+        emit(*l);
+        return;
+    }
+    if (auto a = std::get_if<IRAllocateStack>(&inst)) {
         emit(*a);
         return;
     }
-    if (auto r = dynamic_cast<const IRRet*>(&inst)) {
+    if (auto r = std::get_if<IRRet>(&inst)) {
         emit(*r);
         return;
     }
+    if (std::holds_alternative<IRNop>(inst)) {
+        out << "  nop\n";
+        return;
+    }
     out << "  <unknown inst>\n";
 }
 
 void IRPrinter::emit(const IRMov& m) const {
     out << "  mov ";
-    emit(*m.src);
+    emit(m.src);
     out << ", ";
-    emit(*m.dst);
+    emit(m.dst);
     out << "\n";
 }
 
 void IRPrinter::emit(const IRUnary& u) const {
     out << "  " << toString(u.op) << " ";
-    emit(*u.operand);
+    emit(u.operand);
     out << "\n";
 }
 
 void IRPrinter::emit(const IRBinary& b) const {
     out << "  " << toString(b.op) << " ";
-    emit(*b.src);
+    emit(b.src);
     out << ", ";
-    emit(*b.dst);
+    emit(b.dst);
     out << "\n";
 }
 
 void IRPrinter::emit(const IRCmp& c) const {
     out << "  cmp ";
-    emit(*c.src);
+    emit(c.src);
     out << ", ";
-    emit(*c.dst);
+    emit(c.dst);
     out << "\n";
 }
 
 void IRPrinter::emit(const IRIdiv& d) const {
     out << "  idiv ";
-    emit(*d.divisor);
+    emit(d.divisor);
     out << "\n";
 }
 
@@ -158,21 +184,50 @@ void IRPrinter::emit(const IRCdq& /*c*/) const {
 }
 
 void IRPrinter::emit(const IRJump& j) const {
-    out << "  jmp " << j.target << "\n";
+    out << "  jmp L" << j.target << "\n";
 }
 
 void IRPrinter::emit(const IRJumpCC& j) const {
-    out << "  j" << toString(j.cond) << " " << j.target << "\n";
+    out << "  j" << toString(j.cond) << " L" << j.target << "\n";
 }
 
 void IRPrinter::emit(const IRSetCC& s) const {
     out << "  set" << toString(s.cond) << " ";
-    emit(*s.dst);
+    emit(s.dst);
+    out << "\n";
+}
+
+void IRPrinter::emit(const IRCMov& c) const {
+    out << "  cmov" << toString(c.cond) << " ";
+    emit(c.src);
+    out << ", ";
+    emit(c.dst);
+    out << "\n";
+}
+
+void IRPrinter::emit(const IRLea& l) const {
+    out << "  lea " << l.disp << "(";
+    emit(l.base);
+    if (l.scale != 0) {
+        out << ", ";
+        emit(l.index);
+        out << ", " << l.scale;
+    }
+    out << "), ";
+    emit(l.dst);
+    out << "\n";
+}
+
+void IRPrinter::emit(const IRImul& m) const {
+    out << "  imul " << m.factor << ", ";
+    emit(m.src);
+    out << ", ";
+    emit(m.dst);
     out << "\n";
 }
 
 void IRPrinter::emit(const IRLabel& l) const {
-    out << "  label " << l.name << "\n";
+    out << "  label L" << l.id << "\n";
 }
 
 void IRPrinter::emit(const IRAllocateStack& a) const {
@@ -185,37 +240,23 @@ void IRPrinter::emit(const IRRet& /*r*/) const {
 }
 
 void IRPrinter::emit(const IROperand& v) const {
-    if (auto c = dynamic_cast<const IRImm*>(&v)) {
-        emit(*c);
-        return;
-    }
-    if (auto r = dynamic_cast<const IRReg*>(&v)) {
-        emit(*r);
-        return;
-    }
-    if (auto p = dynamic_cast<const IRPseudo*>(&v)) {
-        emit(*p);
-        return;
-    }
-    if (auto s = dynamic_cast<const IRStack*>(&v)) {
-        emit(*s);
-        return;
+    switch (v.kind) {
+        case IROperandKind::Imm:
+            out << "$" << v.asImm();
+            return;
+        case IROperandKind::Reg:
+            out << toString(v.asReg());
+            return;
+        case IROperandKind::Pseudo:
+            if (function != nullptr && v.asPseudo() < static_cast<int>(function->pseudos.size())) {
+                out << function->pseudos[v.asPseudo()];
+            } else {
+                out << "%" << v.asPseudo();
+            }
+            return;
+        case IROperandKind::Stack:
+            out << v.asStack() << "(%rbp)";
+            return;
     }
     out << "?";
 }
-
-void IRPrinter::emit(const IRImm& c) const {
-    out << "$" << c.value;
-}
-
-void IRPrinter::emit(const IRReg& r) const {
-    out << toString(r.reg);
-}
-
-void IRPrinter::emit(const IRPseudo& v) const {
-    out << v.name;
-}
-
-void IRPrinter::emit(const IRStack& v) const {
-    out << v.offset << "(%rbp)";
-}
@@ -11,7 +11,8 @@ struct IRPrinter {
 
 private:
     std::ostream& out;
-    explicit IRPrinter(std::ostream& o) : out(o) {}
+    const IRFunction* function; // names the pseudos
+    IRPrinter(std::ostream& o, const IRFunction* f) : out(o), function(f) {}
 
     // Internal emitters used by the static print
     void emit(const IRProgram& program) const;
@@ -26,14 +27,13 @@ private:
     void emit(const IRJump& j) const;
     void emit(const IRJumpCC& j) const;
     void emit(const IRSetCC& s) const;
+    void emit(const IRCMov& c) const;
+    void emit(const IRLea& l) const;
+    void emit(const IRImul& m) const;
     void emit(const IRLabel& l) const;
     void emit(const IRAllocateStack& a) const;
     void emit(const IRRet& r) const;
     void emit(const IROperand& v) const;
-    void emit(const IRImm& c) const;
-    void emit(const IRReg& r) const;
-    void emit(const IRPseudo& v) const;
-    void emit(const IRStack& v) const;
 };
 
 #endif // COMPILER_IRPRINTER_H
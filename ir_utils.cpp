@@ -0,0 +1,134 @@
+#include "ir_utils.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "def_use.h"
+
+static constexpr IRRegister kAX[] = {IRRegister::AX};
+static constexpr IRRegister kDX[] = {IRRegister::DX};
+static constexpr IRRegister kAXDX[] = {IRRegister::AX, IRRegister::DX};
+
+std::span<const IRRegister> implicitReads(const IRInstruction& inst) {
+    if (std::holds_alternative<IRCdq>(inst)) {
+        return kAX;
+    }
+    if (std::holds_alternative<IRIdiv>(inst)) {
+        return kAXDX;
+    }
+    if (std::holds_alternative<IRRet>(inst)) {
+        return kAX;
+    }
+    return {};
+}
+
+std::span<const IRRegister> implicitWrites(const IRInstruction& inst) {
+    if (std::holds_alternative<IRCdq>(inst)) {
+        return kDX;
+    }
+    if (std::holds_alternative<IRIdiv>(inst)) {
+        return kAXDX;
+    }
+    return {};
+}
+
+bool readsFlags(const IRInstruction& inst) {
+    return std::holds_alternative<IRJumpCC>(inst)
+        || std::holds_alternative<IRSetCC>(inst)
+        || std::holds_alternative<IRCMov>(inst);
+}
+
+bool writesFlags(const IRInstruction& inst) {
+    return std::holds_alternative<IRCmp>(inst)
+        || std::holds_alternative<IRBinary>(inst)
+        || std::holds_alternative<IRUnary>(inst)
+        || std::holds_alternative<IRIdiv>(inst)
+        || std::holds_alternative<IRImul>(inst);
+}
+
+bool isTerminator(const IRInstruction& inst) {
+    return std::holds_alternative<IRJump>(inst)
+        || std::holds_alternative<IRJumpCC>(inst)
+        || std::holds_alternative<IRRet>(inst);
+}
+
+std::optional<int> jumpTarget(const IRInstruction& inst) {
+    if (auto* j = std::get_if<IRJump>(&inst)) {
+        return j->target;
+    }
+    if (auto* j = std::get_if<IRJumpCC>(&inst)) {
+        return j->target;
+    }
+    return std::nullopt;
+}
+
+void eraseNops(IRFunction& fn) {
+    std::erase_if(fn.body, isNop);
+}
+
+bool evaluateCondition(IRCondCode cond, int dst, int src) {
+    switch (cond) {
+        case IRCondCode::E: return dst == src;
+        case IRCondCode::NE: return dst != src;
+        case IRCondCode::G: return dst > src;
+        case IRCondCode::GE: return dst >= src;
+        case IRCondCode::L: return dst < src;
+        case IRCondCode::LE: return dst <= src;
+    }
+    return false;
+}
+
+IRCondCode negateCondition(IRCondCode cond) {
+    switch (cond) {
+        case IRCondCode::E: return IRCondCode::NE;
+        case IRCondCode::NE: return IRCondCode::E;
+        case IRCondCode::G: return IRCondCode::LE;
+        case IRCondCode::GE: return IRCondCode::L;
+        case IRCondCode::L: return IRCondCode::GE;
+        case IRCondCode::LE: return IRCondCode::G;
+    }
+    return cond;
+}
+
+IRCondCode swapCondition(IRCondCode cond) {
+    switch (cond) {
+        case IRCondCode::E: return IRCondCode::E;
+        case IRCondCode::NE: return IRCondCode::NE;
+        case IRCondCode::G: return IRCondCode::L;
+        case IRCondCode::GE: return IRCondCode::LE;
+        case IRCondCode::L: return IRCondCode::G;
+        case IRCondCode::LE: return IRCondCode::GE;
+    }
+    return cond;
+}
+
+bool removeUnusedPseudoDefinitions(IRFunction& fn) {
+    DefUseChains chains = DefUseChains::build(fn);
+    std::vector<int> all(fn.pseudos.size());
+    for (size_t p = 0; p < all.size(); ++p) all[p] = static_cast<int>(p);
+    if (!chains.eraseUnusedDefinitions(std::move(all))) {
+        return false;
+    }
+    eraseNops(fn);
+    return true;
+}
+
+bool removeJumpsToNext(IRFunction& fn) {
+    bool changed = false;
+    for (size_t i = 0; i + 1 < fn.body.size(); ++i) {
+        auto target = jumpTarget(fn.body[i]);
+        auto* l = std::get_if<IRLabel>(&fn.body[i + 1]);
+        if (target && l && *target == l->id) {
+            fn.body[i] = IRNop{};
+            changed = true;
+        }
+    }
+    eraseNops(fn);
+    return changed;
+}
+
+IROperand makePassTemp(IRFunction& fn, const std::string& hint) {
+    static int counter = 0;
+    return fn.addPseudo(hint + "." + std::to_string(counter++));
+}
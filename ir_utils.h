@@ -0,0 +1,119 @@
+#ifndef COMPILER_IR_UTILS_H
+#define COMPILER_IR_UTILS_H
+
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include "ir.h"
+
+// How an instruction accesses one of its explicit operands.
+enum class OperandRole {
+    Read,
+    Write,
+    ReadWrite
+};
+
+// Visits every explicit operand slot of an instruction together with its role.
+// Binary/Unary destinations, SetCC destinations (which only write the low
+// byte) and CMov destinations (kept when the condition fails) are reported
+// as ReadWrite. A template so that visiting allocates nothing.
+template <typename Fn>
+void forEachOperand(IRInstruction& inst, Fn&& fn) {
+    if (auto* m = std::get_if<IRMov>(&inst)) {
+        fn(m->src, OperandRole::Read);
+        fn(m->dst, OperandRole::Write);
+    } else if (auto* u = std::get_if<IRUnary>(&inst)) {
+        fn(u->operand, OperandRole::ReadWrite);
+    } else if (auto* b = std::get_if<IRBinary>(&inst)) {
+        fn(b->src, OperandRole::Read);
+        fn(b->dst, OperandRole::ReadWrite);
+    } else if (auto* c = std::get_if<IRCmp>(&inst)) {
+        fn(c->src, OperandRole::Read);
+        fn(c->dst, OperandRole::Read);
+    } else if (auto* d = std::get_if<IRIdiv>(&inst)) {
+        fn(d->divisor, OperandRole::Read);
+    } else if (auto* s = std::get_if<IRSetCC>(&inst)) {
+        fn(s->dst, OperandRole::ReadWrite);
+    } else if (auto* c = std::get_if<IRCMov>(&inst)) {
+        fn(c->src, OperandRole::Read);
+        fn(c->dst, OperandRole::ReadWrite);
+    } else if (auto* l = std::get_if<IRLea>(&inst)) {
+        fn(l->base, OperandRole::Read);
+        if (l->scale != 0) fn(l->index, OperandRole::Read);
+        fn(l->dst, OperandRole::Write);
+    } else if (auto* m = std::get_if<IRImul>(&inst)) {
+        fn(m->src, OperandRole::Read);
+        fn(m->dst, OperandRole::Write);
+    }
+}
+
+template <typename Fn>
+void forEachOperand(const IRInstruction& inst, Fn&& fn) {
+    forEachOperand(const_cast<IRInstruction&>(inst),
+                   [&](IROperand& op, OperandRole role) { fn(static_cast<const IROperand&>(op), role); });
+}
+
+// Hard registers accessed without being named as operands (cdq, idiv, ret).
+std::span<const IRRegister> implicitReads(const IRInstruction& inst);
+std::span<const IRRegister> implicitWrites(const IRInstruction& inst);
+
+// Condition flags. Only Cmp produces flags that the IR consumes, but every
+// arithmetic instruction clobbers them once emitted as x86.
+bool readsFlags(const IRInstruction& inst);
+bool writesFlags(const IRInstruction& inst);
+
+// Jump, JumpCC and Ret end a basic block.
+bool isTerminator(const IRInstruction& inst);
+// Target label of a Jump/JumpCC, nullopt for any other instruction.
+std::optional<int> jumpTarget(const IRInstruction& inst);
+
+inline bool isNop(const IRInstruction& inst) {
+    return std::holds_alternative<IRNop>(inst);
+}
+// Drops the IRNop placeholders a pass left behind.
+void eraseNops(IRFunction& fn);
+
+// Evaluates a condition code for the flags produced by `cmp src, dst`.
+bool evaluateCondition(IRCondCode cond, int dst, int src);
+IRCondCode negateCondition(IRCondCode cond);
+// Condition code that holds for `cmp dst, src` whenever cond holds for `cmp src, dst`.
+IRCondCode swapCondition(IRCondCode cond);
+
+// Dense numbering of the storage locations a function touches: the hard
+// registers first (in IRRegister order), then every entry of the pseudo
+// table in order. Immediates and stack slots have no location.
+class LocationIndex {
+public:
+    explicit LocationIndex(const IRFunction& fn) : pseudoCount(static_cast<int>(fn.pseudos.size())) {}
+
+    int size() const { return kIRRegisterCount + pseudoCount; }
+    int reg(IRRegister r) const { return static_cast<int>(r); }
+    int pseudo(int id) const { return kIRRegisterCount + id; }
+    bool isRegister(int loc) const { return loc < kIRRegisterCount; }
+    // Location of a register or pseudo operand, -1 for anything else.
+    int find(const IROperand& op) const {
+        if (op.isReg()) return reg(op.asReg());
+        if (op.isPseudo()) return pseudo(op.asPseudo());
+        return -1;
+    }
+    // Pseudo index of a location that is not a register.
+    int pseudoAt(int loc) const { return loc - kIRRegisterCount; }
+
+private:
+    int pseudoCount;
+};
+
+// Deletes Mov/Unary/Binary/SetCC instructions writing pseudos that no
+// instruction ever reads. Returns true if anything was removed.
+bool removeUnusedPseudoDefinitions(IRFunction& fn);
+
+// Removes jumps (conditional or not) to the label that immediately follows
+// them. Returns true if anything was removed.
+bool removeJumpsToNext(IRFunction& fn);
+
+// Adds a pseudo with a unique name to the function's table, for values
+// introduced by optimization passes.
+IROperand makePassTemp(IRFunction& fn, const std::string& hint);
+
+#endif // COMPILER_IR_UTILS_H
@@ -56,17 +56,34 @@ std::vector<Token> Lexer::tokenize(const std::string& input) {
         position = 3;
     }
 
+    // Lines are counted lazily, up to the start of each token.
+    int line = 1;
+    size_t counted = 0;
+    auto lineAt = [&](size_t end) {
+        for (; counted < end; ++counted) {
+            if (input[counted] == '\n') ++line;
+        }
+        return line;
+    };
+
     while (position < input.length()) {
         if (std::isspace(input[position])) {
             position++;
             continue;
         }
 
-        // Preprocessor directives: skip entire line starting with '#'
+        // Preprocessor directives: skip entire line starting with '#', except
+        // `#pragma unroll`, which annotates the loop that follows.
         if (input[position] == '#') {
-            while (position < input.length() && input[position] != '\n') {
-                position++;
+            size_t lineEnd = input.find('\n', position);
+            if (lineEnd == std::string::npos) lineEnd = input.length();
+            std::string line = input.substr(position, lineEnd - position);
+            static const std::regex unrollPragma("^#\\s*pragma\\s+(?:GCC\\s+)?unroll\\b\\s*\\(?\\s*([0-9]*)\\s*\\)?\\s*$");
+            std::smatch match;
+            if (std::regex_match(line, match, unrollPragma)) {
+                tokens.push_back({TokenType::PRAGMA_UNROLL, match[1].str(), lineAt(position)});
             }
+            position = lineEnd;
             continue;
         }
 
@@ -91,14 +108,16 @@ std::vector<Token> Lexer::tokenize(const std::string& input) {
             continue;
         }
 
-        std::string remaining = input.substr(position);
+        // Match in place: copying the rest of the input for every token
+        // makes lexing quadratic in the file size.
         bool matched = false;
         Token bestMatch;
         bestMatch.value = "";
 
         for (const auto& def : getTokenDefinitions()) {
             std::smatch match;
-            if (std::regex_search(remaining, match, def.pattern)) {
+            if (std::regex_search(input.cbegin() + position, input.cend(), match, def.pattern,
+                                  std::regex_constants::match_continuous)) {
                 std::string matchStr = match.str();
                 if (matchStr.length() > bestMatch.value.length()) {
                     bestMatch = {def.type, matchStr};
@@ -111,6 +130,7 @@ std::vector<Token> Lexer::tokenize(const std::string& input) {
             throw std::runtime_error("Lexical error: Unexpected character at position " + std::to_string(position));
         }
 
+        bestMatch.line = lineAt(position);
         tokens.push_back(bestMatch);
         position += bestMatch.value.length();
     }
@@ -0,0 +1,217 @@
+#include "licm.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "ir_utils.h"
+#include "liveness.h"
+#include "loops.h"
+
+namespace {
+    class LoopHoister {
+    public:
+        LoopHoister(const IRFunction& fn, const CFG& cfg, const LocationIndex& locations,
+                    const Liveness& liveness, const Loop& loop)
+            : fn(fn), cfg(cfg), locations(locations), liveness(liveness), loop(loop) {
+            std::vector<int> uses;
+            std::vector<int> defs;
+            for (int id : loop.blocks) {
+                const auto& block = cfg.blocks[id];
+                for (size_t i = block.begin; i < block.end; ++i) {
+                    blockOf[i] = id;
+                    Liveness::usesAndDefs(fn.body[i], locations, uses, defs);
+                    for (int loc : defs) {
+                        auto& list = defsInLoop[loc];
+                        if (list.empty() || list.back() != i) list.push_back(i);
+                    }
+                }
+            }
+        }
+
+        // Indices of the instructions to hoist, in an order that respects
+        // their dependences.
+        std::vector<size_t> collect() {
+            bool found = true;
+            while (found) {
+                found = false;
+                for (auto& [loc, defs] : defsInLoop) {
+                    if (hoistedLocations.count(loc) || locations.isRegister(loc)) continue;
+                    std::vector<size_t> group;
+                    if (hoistableGroup(loc, defs, group)) {
+                        hoistedLocations.insert(loc);
+                        order.insert(order.end(), group.begin(), group.end());
+                        found = true;
+                    }
+                }
+            }
+            return order;
+        }
+
+    private:
+        const IRFunction& fn;
+        const CFG& cfg;
+        const LocationIndex& locations;
+        const Liveness& liveness;
+        const Loop& loop;
+        std::unordered_map<size_t, int> blockOf;
+        std::map<int, std::vector<size_t>> defsInLoop;
+        std::unordered_set<int> hoistedLocations;
+        std::vector<size_t> order;
+
+        bool isInvariant(const IROperand& op) const {
+            if (op.isImm()) return true;
+            int loc = locations.find(op);
+            if (loc < 0 || locations.isRegister(loc)) return false;
+            return defsInLoop.count(loc) == 0 || hoistedLocations.count(loc) != 0;
+        }
+
+        bool readsAreInvariant(const IRInstruction& inst, int self) const {
+            bool ok = true;
+            forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+                int loc = locations.find(op);
+                if (role != OperandRole::Read && loc == self) return;
+                if (role == OperandRole::Read && !isInvariant(op)) ok = false;
+                if (role != OperandRole::Read && loc != self) ok = false;
+            });
+            return ok;
+        }
+
+        // Nothing reads flags between `index` and the next flags writer in its block.
+        bool flagsDeadAfter(size_t index) const {
+            const auto& block = cfg.blocks[blockOf.at(index)];
+            for (size_t i = index + 1; i < block.end; ++i) {
+                if (readsFlags(fn.body[i])) return false;
+                if (writesFlags(fn.body[i])) return true;
+            }
+            return true;
+        }
+
+        bool referencedOnlyBy(int loc, size_t from, size_t to, const std::vector<size_t>& group) const {
+            for (size_t i = from; i <= to; ++i) {
+                if (std::find(group.begin(), group.end(), i) != group.end()) continue;
+                bool references = false;
+                forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole) {
+                    if (locations.find(op) == loc) references = true;
+                });
+                if (references) return false;
+            }
+            return true;
+        }
+
+        bool hoistableGroup(int loc, const std::vector<size_t>& defs, std::vector<size_t>& group) {
+            // The value must be produced afresh on every iteration before any use.
+            if (liveness.isLiveIn(loop.header, loc)) return false;
+            int block = blockOf.at(defs.front());
+            for (size_t d : defs) {
+                if (blockOf.at(d) != block) return false;
+            }
+            if (auto* m = std::get_if<IRMov>(&fn.body[defs.front()]);
+                m && defs.size() == 1 && m->src.isReg()) {
+                return divisionGroup(defs.front(), group);
+            }
+            if (!referencedOnlyBy(loc, defs.front(), defs.back(), defs)) return false;
+
+            bool first = true;
+            for (size_t d : defs) {
+                const auto& inst = fn.body[d];
+                bool value = std::get_if<IRMov>(&inst) || std::get_if<IRUnary>(&inst)
+                    || std::get_if<IRBinary>(&inst);
+                if (std::get_if<IRSetCC>(&inst)) {
+                    // mov $0, t; cmp; setcc t  -- the comparison moves along.
+                    if (d != defs.back() || defs.size() != 2 || d != defs.front() + 2) return false;
+                    auto* cmp = std::get_if<IRCmp>(&fn.body[d - 1]);
+                    if (cmp == nullptr || !isInvariant(cmp->src) || !isInvariant(cmp->dst) || !flagsDeadAfter(d)) {
+                        return false;
+                    }
+                    group.push_back(d - 1);
+                    value = true;
+                }
+                if (!value || !readsAreInvariant(inst, loc)) return false;
+                // The chain starts with a plain write.
+                if (first && std::get_if<IRMov>(&inst) == nullptr) return false;
+                if (writesFlags(inst) && !flagsDeadAfter(d)) return false;
+                first = false;
+                group.push_back(d);
+            }
+            return true;
+        }
+
+        // mov X, %eax; cdq; idiv $c; mov %eax|%edx, t
+        bool divisionGroup(size_t last, std::vector<size_t>& group) const {
+            if (last < 3) return false;
+            size_t first = last - 3;
+            if (blockOf.count(first) == 0 || blockOf.at(first) != blockOf.at(last)) return false;
+            auto* load = std::get_if<IRMov>(&fn.body[first]);
+            auto* cdq = std::get_if<IRCdq>(&fn.body[first + 1]);
+            auto* div = std::get_if<IRIdiv>(&fn.body[first + 2]);
+            auto* store = std::get_if<IRMov>(&fn.body[last]);
+            if (!load || !cdq || !div || !store) return false;
+            if (load->dst != IROperand::reg(IRRegister::AX) || !isInvariant(load->src)) return false;
+            if (store->src != IROperand::reg(IRRegister::AX) && store->src != IROperand::reg(IRRegister::DX)) return false;
+            // A constant divisor other than 0 and -1 can never trap.
+            if (!div->divisor.isImm() || div->divisor.asImm() == 0 || div->divisor.asImm() == -1) return false;
+            if (!flagsDeadAfter(first + 2)) return false;
+            bool registersDead = !liveness.isLiveIn(loop.header, locations.reg(IRRegister::AX))
+                && !liveness.isLiveIn(loop.header, locations.reg(IRRegister::DX));
+            liveness.forEachInstructionBackward(blockOf.at(last), [&](size_t i, const BitVector& live) {
+                if (i == last && (live.test(locations.reg(IRRegister::AX)) || live.test(locations.reg(IRRegister::DX)))) {
+                    registersDead = false;
+                }
+            });
+            if (!registersDead) return false;
+            group = {first, first + 1, first + 2, last};
+            return true;
+        }
+    };
+
+    static bool hoistOneLoop(IRFunction& fn, AnalysisManager& analyses) {
+        const CFG& cfg = analyses.cfg();
+        if (cfg.blocks.empty()) return false;
+        const LoopForest& forest = analyses.loops();
+        if (forest.loops.empty()) return false;
+        const LocationIndex& locations = analyses.locations();
+        const Liveness& liveness = analyses.liveness();
+
+        for (int id : forest.innermostFirst()) {
+            const Loop& loop = forest.loops[id];
+            LoopHoister hoister(fn, cfg, locations, liveness, loop);
+            auto indices = hoister.collect();
+            if (indices.empty()) continue;
+
+            OptimizationRemarks& remarks = analyses.remarks();
+            remarks.count("instructions hoisted", static_cast<long>(indices.size()));
+            if (remarks.enabled()) {
+                remarks.applied("Hoisted", sourceLine(fn, cfg, loop),
+                                "moved " + std::to_string(indices.size()) + " invariant instructions out of the loop");
+            }
+            std::vector<IRInstruction> code;
+            for (size_t i : indices) {
+                code.push_back(fn.body[i]);
+                fn.body[i] = IRNop{};
+            }
+            insertPreheader(fn, cfg, loop, std::move(code));
+            eraseNops(fn);
+            analyses.invalidate();
+            return true;
+        }
+        return false;
+    }
+}
+
+bool LoopInvariantCodeMotion::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool LoopInvariantCodeMotion::run(IRFunction& fn, AnalysisManager& analyses) {
+    bool changed = false;
+    // Every hoist moves instructions out of at least one loop, so this terminates.
+    while (hoistOneLoop(fn, analyses)) {
+        changed = true;
+    }
+    return changed;
+}
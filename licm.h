@@ -0,0 +1,19 @@
+#ifndef COMPILER_LICM_H
+#define COMPILER_LICM_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class LoopInvariantCodeMotion {
+public:
+    // Hoists computations whose operands do not change inside a loop into a
+    // preheader, innermost loops first. Only non-trapping code moves: idiv
+    // is hoisted only for constant divisors other than 0 and -1, and a
+    // comparison moves together with the setcc that consumes its flags.
+    // Returns true if the function changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_LICM_H
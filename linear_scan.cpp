@@ -0,0 +1,147 @@
+#include "linear_scan.h"
+
+#include <algorithm>
+#include <climits>
+#include <optional>
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "ir_utils.h"
+#include "live_intervals.h"
+#include "register_allocation.h"
+
+namespace {
+    class Allocator {
+    public:
+        Allocator(IRFunction& fn, const CFG& cfg, const LocationIndex& locations, OptimizationRemarks& remarks)
+            : fn(fn), locations(locations), remarks(remarks), intervals(buildLiveIntervals(fn, cfg, locations)),
+              hint(locations.size(), -1), reg(locations.size()) {
+            for (const auto& inst : fn.body) {
+                auto* m = std::get_if<IRMov>(&inst);
+                if (m == nullptr) continue;
+                int src = locations.find(m->src);
+                int dst = locations.find(m->dst);
+                if (src >= 0 && dst >= 0) {
+                    hint[src] = dst;
+                    hint[dst] = src;
+                }
+            }
+        }
+
+        bool run() {
+            scan();
+            RegisterAssignment assignment(fn.pseudos.size());
+            bool assigned = false;
+            for (int loc = kIRRegisterCount; loc < locations.size(); ++loc) {
+                assignment[locations.pseudoAt(loc)] = reg[loc];
+                assigned = assigned || reg[loc];
+            }
+            reportAssignment(fn, assignment, remarks);
+            if (!assigned) return false;
+            assignRegisters(fn, assignment);
+            return true;
+        }
+
+    private:
+        IRFunction& fn;
+        const LocationIndex& locations;
+        OptimizationRemarks& remarks;
+        std::vector<LiveInterval> intervals;
+        std::vector<int> hint; // location of a move partner
+        std::vector<std::optional<IRRegister>> reg;
+
+        std::optional<IRRegister> hintedRegister(int loc) const {
+            int partner = hint[loc];
+            if (partner < 0) return std::nullopt;
+            if (locations.isRegister(partner)) return static_cast<IRRegister>(partner);
+            return reg[partner];
+        }
+
+        void scan() {
+            std::vector<int> unhandled;
+            for (int loc = kIRRegisterCount; loc < locations.size(); ++loc) {
+                if (!intervals[loc].empty()) unhandled.push_back(loc);
+            }
+            std::stable_sort(unhandled.begin(), unhandled.end(),
+                             [&](int a, int b) { return intervals[a].start() < intervals[b].start(); });
+
+            const auto& regs = allocatableRegisters();
+            std::vector<int> active;
+            std::vector<int> inactive;
+            for (int current : unhandled) {
+                LiveInterval& interval = intervals[current];
+                int pos = interval.start();
+                std::vector<int> stillActive;
+                for (int loc : active) {
+                    if (intervals[loc].end() <= pos) continue;
+                    (intervals[loc].covers(pos) ? stillActive : inactive).push_back(loc);
+                }
+                std::vector<int> stillInactive;
+                for (int loc : inactive) {
+                    if (intervals[loc].end() <= pos) continue;
+                    (intervals[loc].covers(pos) ? stillActive : stillInactive).push_back(loc);
+                }
+                active = std::move(stillActive);
+                inactive = std::move(stillInactive);
+
+                // How long each register stays free for the interval, ignoring
+                // the active intervals, which occupy theirs right now.
+                std::vector<int> freeUntil(kIRRegisterCount, INT_MAX);
+                for (IRRegister r : regs) {
+                    LiveInterval& fixed = intervals[locations.reg(r)];
+                    if (!fixed.empty()) {
+                        fixed.covers(pos);
+                        freeUntil[static_cast<int>(r)] = nextIntersection(fixed, interval);
+                    }
+                }
+                for (int loc : inactive) {
+                    int& limit = freeUntil[static_cast<int>(*reg[loc])];
+                    limit = std::min(limit, nextIntersection(intervals[loc], interval));
+                }
+                std::vector<bool> busy(kIRRegisterCount, false);
+                for (int loc : active) busy[static_cast<int>(*reg[loc])] = true;
+
+                auto fits = [&](IRRegister r) {
+                    return !busy[static_cast<int>(r)] && freeUntil[static_cast<int>(r)] >= interval.end();
+                };
+                std::optional<IRRegister> choice;
+                auto hinted = hintedRegister(current);
+                if (hinted && std::find(regs.begin(), regs.end(), *hinted) != regs.end() && fits(*hinted)) {
+                    choice = hinted;
+                }
+                for (size_t r = 0; r < regs.size() && !choice; ++r) {
+                    if (fits(regs[r])) choice = regs[r];
+                }
+                if (choice) {
+                    reg[current] = choice;
+                    active.push_back(current);
+                    continue;
+                }
+
+                // Take the register of the active interval that ends last,
+                // provided nothing else claims it before this one ends.
+                int victim = -1;
+                for (int loc : active) {
+                    if (freeUntil[static_cast<int>(*reg[loc])] < interval.end()) continue;
+                    if (victim < 0 || intervals[loc].end() > intervals[victim].end()) victim = loc;
+                }
+                if (victim < 0 || intervals[victim].end() <= interval.end()) continue;
+                reg[current] = reg[victim];
+                reg[victim].reset();
+                std::replace(active.begin(), active.end(), victim, current);
+            }
+        }
+    };
+}
+
+bool LinearScanAllocator::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool LinearScanAllocator::run(IRFunction& fn, AnalysisManager& analyses) {
+    const CFG& cfg = analyses.cfg();
+    if (cfg.blocks.empty()) return false;
+    Allocator allocator(fn, cfg, analyses.locations(), analyses.remarks());
+    return allocator.run();
+}
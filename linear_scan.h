@@ -0,0 +1,24 @@
+#ifndef COMPILER_LINEAR_SCAN_H
+#define COMPILER_LINEAR_SCAN_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class LinearScanAllocator {
+public:
+    // Linear-scan register allocation for the low optimization level. Each
+    // pseudo gets a live interval over the positions of IRFunction::body,
+    // split at block boundaries into one range per block it is live in, so
+    // the interval has holes wherever the value is dead between blocks.
+    // Intervals are visited by start; one that finds no register free for
+    // its whole extent takes the register of the active interval ending
+    // last, which then stays in its stack slot (or stays there itself if it
+    // ends last). Neither liveness nor the scan builds per-block sets or an
+    // interference graph, so the cost grows with the size of the intervals.
+    // Returns true if the function changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_LINEAR_SCAN_H
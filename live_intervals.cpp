@@ -0,0 +1,118 @@
+#include "live_intervals.h"
+
+#include <algorithm>
+#include <climits>
+#include "liveness.h"
+
+int nextIntersection(const LiveInterval& a, const LiveInterval& b) {
+    size_t i = a.cursor;
+    size_t j = b.cursor;
+    while (i < a.ranges.size() && j < b.ranges.size()) {
+        if (a.ranges[i].to <= b.ranges[j].from) {
+            ++i;
+        } else if (b.ranges[j].to <= a.ranges[i].from) {
+            ++j;
+        } else {
+            return std::max(a.ranges[i].from, b.ranges[j].from);
+        }
+    }
+    return INT_MAX;
+}
+
+namespace {
+    // Blocks each location is live out of.
+    static std::vector<std::vector<int>> liveOutLocations(const IRFunction& fn, const CFG& cfg,
+                                                          const LocationIndex& locations) {
+        size_t blocks = cfg.blocks.size();
+        std::vector<std::vector<int>> exposed(locations.size());
+        std::vector<std::vector<int>> definers(locations.size());
+        std::vector<int> exposedIn(locations.size(), -1);
+        std::vector<int> definedIn(locations.size(), -1);
+        std::vector<int> uses;
+        std::vector<int> defs;
+        for (const auto& block : cfg.blocks) {
+            for (size_t i = block.begin; i < block.end; ++i) {
+                Liveness::usesAndDefs(fn.body[i], locations, uses, defs);
+                for (int loc : uses) {
+                    if (definedIn[loc] == block.id || exposedIn[loc] == block.id) continue;
+                    exposedIn[loc] = block.id;
+                    exposed[loc].push_back(block.id);
+                }
+                for (int loc : defs) {
+                    if (definedIn[loc] == block.id) continue;
+                    definedIn[loc] = block.id;
+                    definers[loc].push_back(block.id);
+                }
+            }
+        }
+
+        std::vector<std::vector<int>> liveOut(blocks);
+        // Per-block marks holding the location being traced.
+        std::vector<int> defines(blocks, -1);
+        std::vector<int> liveIn(blocks, -1);
+        std::vector<int> liveOutMark(blocks, -1);
+        std::vector<int> work;
+        for (int loc = 0; loc < locations.size(); ++loc) {
+            for (int b : definers[loc]) defines[b] = loc;
+            for (int b : exposed[loc]) {
+                liveIn[b] = loc;
+                work.push_back(b);
+            }
+            while (!work.empty()) {
+                int b = work.back();
+                work.pop_back();
+                for (int pred : cfg.blocks[b].preds) {
+                    if (liveOutMark[pred] == loc) continue;
+                    liveOutMark[pred] = loc;
+                    liveOut[pred].push_back(loc);
+                    if (defines[pred] != loc && liveIn[pred] != loc) {
+                        liveIn[pred] = loc;
+                        work.push_back(pred);
+                    }
+                }
+            }
+        }
+        return liveOut;
+    }
+
+    // Ranges are added back to front while walking the function backward,
+    // so the earliest range so far is at the back until they are reversed.
+    static void addRange(std::vector<LiveRange>& ranges, int from, int to) {
+        if (!ranges.empty() && ranges.back().from <= to) {
+            ranges.back().from = std::min(ranges.back().from, from);
+            ranges.back().to = std::max(ranges.back().to, to);
+        } else {
+            ranges.push_back(LiveRange{from, to});
+        }
+    }
+
+    static void define(std::vector<LiveRange>& ranges, int pos) {
+        if (ranges.empty() || ranges.back().from > pos) {
+            ranges.push_back(LiveRange{pos, pos + 1}); // never read
+        } else {
+            ranges.back().from = pos;
+        }
+    }
+}
+
+std::vector<LiveInterval> buildLiveIntervals(const IRFunction& fn, const CFG& cfg, const LocationIndex& locations) {
+    std::vector<LiveInterval> intervals(locations.size());
+    auto liveOut = liveOutLocations(fn, cfg, locations);
+    std::vector<int> uses;
+    std::vector<int> defs;
+    for (auto block = cfg.blocks.rbegin(); block != cfg.blocks.rend(); ++block) {
+        int blockStart = readPosition(block->begin);
+        for (int loc : liveOut[block->id]) {
+            addRange(intervals[loc].ranges, blockStart, readPosition(block->end));
+        }
+        for (size_t i = block->end; i-- > block->begin;) {
+            Liveness::usesAndDefs(fn.body[i], locations, uses, defs);
+            for (int loc : defs) define(intervals[loc].ranges, writePosition(i));
+            for (int loc : uses) addRange(intervals[loc].ranges, blockStart, writePosition(i));
+        }
+    }
+    for (auto& interval : intervals) {
+        std::reverse(interval.ranges.begin(), interval.ranges.end());
+    }
+    return intervals;
+}
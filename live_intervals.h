@@ -0,0 +1,48 @@
+#ifndef COMPILER_LIVE_INTERVALS_H
+#define COMPILER_LIVE_INTERVALS_H
+
+#include <cstddef>
+#include <vector>
+#include "cfg.h"
+#include "ir.h"
+#include "ir_utils.h"
+
+// Instruction i of IRFunction::body reads its operands at position 2i and
+// writes its results at 2i + 1, so a value dying at an instruction does not
+// overlap one the instruction defines.
+inline int readPosition(size_t i) { return static_cast<int>(2 * i); }
+inline int writePosition(size_t i) { return static_cast<int>(2 * i + 1); }
+
+struct LiveRange {
+    int from; // inclusive
+    int to;   // exclusive
+};
+
+// Positions where a location holds a live value: at most one range per
+// block, since liveness is split at block boundaries, so the interval has
+// holes wherever the value is dead between blocks.
+struct LiveInterval {
+    std::vector<LiveRange> ranges; // sorted, disjoint
+    size_t cursor = 0;             // first range not ending before the scan position
+
+    bool empty() const { return ranges.empty(); }
+    int start() const { return ranges.front().from; }
+    int end() const { return ranges.back().to; }
+
+    // Advances the cursor to `pos`, which must never decrease between calls.
+    bool covers(int pos) {
+        while (cursor < ranges.size() && ranges[cursor].to <= pos) ++cursor;
+        return cursor < ranges.size() && ranges[cursor].from <= pos;
+    }
+};
+
+// First position both intervals cover at or after their cursors, or INT_MAX.
+int nextIntersection(const LiveInterval& a, const LiveInterval& b);
+
+// Intervals of every location, indexed like `locations`. Liveness is traced
+// per location from the blocks reading it before any write back to the
+// blocks writing it, so the cost is proportional to the size of the
+// intervals rather than to blocks times locations.
+std::vector<LiveInterval> buildLiveIntervals(const IRFunction& fn, const CFG& cfg, const LocationIndex& locations);
+
+#endif // COMPILER_LIVE_INTERVALS_H
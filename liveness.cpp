@@ -0,0 +1,94 @@
+#include "liveness.h"
+
+#include <utility>
+#include "dataflow.h"
+
+void Liveness::usesAndDefs(const IRInstruction& inst, const LocationIndex& locations,
+                           std::vector<int>& uses, std::vector<int>& defs) {
+    uses.clear();
+    defs.clear();
+    forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+        int loc = locations.find(op);
+        if (loc < 0) return;
+        if (role != OperandRole::Write) uses.push_back(loc);
+        if (role != OperandRole::Read) defs.push_back(loc);
+    });
+    for (IRRegister r : implicitReads(inst)) uses.push_back(locations.reg(r));
+    for (IRRegister r : implicitWrites(inst)) defs.push_back(locations.reg(r));
+}
+
+void Liveness::transfer(const IRInstruction& inst, const LocationIndex& locations, BitVector& live) {
+    // Kill every definition before adding the uses, so that a ReadWrite
+    // operand stays live.
+    forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+        int loc = locations.find(op);
+        if (loc >= 0 && role != OperandRole::Read) live.reset(loc);
+    });
+    for (IRRegister r : implicitWrites(inst)) live.reset(locations.reg(r));
+    forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+        int loc = locations.find(op);
+        if (loc >= 0 && role != OperandRole::Write) live.set(loc);
+    });
+    for (IRRegister r : implicitReads(inst)) live.set(locations.reg(r));
+}
+
+Liveness Liveness::compute(const IRFunction& fn, const CFG& cfg, const LocationIndex& locations) {
+    Liveness result;
+    result.function = &fn;
+    result.graph = &cfg;
+    result.index = &locations;
+    result.scratch = BitVector(locations.size());
+
+    // Number the locations some block reads before writing them.
+    std::vector<int> uses;
+    std::vector<int> defs;
+    std::vector<int> writtenIn(locations.size(), -1);
+    result.global.assign(locations.size(), -1);
+    for (const auto& block : cfg.blocks) {
+        for (size_t i = block.begin; i < block.end; ++i) {
+            usesAndDefs(fn.body[i], locations, uses, defs);
+            for (int loc : uses) {
+                if (writtenIn[loc] == block.id || result.global[loc] >= 0) continue;
+                result.global[loc] = static_cast<int>(result.locationOf.size());
+                result.locationOf.push_back(loc);
+            }
+            for (int loc : defs) writtenIn[loc] = block.id;
+        }
+    }
+
+    // gen = upward-exposed uses, kill = definitions.
+    int size = static_cast<int>(result.locationOf.size());
+    GenKillProblem problem(DataflowDirection::Backward, DataflowMeet::Union, cfg.blocks.size(), size);
+    for (const auto& block : cfg.blocks) {
+        BitVector& gen = problem.gen(block.id);
+        BitVector& kill = problem.kill(block.id);
+        for (size_t i = block.end; i-- > block.begin;) {
+            usesAndDefs(fn.body[i], locations, uses, defs);
+            for (int loc : defs) {
+                if (result.global[loc] < 0) continue;
+                kill.set(result.global[loc]);
+                gen.reset(result.global[loc]);
+            }
+            for (int loc : uses) {
+                if (result.global[loc] >= 0) gen.set(result.global[loc]);
+            }
+        }
+    }
+    auto solution = solveDataflow(cfg, problem);
+    result.in = std::move(solution.in);
+    result.out = std::move(solution.out);
+    return result;
+}
+
+void Liveness::forEachInstructionBackward(int block,
+                                          const std::function<void(size_t, const BitVector&)>& fn) const {
+    const auto& b = graph->blocks[block];
+    BitVector& live = scratch;
+    forEachLiveOut(block, [&](int loc) { live.set(loc); });
+    for (size_t i = b.end; i-- > b.begin;) {
+        fn(i, live);
+        transfer(function->body[i], *index, live);
+    }
+    // What is left is exactly the live-in set.
+    forEachLiveIn(block, [&](int loc) { live.reset(loc); });
+}
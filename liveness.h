@@ -0,0 +1,60 @@
+#ifndef COMPILER_LIVENESS_H
+#define COMPILER_LIVENESS_H
+
+#include <functional>
+#include <vector>
+#include "bit_vector.h"
+#include "cfg.h"
+#include "ir.h"
+#include "ir_utils.h"
+
+// Backward live-variable analysis over the locations of a LocationIndex
+// (hard registers and pseudos). Condition flags are not tracked: they never
+// live across a CFG edge, so passes handle them within a block.
+//
+// Only locations read before being written in some block can be live
+// across an edge. Per-block sets are kept over those alone, so memory grows
+// with the variables that cross blocks, not with every temporary.
+//
+// The result refers to instruction indices of the CFG it was computed on and
+// is only valid until the function body is modified.
+class Liveness {
+public:
+    static Liveness compute(const IRFunction& fn, const CFG& cfg, const LocationIndex& locations);
+
+    bool isLiveIn(int block, int loc) const { return global[loc] >= 0 && in[block].test(global[loc]); }
+    bool isLiveOut(int block, int loc) const { return global[loc] >= 0 && out[block].test(global[loc]); }
+    template <typename F>
+    void forEachLiveIn(int block, F&& fn) const {
+        in[block].forEach([&](int g) { fn(locationOf[g]); });
+    }
+    template <typename F>
+    void forEachLiveOut(int block, F&& fn) const {
+        out[block].forEach([&](int g) { fn(locationOf[g]); });
+    }
+
+    // Walks the block from its last instruction to its first, passing each
+    // instruction index together with the locations live right after it.
+    void forEachInstructionBackward(int block,
+                                    const std::function<void(size_t, const BitVector&)>& fn) const;
+
+    // Locations an instruction reads and writes, including implicit registers.
+    // A Binary/Unary/SetCC destination is both used and defined.
+    static void usesAndDefs(const IRInstruction& inst, const LocationIndex& locations,
+                            std::vector<int>& uses, std::vector<int>& defs);
+    // live = (live - defs(inst)) | uses(inst)
+    static void transfer(const IRInstruction& inst, const LocationIndex& locations, BitVector& live);
+
+private:
+    const IRFunction* function = nullptr;
+    const CFG* graph = nullptr;
+    const LocationIndex* index = nullptr;
+    std::vector<int> global;     // per location: its bit in the block sets, or -1
+    std::vector<int> locationOf; // per bit: the location
+    std::vector<BitVector> in;
+    std::vector<BitVector> out;
+    // Every location, for forEachInstructionBackward; empty between calls.
+    mutable BitVector scratch;
+};
+
+#endif // COMPILER_LIVENESS_H
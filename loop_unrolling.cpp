@@ -0,0 +1,311 @@
+#include "loop_unrolling.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "ir_utils.h"
+#include "loops.h"
+
+namespace {
+    // Instructions a fully unrolled loop may occupy, without and with a pragma.
+    constexpr int64_t kFullUnrollBudget = 64;
+    constexpr int64_t kPragmaUnrollBudget = 4096;
+    // Instructions the copies of a partially unrolled loop may occupy.
+    constexpr int64_t kPartialUnrollBudget = 160;
+
+    static bool fitsInt(int64_t v) {
+        return v >= std::numeric_limits<int32_t>::min() && v <= std::numeric_limits<int32_t>::max();
+    }
+
+    class LoopUnroller {
+    public:
+        LoopUnroller(IRFunction& fn, const CFG& cfg, const Dominators& dominators, const LoopForest& forest,
+                     const Loop& loop, int factor)
+            : fn(fn), cfg(cfg), dominators(dominators), forest(forest), loop(loop), factor(factor) {}
+
+        // Why run() left the loop alone, or nullptr when unrolling was not
+        // asked for.
+        const char* reason = nullptr;
+        // Iterations per block of the unrolled loop, 0 if none is left.
+        int unrolledBy = 0;
+
+        // Labels of the headers of the loops the result contains, or nullopt if
+        // the loop was left alone.
+        std::optional<std::vector<int>> run() {
+            if (!loop.children.empty()) return leave("the loop contains another loop");
+            if (!isContiguous()) return leave("the loop has several back edges or exits");
+            auto found = findExitTest(fn, cfg, loop);
+            if (!found) return leave("the loop has no counted exit test");
+            test = *found;
+            const auto& header = cfg.blocks[loop.header];
+            begin = header.begin;
+            end = cfg.blocks[loop.latches[0]].end;
+            headerName = std::get_if<IRLabel>(&fn.body[begin])->id;
+            line = std::get_if<IRLabel>(&fn.body[begin])->line;
+            int hint = std::get_if<IRLabel>(&fn.body[begin])->unroll;
+            if (hint == 1 || (hint == 0 && factor < 2)) return std::nullopt;
+            if (!findStep()) return leave("the loop counter does not change by a constant step");
+
+            int64_t size = static_cast<int64_t>(end - begin);
+            int unroll = hint > 1 ? hint : factor;
+            int64_t budget = hint != 0 ? kPragmaUnrollBudget : kPartialUnrollBudget;
+            auto start = constantOnEntry(fn, cfg, dominators, forest, loop, test.counter);
+            if (start && test.bound.isImm()) {
+                auto trips = iterationsUntilExit(test.continueCond, *start + step, step, test.bound.asImm());
+                if (!trips) return leave("the loop does not terminate within the int range");
+                int64_t fullBudget = hint != 0 ? kPragmaUnrollBudget : kFullUnrollBudget;
+                if (*trips * size <= fullBudget && (hint <= 1 || *trips <= hint)) {
+                    return unrollFully(*trips);
+                }
+                while (unroll > 1 && unroll * size > budget) --unroll;
+                if (unroll < 2) return leave("the loop is too large to unroll");
+                if (*trips <= unroll) return leave("the loop is too large to unroll fully and too short to unroll partially");
+                return unrollWithPrologue(*trips, unroll);
+            }
+            while (unroll > 1 && (unroll + 1) * size > budget) --unroll;
+            if (unroll < 2) return leave("the loop is too large to unroll");
+            if (!start) return leave("the counter does not start from a constant");
+            if (!invariantBound()) return leave("the loop bound changes inside the loop");
+            return unrollWithRemainder(*start, unroll);
+        }
+
+    private:
+        IRFunction& fn;
+        const CFG& cfg;
+        const Dominators& dominators;
+        const LoopForest& forest;
+        const Loop& loop;
+        int factor;
+        ExitTest test;
+        size_t begin = 0;
+        size_t end = 0;
+        int headerName = 0;
+        int line = 0;
+        int64_t step = 0;
+
+        std::nullopt_t leave(const char* why) {
+            reason = why;
+            return std::nullopt;
+        }
+
+        // The blocks from the header to the single latch are laid out
+        // together and only the latch leaves the loop.
+        bool isContiguous() const {
+            if (loop.latches.size() != 1) return false;
+            int latch = loop.latches[0];
+            if (latch < loop.header || loop.blocks.size() != static_cast<size_t>(latch - loop.header + 1)) {
+                return false;
+            }
+            for (int id : loop.blocks) {
+                if (id < loop.header || id > latch) return false;
+                for (int succ : cfg.blocks[id].succs) {
+                    if (!loop.contains(succ) && id != latch) return false;
+                }
+            }
+            return true;
+        }
+
+        static bool writes(const IRInstruction& inst, IROperand pseudo) {
+            bool result = false;
+            forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+                if (op == pseudo && role != OperandRole::Read) result = true;
+            });
+            return result;
+        }
+
+        // The counter's only write in the loop is `add $c, i` or `sub $c, i`,
+        // executed once per iteration before the test.
+        bool findStep() {
+            const IRBinary* update = nullptr;
+            size_t index = 0;
+            for (size_t i = begin; i < end; ++i) {
+                if (!writes(fn.body[i], test.counter)) continue;
+                if (update) return false;
+                update = std::get_if<IRBinary>(&fn.body[i]);
+                index = i;
+                if (!update) return false;
+            }
+            if (!update || !update->src.isImm() || update->src.asImm() == 0) return false;
+            if (update->op == IRBinaryOperator::Add) step = update->src.asImm();
+            else if (update->op == IRBinaryOperator::Sub) step = -static_cast<int64_t>(update->src.asImm());
+            else return false;
+            int latch = loop.latches[0];
+            for (int id : loop.blocks) {
+                const auto& block = cfg.blocks[id];
+                if (index < block.begin || index >= block.end) continue;
+                return dominators.dominates(id, latch) && (id != latch || index < test.compare);
+            }
+            return false;
+        }
+
+        bool invariantBound() const {
+            if (!test.bound.isPseudo()) return false;
+            for (size_t i = begin; i < end; ++i) {
+                if (writes(fn.body[i], test.bound)) return false;
+            }
+            return true;
+        }
+
+        struct Copy {
+            std::vector<IRInstruction> code; // ends with the back edge
+            int header = 0;
+        };
+
+        // A copy of the loop whose labels are all fresh.
+        Copy copyLoop() const {
+            std::unordered_map<int, int> renamed;
+            for (size_t i = begin; i < end; ++i) {
+                if (auto* l = std::get_if<IRLabel>(&fn.body[i])) {
+                    renamed[l->id] = fn.addLabel();
+                }
+            }
+            Copy copy;
+            copy.header = renamed.at(headerName);
+            for (size_t i = begin; i < end; ++i) {
+                auto inst = fn.body[i];
+                if (auto* l = std::get_if<IRLabel>(&inst)) {
+                    l->id = renamed.at(l->id);
+                    l->unroll = 0;
+                } else if (auto* j = std::get_if<IRJump>(&inst); j && renamed.count(j->target)) {
+                    j->target = renamed.at(j->target);
+                } else if (auto* j = std::get_if<IRJumpCC>(&inst); j && renamed.count(j->target)) {
+                    j->target = renamed.at(j->target);
+                }
+                copy.code.push_back(inst);
+            }
+            return copy;
+        }
+
+        // Appends `count` iterations without their exit tests' branches; the
+        // comparisons left behind are dead.
+        void appendIterations(std::vector<IRInstruction>& code, int64_t count) const {
+            for (int64_t k = 0; k < count; ++k) {
+                Copy copy = copyLoop();
+                copy.code.pop_back();
+                for (auto& inst : copy.code) code.push_back(inst);
+            }
+        }
+
+        void replaceLoop(std::vector<IRInstruction> code) {
+            std::vector<IRInstruction> body;
+            body.reserve(fn.body.size() - (end - begin) + code.size());
+            for (size_t i = 0; i < begin; ++i) body.push_back(fn.body[i]);
+            for (auto& inst : code) body.push_back(inst);
+            for (size_t i = end; i < fn.body.size(); ++i) body.push_back(fn.body[i]);
+            fn.body = std::move(body);
+        }
+
+        std::vector<int> unrollFully(int64_t trips) {
+            std::vector<IRInstruction> code;
+            code.push_back(IRLabel(headerName));
+            appendIterations(code, trips);
+            replaceLoop(std::move(code));
+            return {};
+        }
+
+        // trips = r + m*unroll with m >= 1: peel r iterations, then loop over
+        // blocks of `unroll` iterations tested only at their end.
+        std::vector<int> unrollWithPrologue(int64_t trips, int unroll) {
+            std::vector<IRInstruction> code;
+            code.push_back(IRLabel(headerName));
+            appendIterations(code, trips % unroll);
+            int mainHeader = fn.addLabel();
+            code.push_back(IRLabel(mainHeader, 0, line));
+            appendIterations(code, unroll - 1);
+            Copy last = copyLoop();
+            std::get_if<IRJumpCC>(&last.code.back())->target = mainHeader;
+            for (auto& inst : last.code) code.push_back(inst);
+            replaceLoop(std::move(code));
+            unrolledBy = unroll;
+            return {mainHeader};
+        }
+
+        // With i entering as `start` and the test `cond(i, n)` for an invariant
+        // n, a block of `unroll` iterations runs whole exactly when
+        // cond(i + (unroll-1)*step, n), i.e. cond(i, n - (unroll-1)*step). The
+        // entry check uses the constant start; once it passed, the limit
+        // cannot overflow. Leftover iterations run in a copy of the loop.
+        std::optional<std::vector<int>> unrollWithRemainder(int start, int unroll) {
+            IRCondCode cond = test.continueCond;
+            bool upward = step > 0 && (cond == IRCondCode::L || cond == IRCondCode::LE);
+            bool downward = step < 0 && (cond == IRCondCode::G || cond == IRCondCode::GE);
+            int64_t span = (unroll - 1) * step;
+            if ((!upward && !downward) || !fitsInt(start + span) || !fitsInt(-span)) {
+                return leave("the exit test cannot be moved to the end of the unrolled iterations");
+            }
+
+            IROperand limit = makePassTemp(fn, "unroll.limit");
+            int mainHeader = fn.addLabel();
+            int exit = fn.addLabel();
+            Copy remainder = copyLoop();
+
+            std::vector<IRInstruction> code;
+            code.push_back(IRLabel(headerName));
+            code.push_back(IRMov(test.bound, limit));
+            code.push_back(IRBinary(IRBinaryOperator::Add, IROperand::imm(static_cast<int>(-span)), limit));
+            code.push_back(IRCmp(test.bound, IROperand::imm(static_cast<int>(start + span))));
+            code.push_back(IRJumpCC(negateCondition(cond), remainder.header));
+            code.push_back(IRLabel(mainHeader, 0, line));
+            appendIterations(code, unroll);
+            code.push_back(IRCmp(limit, test.counter));
+            code.push_back(IRJumpCC(cond, mainHeader));
+            code.push_back(IRCmp(test.bound, test.counter));
+            code.push_back(IRJumpCC(negateCondition(cond), exit));
+            for (auto& inst : remainder.code) code.push_back(inst);
+            code.push_back(IRLabel(exit));
+            replaceLoop(std::move(code));
+            unrolledBy = unroll;
+            return std::vector<int>{mainHeader, remainder.header};
+        }
+    };
+}
+
+bool LoopUnrolling::run(IRFunction& fn, int factor) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses, factor);
+}
+
+bool LoopUnrolling::run(IRFunction& fn, AnalysisManager& analyses, int factor) {
+    bool changed = false;
+    OptimizationRemarks& remarks = analyses.remarks();
+    std::unordered_set<int> done;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        const CFG& cfg = analyses.cfg();
+        if (cfg.blocks.empty()) break;
+        const Dominators& dominators = analyses.dominators();
+        const LoopForest& forest = analyses.loops();
+        for (const auto& loop : forest.loops) {
+            auto* label = std::get_if<IRLabel>(&fn.body[cfg.blocks[loop.header].begin]);
+            if (!label || !done.insert(label->id).second) continue;
+            LoopUnroller unroller(fn, cfg, dominators, forest, loop, factor);
+            int line = sourceLine(fn, cfg, loop);
+            auto loops = unroller.run();
+            if (!loops) {
+                if (unroller.reason && remarks.enabled()) remarks.missed("NotUnrolled", line, unroller.reason);
+                continue;
+            }
+            analyses.invalidate();
+            if (unroller.unrolledBy == 0) {
+                remarks.count("loops fully unrolled");
+                remarks.applied("FullyUnrolled", line, "replaced the loop by copies of every iteration");
+            } else {
+                remarks.count("loops unrolled");
+                if (remarks.enabled()) {
+                    remarks.applied("Unrolled", line,
+                                    "unrolled the loop by a factor of " + std::to_string(unroller.unrolledBy));
+                }
+            }
+            done.insert(loops->begin(), loops->end());
+            progress = changed = true;
+            break;
+        }
+    }
+    return changed;
+}
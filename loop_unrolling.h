@@ -0,0 +1,25 @@
+#ifndef COMPILER_LOOP_UNROLLING_H
+#define COMPILER_LOOP_UNROLLING_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class LoopUnrolling {
+public:
+    static constexpr int kDefaultFactor = 4;
+
+    // Unrolls innermost bottom-tested loops counted by a pseudo stepped by a
+    // constant. Loops with a small constant trip count are unrolled fully;
+    // others are unrolled by `factor` (or their `#pragma unroll` count) with
+    // the intermediate exit tests removed: a constant trip count peels the
+    // remainder iterations in front of the unrolled loop, an invariant bound
+    // runs the leftover iterations in a copy of the original loop. Size
+    // budgets limit the growth. A factor below 2 leaves loops without a pragma
+    // alone.
+    // Returns true if the function changed.
+    static bool run(IRFunction& fn, int factor = kDefaultFactor);
+    static bool run(IRFunction& fn, AnalysisManager& analyses, int factor = kDefaultFactor);
+};
+
+#endif // COMPILER_LOOP_UNROLLING_H
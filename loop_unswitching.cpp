@@ -0,0 +1,198 @@
+#include "loop_unswitching.h"
+
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "ir_utils.h"
+#include "loops.h"
+
+namespace {
+    // Instructions a loop may have to be duplicated, and instructions
+    // unswitching may add to a function in total.
+    constexpr size_t kMaxLoopSize = 128;
+    constexpr size_t kGrowthBudget = 384;
+
+    class LoopUnswitcher {
+    public:
+        LoopUnswitcher(IRFunction& fn, const CFG& cfg, const Loop& loop) : fn(fn), cfg(cfg), loop(loop) {}
+
+        // Size of the loop's code if it can be unswitched, else nullopt.
+        std::optional<size_t> candidate() {
+            if (!findRange() || !findBranch()) return std::nullopt;
+            return end - begin;
+        }
+
+        void unswitch() {
+            auto* label = std::get_if<IRLabel>(&fn.body[begin]);
+            int headerName = label->id;
+            int exit = fn.addLabel();
+            IRCmp cmp = *std::get_if<IRCmp>(&fn.body[compare]);
+
+            Copy taken = copyLoop(true);
+            Copy notTaken = copyLoop(false);
+            std::vector<IRInstruction> code;
+            code.push_back(IRLabel(headerName));
+            code.push_back(cmp);
+            code.push_back(IRJumpCC(cond, taken.header));
+            for (auto& inst : notTaken.code) code.push_back(inst);
+            code.push_back(IRJump(exit));
+            for (auto& inst : taken.code) code.push_back(inst);
+            code.push_back(IRLabel(exit));
+
+            std::vector<IRInstruction> body;
+            body.reserve(fn.body.size() + code.size());
+            for (size_t i = 0; i < begin; ++i) body.push_back(fn.body[i]);
+            for (auto& inst : code) body.push_back(inst);
+            for (size_t i = end; i < fn.body.size(); ++i) body.push_back(fn.body[i]);
+            fn.body = std::move(body);
+        }
+
+    private:
+        IRFunction& fn;
+        const CFG& cfg;
+        const Loop& loop;
+        size_t begin = 0;
+        size_t end = 0;
+        size_t compare = 0;
+        size_t branch = 0; // the jcc or cmov reading the invariant compare
+        IRCondCode cond = IRCondCode::E;
+
+        // The loop's blocks must be laid out together, starting at its labelled header.
+        bool findRange() {
+            int first = loop.blocks.front();
+            int last = loop.blocks.back();
+            if (first != loop.header || loop.blocks.size() != static_cast<size_t>(last - first + 1)) return false;
+            begin = cfg.blocks[first].begin;
+            end = cfg.blocks[last].end;
+            return std::get_if<IRLabel>(&fn.body[begin]) != nullptr;
+        }
+
+        bool writtenInLoop(const IROperand& op) const {
+            if (op.isImm()) return false;
+            if (!op.isPseudo()) return true;
+            for (size_t i = begin; i < end; ++i) {
+                bool writes = false;
+                forEachOperand(fn.body[i], [&](const IROperand& o, OperandRole role) {
+                    if (o == op && role != OperandRole::Read) writes = true;
+                });
+                if (writes) return true;
+            }
+            return false;
+        }
+
+        // A `cmp a, b` where neither a nor b changes in the loop, whose
+        // flags decide a jcc or, after if-conversion, a cmov.
+        bool findBranch() {
+            for (int id : loop.blocks) {
+                const auto& block = cfg.blocks[id];
+                for (size_t i = block.begin; i < block.end; ++i) {
+                    auto* cmp = std::get_if<IRCmp>(&fn.body[i]);
+                    if (!cmp || writtenInLoop(cmp->src) || writtenInLoop(cmp->dst)) continue;
+                    for (size_t k = i + 1; k < block.end && !writesFlags(fn.body[k]); ++k) {
+                        if (auto* jump = std::get_if<IRJumpCC>(&fn.body[k])) {
+                            cond = jump->cond;
+                        } else if (auto* select = std::get_if<IRCMov>(&fn.body[k])) {
+                            cond = select->cond;
+                        } else {
+                            continue;
+                        }
+                        compare = i;
+                        branch = k;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        struct Copy {
+            std::vector<IRInstruction> code;
+            int header = 0;
+        };
+
+        // A copy of the loop with fresh labels in which the invariant branch
+        // is always or never taken, or the cmov always or never moves.
+        Copy copyLoop(bool taken) const {
+            std::unordered_map<int, int> renamed;
+            for (size_t i = begin; i < end; ++i) {
+                if (auto* l = std::get_if<IRLabel>(&fn.body[i])) {
+                    renamed[l->id] = fn.addLabel();
+                }
+            }
+            auto target = [&](int label) {
+                auto it = renamed.find(label);
+                return it == renamed.end() ? label : it->second;
+            };
+            Copy copy;
+            copy.header = renamed.at(std::get_if<IRLabel>(&fn.body[begin])->id);
+            for (size_t i = begin; i < end; ++i) {
+                if (i == branch) {
+                    if (auto* j = std::get_if<IRJumpCC>(&fn.body[i]); j && taken) {
+                        copy.code.push_back(IRJump(target(j->target)));
+                    } else if (auto* c = std::get_if<IRCMov>(&fn.body[i]); c && taken) {
+                        copy.code.push_back(IRMov(c->src, c->dst));
+                    }
+                    continue;
+                }
+                auto inst = fn.body[i];
+                if (auto* l = std::get_if<IRLabel>(&inst)) {
+                    l->id = renamed.at(l->id);
+                } else if (auto* j = std::get_if<IRJump>(&inst)) {
+                    j->target = target(j->target);
+                } else if (auto* j = std::get_if<IRJumpCC>(&inst)) {
+                    j->target = target(j->target);
+                }
+                copy.code.push_back(inst);
+            }
+            return copy;
+        }
+    };
+}
+
+bool LoopUnswitching::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool LoopUnswitching::run(IRFunction& fn, AnalysisManager& analyses) {
+    bool changed = false;
+    size_t growth = 0;
+    OptimizationRemarks& remarks = analyses.remarks();
+    std::unordered_set<int> reported; // header labels of loops given a missed remark
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        const CFG& cfg = analyses.cfg();
+        if (cfg.blocks.empty()) break;
+        const LoopForest& forest = analyses.loops();
+        for (int id : forest.innermostFirst()) {
+            const Loop& loop = forest.loops[id];
+            LoopUnswitcher unswitcher(fn, cfg, loop);
+            auto size = unswitcher.candidate();
+            if (!size) continue;
+            int line = sourceLine(fn, cfg, loop);
+            if (*size > kMaxLoopSize || growth + *size > kGrowthBudget) {
+                int header = std::get_if<IRLabel>(&fn.body[cfg.blocks[loop.header].begin])->id;
+                if (remarks.enabled() && reported.insert(header).second) {
+                    remarks.missed("NotUnswitched", line,
+                                   *size > kMaxLoopSize ? "the loop is too large to duplicate"
+                                                        : "the function has used up its code growth budget");
+                }
+                continue;
+            }
+            unswitcher.unswitch();
+            analyses.invalidate();
+            remarks.count("loops unswitched");
+            if (remarks.enabled()) {
+                remarks.applied("Unswitched", line, "duplicated the loop for each outcome of an invariant condition");
+            }
+            growth += *size;
+            progress = changed = true;
+            break;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,19 @@
+#ifndef COMPILER_LOOP_UNSWITCHING_H
+#define COMPILER_LOOP_UNSWITCHING_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class LoopUnswitching {
+public:
+    // Finds conditional branches and cmovs inside loops that compare values
+    // the loop never writes, and replaces the loop by two copies, one for
+    // each outcome, selected by a single test where the loop was entered. Loops
+    // larger than a size limit are left alone and the total code added to
+    // a function is bounded. Returns true if the function changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_LOOP_UNSWITCHING_H
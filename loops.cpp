@@ -0,0 +1,326 @@
+#include "loops.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include "ir_utils.h"
+
+Dominators Dominators::compute(const CFG& cfg) {
+    // Cooper, Harvey and Kennedy: iterate idom intersection in reverse post-order.
+    Dominators result;
+    result.idom.assign(cfg.blocks.size(), -1);
+    if (cfg.blocks.empty()) {
+        return result;
+    }
+    auto rpo = cfg.reversePostOrder();
+    std::vector<int> position(cfg.blocks.size(), -1);
+    for (size_t i = 0; i < rpo.size(); ++i) {
+        position[rpo[i]] = static_cast<int>(i);
+    }
+    auto& idom = result.idom;
+    idom[0] = 0;
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (position[a] > position[b]) a = idom[a];
+            while (position[b] > position[a]) b = idom[b];
+        }
+        return a;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int id : rpo) {
+            if (id == 0) continue;
+            int newIdom = -1;
+            for (int pred : cfg.blocks[id].preds) {
+                if (idom[pred] < 0) continue;
+                newIdom = newIdom < 0 ? pred : intersect(pred, newIdom);
+            }
+            if (newIdom != idom[id]) {
+                idom[id] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    // Number the dominator tree depth-first so that dominance becomes
+    // interval containment.
+    std::vector<std::vector<int>> children(cfg.blocks.size());
+    for (int id : rpo) {
+        if (id != 0) children[idom[id]].push_back(id);
+    }
+    result.enter.assign(cfg.blocks.size(), -1);
+    result.exit.assign(cfg.blocks.size(), -1);
+    int clock = 0;
+    std::vector<std::pair<int, size_t>> stack{{0, 0}};
+    result.enter[0] = clock++;
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        if (next < children[block].size()) {
+            int child = children[block][next++];
+            result.enter[child] = clock++;
+            stack.push_back({child, 0});
+        } else {
+            result.exit[block] = clock++;
+            stack.pop_back();
+        }
+    }
+    return result;
+}
+
+bool Dominators::dominates(int a, int b) const {
+    if (idom[a] < 0 || idom[b] < 0) return false;
+    return enter[a] <= enter[b] && exit[b] <= exit[a];
+}
+
+LoopForest LoopForest::build(const CFG& cfg, const Dominators& dominators) {
+    LoopForest forest;
+    size_t n = cfg.blocks.size();
+    forest.innermost.assign(n, -1);
+    std::vector<int> loopOfHeader(n, -1);
+    // The loop whose body walk last reached each block. Walks of nested
+    // loops interleave, so a block may be walked, and listed, again.
+    std::vector<int> mark(n, -1);
+
+    for (const auto& block : cfg.blocks) {
+        for (int succ : block.succs) {
+            if (!dominators.dominates(succ, block.id)) continue;
+            // Back edge block -> succ.
+            if (loopOfHeader[succ] < 0) {
+                loopOfHeader[succ] = static_cast<int>(forest.loops.size());
+                Loop loop;
+                loop.header = succ;
+                loop.blocks.push_back(succ);
+                forest.loops.push_back(std::move(loop));
+            }
+            int index = loopOfHeader[succ];
+            Loop& loop = forest.loops[index];
+            loop.latches.push_back(block.id);
+            mark[succ] = index;
+            std::vector<int> stack{block.id};
+            while (!stack.empty()) {
+                int id = stack.back();
+                stack.pop_back();
+                if (mark[id] == index) continue;
+                mark[id] = index;
+                loop.blocks.push_back(id);
+                for (int pred : cfg.blocks[id].preds) stack.push_back(pred);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < forest.loops.size(); ++i) {
+        auto& loop = forest.loops[i];
+        std::sort(loop.blocks.begin(), loop.blocks.end());
+        loop.blocks.erase(std::unique(loop.blocks.begin(), loop.blocks.end()), loop.blocks.end());
+        for (int id : loop.blocks) mark[id] = static_cast<int>(i);
+        for (int id : loop.blocks) {
+            for (int succ : cfg.blocks[id].succs) {
+                if (mark[succ] != static_cast<int>(i)
+                    && std::find(loop.exits.begin(), loop.exits.end(), succ) == loop.exits.end()) {
+                    loop.exits.push_back(succ);
+                }
+            }
+        }
+    }
+
+    // Loops nest, so visiting them from the largest down leaves each block
+    // with its innermost loop, and the parent of a loop is the innermost
+    // loop its header was in just before.
+    std::vector<int> bySize(forest.loops.size());
+    for (size_t i = 0; i < bySize.size(); ++i) bySize[i] = static_cast<int>(i);
+    std::stable_sort(bySize.begin(), bySize.end(), [&](int a, int b) {
+        return forest.loops[a].blocks.size() > forest.loops[b].blocks.size();
+    });
+    for (int i : bySize) {
+        auto& loop = forest.loops[i];
+        loop.parent = forest.innermost[loop.header];
+        for (int id : loop.blocks) forest.innermost[id] = i;
+    }
+    for (size_t i = 0; i < forest.loops.size(); ++i) {
+        auto& loop = forest.loops[i];
+        if (loop.parent >= 0) forest.loops[loop.parent].children.push_back(static_cast<int>(i));
+        for (int p = loop.parent; p >= 0; p = forest.loops[p].parent) ++loop.depth;
+    }
+    return forest;
+}
+
+int LoopForest::depth(int block) const {
+    int loop = innermost[block];
+    return loop < 0 ? 0 : loops[loop].depth;
+}
+
+std::vector<int> LoopForest::innermostFirst() const {
+    std::vector<int> order(loops.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return loops[a].depth > loops[b].depth; });
+    return order;
+}
+
+int sourceLine(const IRFunction& fn, const CFG& cfg, const Loop& loop) {
+    auto* label = std::get_if<IRLabel>(&fn.body[cfg.blocks[loop.header].begin]);
+    return label ? label->line : 0;
+}
+
+void insertPreheader(IRFunction& fn, const CFG& cfg, const Loop& loop,
+                     std::vector<IRInstruction> code) {
+    const auto& header = cfg.blocks[loop.header];
+    auto* headerLabel = std::get_if<IRLabel>(&fn.body[header.begin]);
+    bool headerHasLabel = headerLabel != nullptr;
+    int headerName = headerHasLabel ? headerLabel->id : fn.addLabel();
+    int preheaderName = fn.addLabel();
+
+    for (const auto& block : cfg.blocks) {
+        if (loop.contains(block.id) || block.begin == block.end) continue;
+        auto& last = fn.body[block.end - 1];
+        if (auto* j = std::get_if<IRJump>(&last); j && j->target == headerName) {
+            j->target = preheaderName;
+        } else if (auto* j = std::get_if<IRJumpCC>(&last); j && j->target == headerName) {
+            j->target = preheaderName;
+        }
+    }
+
+    std::vector<IRInstruction> body;
+    body.reserve(fn.body.size() + code.size() + 3);
+    for (size_t i = 0; i < header.begin; ++i) {
+        body.push_back(fn.body[i]);
+    }
+    // A block inside the loop that falls into the header must now jump over the preheader.
+    int prev = loop.header - 1;
+    if (prev >= 0 && cfg.blocks[prev].fallthrough == loop.header && loop.contains(prev)) {
+        body.push_back(IRJump(headerName));
+    }
+    body.push_back(IRLabel(preheaderName));
+    for (auto& inst : code) {
+        body.push_back(inst);
+    }
+    if (!headerHasLabel) {
+        body.push_back(IRLabel(headerName));
+    }
+    for (size_t i = header.begin; i < fn.body.size(); ++i) {
+        body.push_back(fn.body[i]);
+    }
+    fn.body = std::move(body);
+}
+
+std::optional<ExitTest> findExitTest(const IRFunction& fn, const CFG& cfg, const Loop& loop) {
+    if (loop.latches.size() != 1) return std::nullopt;
+    const auto& header = cfg.blocks[loop.header];
+    const auto& latch = cfg.blocks[loop.latches[0]];
+    auto* label = std::get_if<IRLabel>(&fn.body[header.begin]);
+    if (!label || latch.fallthrough < 0 || loop.contains(latch.fallthrough) || latch.end - latch.begin < 2) {
+        return std::nullopt;
+    }
+    size_t last = latch.end - 1;
+    auto* jump = std::get_if<IRJumpCC>(&fn.body[last]);
+    if (!jump || jump->target != label->id) return std::nullopt;
+
+    ExitTest test;
+    test.continueCond = jump->cond;
+    size_t compare = last - 1;
+    auto* cmp = std::get_if<IRCmp>(&fn.body[compare]);
+    if (!cmp) return std::nullopt;
+    if (cmp->src == IROperand::imm(0) && cmp->dst.isPseudo() && last >= latch.begin + 4
+        && (jump->cond == IRCondCode::NE || jump->cond == IRCondCode::E)) {
+        auto* set = std::get_if<IRSetCC>(&fn.body[last - 2]);
+        auto* clear = std::get_if<IRMov>(&fn.body[last - 4]);
+        if (set && clear && set->dst == cmp->dst && clear->dst == cmp->dst
+            && std::get_if<IRCmp>(&fn.body[last - 3])) {
+            test.continueCond = jump->cond == IRCondCode::NE ? set->cond : negateCondition(set->cond);
+            compare = last - 3;
+            cmp = std::get_if<IRCmp>(&fn.body[compare]);
+        }
+    }
+    if (!cmp->dst.isPseudo() || !(cmp->src.isImm() || cmp->src.isPseudo())) {
+        return std::nullopt;
+    }
+    test.compare = compare;
+    test.bound = cmp->src;
+    test.counter = cmp->dst;
+    return test;
+}
+
+std::optional<int64_t> iterationsUntilExit(IRCondCode cond, int64_t first, int64_t step, int64_t bound) {
+    auto fits = [](int64_t v) {
+        return v >= std::numeric_limits<int32_t>::min() && v <= std::numeric_limits<int32_t>::max();
+    };
+    if (!fits(first) || !fits(bound)) return std::nullopt;
+    if (!evaluateCondition(cond, static_cast<int>(first), static_cast<int>(bound))) return 1;
+    auto ceilDiv = [](int64_t x, int64_t y) { return (x + y - 1) / y; };
+    // Index of the first tested value that fails the condition.
+    int64_t k = 0;
+    switch (cond) {
+        case IRCondCode::L:
+            if (step <= 0) return std::nullopt;
+            k = ceilDiv(bound - first, step);
+            break;
+        case IRCondCode::LE:
+            if (step <= 0) return std::nullopt;
+            k = (bound - first) / step + 1;
+            break;
+        case IRCondCode::G:
+            if (step >= 0) return std::nullopt;
+            k = ceilDiv(first - bound, -step);
+            break;
+        case IRCondCode::GE:
+            if (step >= 0) return std::nullopt;
+            k = (first - bound) / -step + 1;
+            break;
+        case IRCondCode::NE:
+            if (step == 0 || (bound - first) % step != 0 || (bound - first) / step <= 0) return std::nullopt;
+            k = (bound - first) / step;
+            break;
+        case IRCondCode::E:
+            if (step == 0) return std::nullopt;
+            k = 1;
+            break;
+    }
+    if (!fits(first + step * k)) return std::nullopt;
+    return k + 1;
+}
+
+static bool writesPseudo(const IRInstruction& inst, IROperand pseudo) {
+    bool writes = false;
+    forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+        if (op == pseudo && role != OperandRole::Read) writes = true;
+    });
+    return writes;
+}
+
+static std::optional<int> movedConstant(const IRInstruction& inst) {
+    auto* m = std::get_if<IRMov>(&inst);
+    if (m && m->src.isImm()) return m->src.asImm();
+    return std::nullopt;
+}
+
+std::optional<int> constantOnEntry(const IRFunction& fn, const CFG& cfg, const Dominators& dominators,
+                                   const LoopForest& forest, const Loop& loop, IROperand pseudo) {
+    int block = -1;
+    for (int pred : cfg.blocks[loop.header].preds) {
+        if (loop.contains(pred)) continue;
+        if (block >= 0) return std::nullopt;
+        block = pred;
+    }
+    std::vector<bool> visited(cfg.blocks.size(), false);
+    while (block >= 0 && !visited[block]) {
+        visited[block] = true;
+        const auto& b = cfg.blocks[block];
+        for (size_t i = b.end; i-- > b.begin;) {
+            if (writesPseudo(fn.body[i], pseudo)) return movedConstant(fn.body[i]);
+        }
+        block = b.preds.size() == 1 ? b.preds[0] : -1;
+    }
+
+    std::optional<int> value;
+    for (const auto& b : cfg.blocks) {
+        if (loop.contains(b.id)) continue;
+        for (size_t i = b.begin; i < b.end; ++i) {
+            if (!writesPseudo(fn.body[i], pseudo)) continue;
+            value = value ? std::nullopt : movedConstant(fn.body[i]);
+            if (!value || !dominators.dominates(b.id, loop.header) || forest.innermost[b.id] != loop.parent) {
+                return std::nullopt;
+            }
+        }
+    }
+    return value;
+}
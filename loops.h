@@ -0,0 +1,87 @@
+#ifndef COMPILER_LOOPS_H
+#define COMPILER_LOOPS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "cfg.h"
+#include "ir.h"
+
+// Immediate dominators of the reachable blocks of a CFG.
+struct Dominators {
+    std::vector<int> idom; // idom[entry] == entry, -1 for unreachable blocks
+    // Depth-first entry and exit times in the dominator tree.
+    std::vector<int> enter;
+    std::vector<int> exit;
+
+    static Dominators compute(const CFG& cfg);
+
+    bool dominates(int a, int b) const;
+};
+
+// A natural loop: the header plus every block that reaches a back edge into
+// it without passing through the header.
+struct Loop {
+    int header = 0;
+    std::vector<int> blocks;    // in layout order, header included
+    std::vector<int> latches;   // sources of back edges
+    std::vector<int> exits;     // blocks outside the loop with a predecessor inside
+    int parent = -1;            // enclosing loop, -1 for outermost loops
+    std::vector<int> children;
+    int depth = 1;              // 1 for outermost loops
+
+    bool contains(int block) const { return std::binary_search(blocks.begin(), blocks.end(), block); }
+};
+
+// All natural loops of a CFG, nested by containment. Loops sharing a header
+// are merged. Lowering only produces structured control flow, so the CFG is
+// always reducible.
+struct LoopForest {
+    std::vector<Loop> loops;
+    std::vector<int> innermost; // per block: innermost containing loop, or -1
+
+    static LoopForest build(const CFG& cfg, const Dominators& dominators);
+
+    // Loop nesting depth of a block, 0 outside any loop.
+    int depth(int block) const;
+    // Loop ids ordered so inner loops come before the loops enclosing them.
+    std::vector<int> innermostFirst() const;
+};
+
+// Source line of a loop, carried by its header label; 0 if unknown.
+int sourceLine(const IRFunction& fn, const CFG& cfg, const Loop& loop);
+
+// Places `code` on the edges entering the loop from outside: a new labelled
+// block laid out right before the header that every outside predecessor
+// jumps or falls into. Invalidates the CFG.
+void insertPreheader(IRFunction& fn, const CFG& cfg, const Loop& loop,
+                     std::vector<IRInstruction> code);
+
+// The bottom test of a rotated loop: `cmp bound, counter` deciding the back
+// edge `jcc header` that ends its only latch, either directly or through a
+// materialized boolean, `mov $0, t; cmp bound, counter; setcc t; cmp $0, t`.
+// The latch must fall through to the loop exit.
+struct ExitTest {
+    size_t compare = 0;            // index of `cmp bound, counter`
+    IROperand bound;               // immediate or pseudo
+    IROperand counter;             // pseudo
+    IRCondCode continueCond = IRCondCode::E; // loop again while cond(counter, bound)
+};
+
+std::optional<ExitTest> findExitTest(const IRFunction& fn, const CFG& cfg, const Loop& loop);
+
+// Iterations of a bottom-tested loop whose test sees first, first + step,
+// first + 2*step, ... and loops again while cond(value, bound). nullopt if
+// the test never fails or a tested value would leave the int range.
+std::optional<int64_t> iterationsUntilExit(IRCondCode cond, int64_t first, int64_t step, int64_t bound);
+
+// Constant a pseudo holds whenever control enters the loop from outside:
+// the last write found walking back from the single outside predecessor
+// while blocks have a single predecessor, or else its only write outside
+// the loop, when that dominates the header and runs once per entry.
+std::optional<int> constantOnEntry(const IRFunction& fn, const CFG& cfg, const Dominators& dominators,
+                                   const LoopForest& forest, const Loop& loop, IROperand pseudo);
+
+#endif // COMPILER_LOOPS_H
@@ -2,138 +2,162 @@
 #include <vector>
 #include <string>
 #include <functional>
-#include <unordered_set>
+#include <optional>
 #include <stdexcept> // For std::runtime_error
+#include <unordered_map>
 #include "ast.h"     // For BinaryOperator and AST definitions
 #include "ir.h"      // For IRBinaryOperator and IR definitions
+#include "ir_utils.h"
 #include "lowering.h"
-// Helper to generate fresh temporary variable names: tmp.0, tmp.1, ...
 namespace {
-    static std::string freshTempName() {
-        static int counter = 0;
-        return "tmp." + std::to_string(counter++);
+    struct LoopLabels {
+        int breakLabel;
+        int continueLabel;
+    };
+
+    // Pseudo and label numbering of the function being lowered. Variables
+    // keep their resolved names and get one pseudo each; temporaries are
+    // tmp.0, tmp.1, ... Labels are plain ids; each resolved loop label gets
+    // its own break and continue label.
+    class IdTable {
+    public:
+        IROperand variable(const std::string& name) {
+            auto [it, inserted] = variables.try_emplace(name, static_cast<int>(names.size()));
+            if (inserted) names.push_back(name);
+            return IROperand::pseudo(it->second);
+        }
+        IROperand temp() {
+            names.push_back("tmp." + std::to_string(tempCounter++));
+            return IROperand::pseudo(static_cast<int>(names.size()) - 1);
+        }
+        int label() { return labelCount++; }
+        const LoopLabels& loop(const std::string& loopId) {
+            auto it = loops.find(loopId);
+            if (it == loops.end()) {
+                int breakLabel = label();
+                it = loops.emplace(loopId, LoopLabels{breakLabel, label()}).first;
+            }
+            return it->second;
+        }
+        std::vector<std::string> names;
+        int labelCount = 0;
+
+    private:
+        std::unordered_map<std::string, int> variables;
+        std::unordered_map<std::string, LoopLabels> loops;
+        int tempCounter = 0;
+    };
+    static IROperand ensureCmpDst(
+        IROperand operand,
+        std::vector<IRInstruction>& instructions,
+        IdTable& ids) {
+        if (operand.isImm()) {
+            IROperand tmp = ids.temp();
+            instructions.push_back(IRMov(operand, tmp));
+            return tmp;
+        }
+        return operand;
     }
-    static std::string freshLabelName() {
-        static int counter = 0;
-        return "L" + std::to_string(counter++);
+    static void emitBranch(const Exp& e, bool jumpIf, int target, std::vector<IRInstruction>& instructions,
+                           IdTable& ids);
+    static IROperand emitBoolean(const Exp& e, std::vector<IRInstruction>& instructions, IdTable& ids);
+    static bool isSelect(const Exp& condition, const Exp& thenExp, const Exp& elseExp);
+    static IROperand emitSelect(const Exp& condition, const Exp& thenExp, const Exp& elseExp,
+                                std::vector<IRInstruction>& instructions, IdTable& ids);
+
+    static std::optional<IRCondCode> comparison(BinaryOperator op) {
+        switch (op) {
+        case BinaryOperator::Equal: return IRCondCode::E;
+        case BinaryOperator::NotEqual: return IRCondCode::NE;
+        case BinaryOperator::LessThan: return IRCondCode::L;
+        case BinaryOperator::LessOrEqual: return IRCondCode::LE;
+        case BinaryOperator::GreaterThan: return IRCondCode::G;
+        case BinaryOperator::GreaterOrEqual: return IRCondCode::GE;
+        default: return std::nullopt;
+        }
     }
-    static std::unique_ptr<IROperand> ensureCmpDst(
-        std::unique_ptr<IROperand> operand,
-        std::vector<std::unique_ptr<IRInstruction>>& instructions,
-        std::unordered_set<std::string>& pseudos) {
-        if (dynamic_cast<IRImm*>(operand.get()) != nullptr) {
-            std::string tmpName = freshTempName();
-            pseudos.insert(tmpName);
-            auto dstVar = std::make_unique<IRPseudo>(tmpName);
-            auto dstVarRef = std::make_unique<IRPseudo>(tmpName);
-            instructions.push_back(std::make_unique<IRMov>(std::move(operand), std::move(dstVar)));
-            return dstVarRef;
+
+    // Whether e always evaluates to 0 or 1.
+    static bool isBoolean(const Exp& e) {
+        if (auto u = dynamic_cast<const Unary*>(&e)) {
+            return u->op == UnaryOperator::LogicalNot;
         }
-        return operand;
+        if (auto b = dynamic_cast<const Binary*>(&e)) {
+            return comparison(b->op) || b->op == BinaryOperator::And || b->op == BinaryOperator::Or;
+        }
+        return false;
     }
+
+    static bool isZero(const Exp& e) {
+        auto c = dynamic_cast<const Constant*>(&e);
+        return c && c->value == 0;
+    }
+
+    // Looks through `!`, and through `== 0` and `!= 0` applied to a boolean,
+    // flipping `negated` each time the sense of the test flips.
+    static const Exp& skipNots(const Exp& e, bool& negated) {
+        if (auto u = dynamic_cast<const Unary*>(&e); u && u->op == UnaryOperator::LogicalNot) {
+            negated = !negated;
+            return skipNots(*u->expr, negated);
+        }
+        auto b = dynamic_cast<const Binary*>(&e);
+        if (b && (b->op == BinaryOperator::Equal || b->op == BinaryOperator::NotEqual)) {
+            const Exp* operand = isZero(*b->right) ? b->left.get() : isZero(*b->left) ? b->right.get() : nullptr;
+            if (operand && isBoolean(*operand)) {
+                if (b->op == BinaryOperator::Equal) negated = !negated;
+                return skipNots(*operand, negated);
+            }
+        }
+        return e;
+    }
+
     // Lower an Exp to an assembly operand, appending instructions as needed.
-    static std::unique_ptr<IROperand> emitTacky(
+    static IROperand emitTacky(
         const Exp& e,
-        std::vector<std::unique_ptr<IRInstruction>>& instructions,
-        std::unordered_set<std::string>& pseudos) {
+        std::vector<IRInstruction>& instructions,
+        IdTable& ids) {
         if (auto c = dynamic_cast<const Constant*>(&e)) {
-            return std::make_unique<IRImm>(c->value);
+            return IROperand::imm(c->value);
         }
         if (auto v = dynamic_cast<const Var*>(&e)) {
-            pseudos.insert(v->name);
-            return std::make_unique<IRPseudo>(v->name);
+            return ids.variable(v->name);
         }
         if (auto a = dynamic_cast<const Assignment*>(&e)) {
             auto lhsVar = dynamic_cast<const Var*>(a->lhs.get());
             if (lhsVar == nullptr) {
                 throw std::runtime_error("Lowering error: assignment to non-variable");
             }
-            auto rhsVal = emitTacky(*a->rhs, instructions, pseudos);
-            pseudos.insert(lhsVar->name);
-            instructions.push_back(std::make_unique<IRMov>(
-                std::move(rhsVal),
-                std::make_unique<IRPseudo>(lhsVar->name)));
-            return std::make_unique<IRPseudo>(lhsVar->name);
+            IROperand rhsVal = emitTacky(*a->rhs, instructions, ids);
+            IROperand lhs = ids.variable(lhsVar->name);
+            instructions.push_back(IRMov(rhsVal, lhs));
+            return lhs;
         }
         if (auto u = dynamic_cast<const Unary*>(&e)) {
-            auto srcVal = emitTacky(*u->expr, instructions, pseudos);
             if (u->op == UnaryOperator::LogicalNot) {
-                if (auto imm = dynamic_cast<IRImm*>(srcVal.get())) {
-                    return std::make_unique<IRImm>(imm->value == 0 ? 1 : 0);
-                }
-                std::string tmpName = freshTempName();
-                pseudos.insert(tmpName);
-                auto dstVar = std::make_unique<IRPseudo>(tmpName);
-                auto cmpDst = ensureCmpDst(std::move(srcVal), instructions, pseudos);
-                instructions.push_back(std::make_unique<IRCmp>(std::make_unique<IRImm>(0), std::move(cmpDst)));
-                instructions.push_back(std::make_unique<IRMov>(std::make_unique<IRImm>(0), std::make_unique<IRPseudo>(tmpName)));
-                instructions.push_back(std::make_unique<IRSetCC>(IRCondCode::E, std::move(dstVar)));
-                return std::make_unique<IRPseudo>(tmpName);
+                return emitBoolean(e, instructions, ids);
             }
-            std::string tmpName = freshTempName();
-            pseudos.insert(tmpName);
-            auto dstVar = std::make_unique<IRPseudo>(tmpName);
-            auto dstVarRef = std::make_unique<IRPseudo>(tmpName);
-            instructions.push_back(std::make_unique<IRMov>(std::move(srcVal), std::move(dstVar)));
+            IROperand srcVal = emitTacky(*u->expr, instructions, ids);
+            IROperand dst = ids.temp();
+            instructions.push_back(IRMov(srcVal, dst));
             IRUnaryOperator op;
             switch (u->op) {
             case UnaryOperator::Complement: op = IRUnaryOperator::Not; break;
             case UnaryOperator::Negate: op = IRUnaryOperator::Neg; break;
             default: throw std::runtime_error("Unsupported unary operator");
             }
-            instructions.push_back(std::make_unique<IRUnary>(op, std::move(dstVarRef)));
-            return std::make_unique<IRPseudo>(tmpName);
+            instructions.push_back(IRUnary(op, dst));
+            return dst;
         }
         if (auto b = dynamic_cast<const Binary*>(&e)) {
-            if (b->op == BinaryOperator::And || b->op == BinaryOperator::Or) {
-                std::string tmpName = freshTempName();
-                pseudos.insert(tmpName);
-                auto resultVar = std::make_unique<IRPseudo>(tmpName);
-                auto resultVarRef = std::make_unique<IRPseudo>(tmpName);
-
-                std::string shortLabel = freshLabelName();
-                std::string endLabel = freshLabelName();
-
-                auto leftVal = emitTacky(*b->left, instructions, pseudos);
-                auto leftCmpDst = ensureCmpDst(std::move(leftVal), instructions, pseudos);
-                instructions.push_back(std::make_unique<IRCmp>(std::make_unique<IRImm>(0), std::move(leftCmpDst)));
-                if (b->op == BinaryOperator::And) {
-                    instructions.push_back(std::make_unique<IRJumpCC>(IRCondCode::E, shortLabel));
-                } else {
-                    instructions.push_back(std::make_unique<IRJumpCC>(IRCondCode::NE, shortLabel));
-                }
-
-                auto rightVal = emitTacky(*b->right, instructions, pseudos);
-                auto rightCmpDst = ensureCmpDst(std::move(rightVal), instructions, pseudos);
-                instructions.push_back(std::make_unique<IRCmp>(std::make_unique<IRImm>(0), std::move(rightCmpDst)));
-                if (b->op == BinaryOperator::And) {
-                    instructions.push_back(std::make_unique<IRJumpCC>(IRCondCode::E, shortLabel));
-                    instructions.push_back(std::make_unique<IRMov>(std::make_unique<IRImm>(1), std::move(resultVar)));
-                } else {
-                    instructions.push_back(std::make_unique<IRJumpCC>(IRCondCode::NE, shortLabel));
-                    instructions.push_back(std::make_unique<IRMov>(std::make_unique<IRImm>(0), std::move(resultVar)));
-                }
-
-                instructions.push_back(std::make_unique<IRJump>(endLabel));
-                instructions.push_back(std::make_unique<IRLabel>(shortLabel));
-                if (b->op == BinaryOperator::And) {
-                    instructions.push_back(std::make_unique<IRMov>(std::make_unique<IRImm>(0), std::move(resultVarRef)));
-                } else {
-                    instructions.push_back(std::make_unique<IRMov>(std::make_unique<IRImm>(1), std::move(resultVarRef)));
-                }
-                instructions.push_back(std::make_unique<IRLabel>(endLabel));
-
-                return std::make_unique<IRPseudo>(tmpName);
+            if (isBoolean(e)) {
+                return emitBoolean(e, instructions, ids);
             }
 
-            auto leftVal = emitTacky(*b->left, instructions, pseudos);
-            auto rightVal = emitTacky(*b->right, instructions, pseudos);
-            std::string tmpName = freshTempName();
-            pseudos.insert(tmpName);
+            IROperand leftVal = emitTacky(*b->left, instructions, ids);
+            IROperand rightVal = emitTacky(*b->right, instructions, ids);
+            IROperand result = ids.temp();
             if (b->op == BinaryOperator::Add || b->op == BinaryOperator::Sub || b->op == BinaryOperator::Mul) {
-                auto dstVar = std::make_unique<IRPseudo>(tmpName);
-                auto dstVarRef = std::make_unique<IRPseudo>(tmpName);
-                instructions.push_back(std::make_unique<IRMov>(std::move(leftVal), std::move(dstVar)));
+                instructions.push_back(IRMov(leftVal, result));
                 IRBinaryOperator op;
                 switch (b->op) {
                 case BinaryOperator::Add: op = IRBinaryOperator::Add; break;
@@ -141,118 +165,280 @@ namespace {
                 case BinaryOperator::Mul: op = IRBinaryOperator::Mul; break;
                 default: throw std::runtime_error("Unsupported binary operator");
                 }
-                instructions.push_back(std::make_unique<IRBinary>(op, std::move(rightVal), std::move(dstVarRef)));
-                return std::make_unique<IRPseudo>(tmpName);
+                instructions.push_back(IRBinary(op, rightVal, result));
+                return result;
             }
             if (b->op == BinaryOperator::Div || b->op == BinaryOperator::Mod) {
-                auto resultVar = std::make_unique<IRPseudo>(tmpName);
-                instructions.push_back(std::make_unique<IRMov>(std::move(leftVal), std::make_unique<IRReg>(IRRegister::AX)));
-                instructions.push_back(std::make_unique<IRCdq>());
-                instructions.push_back(std::make_unique<IRIdiv>(std::move(rightVal)));
+                instructions.push_back(IRMov(leftVal, IROperand::reg(IRRegister::AX)));
+                instructions.push_back(IRCdq());
+                instructions.push_back(IRIdiv(rightVal));
                 if (b->op == BinaryOperator::Div) {
-                    instructions.push_back(std::make_unique<IRMov>(std::make_unique<IRReg>(IRRegister::AX), std::move(resultVar)));
+                    instructions.push_back(IRMov(IROperand::reg(IRRegister::AX), result));
                 } else {
-                    instructions.push_back(std::make_unique<IRMov>(std::make_unique<IRReg>(IRRegister::DX), std::move(resultVar)));
+                    instructions.push_back(IRMov(IROperand::reg(IRRegister::DX), result));
                 }
-                return std::make_unique<IRPseudo>(tmpName);
-            }
-            if (b->op == BinaryOperator::Equal || b->op == BinaryOperator::NotEqual ||
-                b->op == BinaryOperator::LessThan || b->op == BinaryOperator::LessOrEqual ||
-                b->op == BinaryOperator::GreaterThan || b->op == BinaryOperator::GreaterOrEqual) {
-                IRCondCode cond;
-                switch (b->op) {
-                case BinaryOperator::Equal: cond = IRCondCode::E; break;
-                case BinaryOperator::NotEqual: cond = IRCondCode::NE; break;
-                case BinaryOperator::LessThan: cond = IRCondCode::L; break;
-                case BinaryOperator::LessOrEqual: cond = IRCondCode::LE; break;
-                case BinaryOperator::GreaterThan: cond = IRCondCode::G; break;
-                case BinaryOperator::GreaterOrEqual: cond = IRCondCode::GE; break;
-                default: throw std::runtime_error("Unsupported binary operator");
-                }
-                auto resultVar = std::make_unique<IRPseudo>(tmpName);
-                auto cmpDst = ensureCmpDst(std::move(leftVal), instructions, pseudos);
-                instructions.push_back(std::make_unique<IRCmp>(std::move(rightVal), std::move(cmpDst)));
-                instructions.push_back(std::make_unique<IRMov>(std::make_unique<IRImm>(0), std::make_unique<IRPseudo>(tmpName)));
-                instructions.push_back(std::make_unique<IRSetCC>(cond, std::move(resultVar)));
-                return std::make_unique<IRPseudo>(tmpName);
+                return result;
             }
             throw std::runtime_error("Unsupported binary operator");
         }
         if (auto c = dynamic_cast<const Conditional*>(&e)) {
-            std::string tmpName = freshTempName();
-            pseudos.insert(tmpName);
+            if (isSelect(*c->condition, *c->thenExpr, *c->elseExpr)) {
+                return emitSelect(*c->condition, *c->thenExpr, *c->elseExpr, instructions, ids);
+            }
+            IROperand result = ids.temp();
 
-            std::string elseLabel = freshLabelName();
-            std::string endLabel = freshLabelName();
+            int elseLabel = ids.label();
+            int endLabel = ids.label();
 
-            auto condVal = emitTacky(*c->condition, instructions, pseudos);
-            auto cmpDst = ensureCmpDst(std::move(condVal), instructions, pseudos);
-            instructions.push_back(std::make_unique<IRCmp>(std::make_unique<IRImm>(0), std::move(cmpDst)));
-            instructions.push_back(std::make_unique<IRJumpCC>(IRCondCode::E, elseLabel));
+            emitBranch(*c->condition, false, elseLabel, instructions, ids);
 
-            auto thenVal = emitTacky(*c->thenExpr, instructions, pseudos);
-            instructions.push_back(std::make_unique<IRMov>(
-                std::move(thenVal),
-                std::make_unique<IRPseudo>(tmpName)));
-            instructions.push_back(std::make_unique<IRJump>(endLabel));
+            IROperand thenVal = emitTacky(*c->thenExpr, instructions, ids);
+            instructions.push_back(IRMov(thenVal, result));
+            instructions.push_back(IRJump(endLabel));
 
-            instructions.push_back(std::make_unique<IRLabel>(elseLabel));
-            auto elseVal = emitTacky(*c->elseExpr, instructions, pseudos);
-            instructions.push_back(std::make_unique<IRMov>(
-                std::move(elseVal),
-                std::make_unique<IRPseudo>(tmpName)));
-            instructions.push_back(std::make_unique<IRLabel>(endLabel));
+            instructions.push_back(IRLabel(elseLabel));
+            IROperand elseVal = emitTacky(*c->elseExpr, instructions, ids);
+            instructions.push_back(IRMov(elseVal, result));
+            instructions.push_back(IRLabel(endLabel));
 
-            return std::make_unique<IRPseudo>(tmpName);
+            return result;
         }
-        return std::make_unique<IRImm>(0);
+        return IROperand::imm(0);
     }
 
-    struct LoopLabels {
-        std::string breakLabel;
-        std::string continueLabel;
-    };
+    // Lowers a condition as jumping code: jumps to target when the truth of
+    // `e` equals jumpIf and falls through otherwise. Comparisons branch on
+    // the flags of their cmp, and !, && and || only route the jumps, so no
+    // 0/1 value is built just to be tested against zero.
+    static void emitBranch(
+        const Exp& e,
+        bool jumpIf,
+        int target,
+        std::vector<IRInstruction>& instructions,
+        IdTable& ids) {
+        if (auto c = dynamic_cast<const Constant*>(&e)) {
+            if ((c->value != 0) == jumpIf) {
+                instructions.push_back(IRJump(target));
+            }
+            return;
+        }
+        bool negated = false;
+        if (const Exp& test = skipNots(e, negated); &test != &e) {
+            emitBranch(test, jumpIf != negated, target, instructions, ids);
+            return;
+        }
+        if (auto b = dynamic_cast<const Binary*>(&e)) {
+            if (b->op == BinaryOperator::And || b->op == BinaryOperator::Or) {
+                // The operand that decides alone (false for &&, true for ||)
+                // jumps straight to target if that is the outcome wanted, and
+                // past the other operand's test otherwise.
+                bool decides = b->op == BinaryOperator::Or;
+                if (decides == jumpIf) {
+                    emitBranch(*b->left, jumpIf, target, instructions, ids);
+                    emitBranch(*b->right, jumpIf, target, instructions, ids);
+                } else {
+                    int skipLabel = ids.label();
+                    emitBranch(*b->left, decides, skipLabel, instructions, ids);
+                    emitBranch(*b->right, jumpIf, target, instructions, ids);
+                    instructions.push_back(IRLabel(skipLabel));
+                }
+                return;
+            }
+            if (auto cond = comparison(b->op)) {
+                IROperand leftVal = emitTacky(*b->left, instructions, ids);
+                IROperand rightVal = emitTacky(*b->right, instructions, ids);
+                IROperand cmpDst = ensureCmpDst(leftVal, instructions, ids);
+                instructions.push_back(IRCmp(rightVal, cmpDst));
+                instructions.push_back(IRJumpCC(jumpIf ? *cond : negateCondition(*cond), target));
+                return;
+            }
+        }
+        IROperand condVal = emitTacky(e, instructions, ids);
+        IROperand cmpDst = ensureCmpDst(condVal, instructions, ids);
+        instructions.push_back(IRCmp(IROperand::imm(0), cmpDst));
+        instructions.push_back(IRJumpCC(jumpIf ? IRCondCode::NE : IRCondCode::E, target));
+    }
+
+    // Materializes a condition as 0 or 1. Comparisons become
+    // `mov $0, t; cmp; setCC t`, with t cleared before the compare so that
+    // the code generator can clear it with xor; ! and == 0 only change the
+    // condition code. && and || join their short-circuit jumps on a mov of
+    // each outcome.
+    static IROperand emitBoolean(
+        const Exp& e,
+        std::vector<IRInstruction>& instructions,
+        IdTable& ids) {
+        bool negated = false;
+        const Exp& test = skipNots(e, negated);
+        auto b = dynamic_cast<const Binary*>(&test);
+        if (b && (b->op == BinaryOperator::And || b->op == BinaryOperator::Or)) {
+            IROperand result = ids.temp();
+            int shortLabel = ids.label();
+            int endLabel = ids.label();
+            // Either operand short-circuits to the same value: false for &&,
+            // true for ||.
+            bool shortValue = b->op == BinaryOperator::Or;
+            emitBranch(*b->left, shortValue, shortLabel, instructions, ids);
+            emitBranch(*b->right, shortValue, shortLabel, instructions, ids);
+            instructions.push_back(IRMov(IROperand::imm(shortValue != negated ? 0 : 1), result));
+            instructions.push_back(IRJump(endLabel));
+            instructions.push_back(IRLabel(shortLabel));
+            instructions.push_back(IRMov(IROperand::imm(shortValue != negated ? 1 : 0), result));
+            instructions.push_back(IRLabel(endLabel));
+            return result;
+        }
 
-    static std::string breakLabelFor(const std::string& loopId) {
-        return "break_" + loopId;
+        IRCondCode cond = IRCondCode::NE;
+        IROperand lhs;
+        IROperand rhs = IROperand::imm(0);
+        if (auto compare = b ? comparison(b->op) : std::nullopt) {
+            cond = *compare;
+            lhs = emitTacky(*b->left, instructions, ids);
+            rhs = emitTacky(*b->right, instructions, ids);
+        } else {
+            lhs = emitTacky(test, instructions, ids);
+        }
+        if (negated) {
+            cond = negateCondition(cond);
+        }
+        if (lhs.isImm() && rhs.isImm()) {
+            return IROperand::imm(evaluateCondition(cond, lhs.asImm(), rhs.asImm()) ? 1 : 0);
+        }
+        IROperand result = ids.temp();
+        IROperand cmpDst = ensureCmpDst(lhs, instructions, ids);
+        instructions.push_back(IRMov(IROperand::imm(0), result));
+        instructions.push_back(IRCmp(rhs, cmpDst));
+        instructions.push_back(IRSetCC(cond, result));
+        return result;
     }
 
-    static std::string continueLabelFor(const std::string& loopId) {
-        return "continue_" + loopId;
+    // Arms costing at most this many instructions are both computed and the
+    // result picked by cmov, instead of branching around them.
+    constexpr int kMaxSelectArmCost = 2;
+
+    // Whether evaluating e has no side effect, cannot trap and takes at most
+    // `budget` instructions besides reading its operands.
+    static bool isCheapValue(const Exp& e, int& budget) {
+        if (dynamic_cast<const Constant*>(&e) || dynamic_cast<const Var*>(&e)) {
+            return true;
+        }
+        if (auto u = dynamic_cast<const Unary*>(&e)) {
+            return u->op != UnaryOperator::LogicalNot && --budget >= 0 && isCheapValue(*u->expr, budget);
+        }
+        if (auto b = dynamic_cast<const Binary*>(&e)) {
+            bool arithmetic = b->op == BinaryOperator::Add || b->op == BinaryOperator::Sub
+                || b->op == BinaryOperator::Mul;
+            return arithmetic && --budget >= 0 && isCheapValue(*b->left, budget) && isCheapValue(*b->right, budget);
+        }
+        return false;
+    }
+
+    // Whether `condition ? thenExp : elseExp` is worth a select: both arms
+    // are cheap and the flags of a single cmp decide between them.
+    static bool isSelect(const Exp& condition, const Exp& thenExp, const Exp& elseExp) {
+        bool negated = false;
+        const Exp& test = skipNots(condition, negated);
+        if (dynamic_cast<const Constant*>(&test) || dynamic_cast<const Conditional*>(&test)) {
+            return false;
+        }
+        if (auto b = dynamic_cast<const Binary*>(&test);
+            b && (b->op == BinaryOperator::And || b->op == BinaryOperator::Or)) {
+            return false;
+        }
+        int thenBudget = kMaxSelectArmCost;
+        int elseBudget = kMaxSelectArmCost;
+        return isCheapValue(thenExp, thenBudget) && isCheapValue(elseExp, elseBudget);
+    }
+
+    // Lowers `condition ? thenExp : elseExp` without a branch, as
+    // `cmp; mov else, result; cmovCC then, result`.
+    static IROperand emitSelect(
+        const Exp& condition,
+        const Exp& thenExp,
+        const Exp& elseExp,
+        std::vector<IRInstruction>& instructions,
+        IdTable& ids) {
+        bool negated = false;
+        const Exp& test = skipNots(condition, negated);
+        IRCondCode cond = IRCondCode::NE;
+        IROperand lhs;
+        IROperand rhs = IROperand::imm(0);
+        auto b = dynamic_cast<const Binary*>(&test);
+        if (auto compare = b ? comparison(b->op) : std::nullopt) {
+            cond = *compare;
+            lhs = emitTacky(*b->left, instructions, ids);
+            rhs = emitTacky(*b->right, instructions, ids);
+        } else {
+            lhs = emitTacky(test, instructions, ids);
+        }
+        IROperand thenVal = emitTacky(thenExp, instructions, ids);
+        IROperand elseVal = emitTacky(elseExp, instructions, ids);
+        IROperand result = ids.temp();
+        IROperand cmpDst = ensureCmpDst(lhs, instructions, ids);
+        instructions.push_back(IRCmp(rhs, cmpDst));
+        instructions.push_back(IRMov(elseVal, result));
+        instructions.push_back(IRCMov(negated ? negateCondition(cond) : cond, thenVal, result));
+        return result;
+    }
+
+    // The `x = value` of a statement that is only that assignment, possibly
+    // braced, or nullptr.
+    static const Assignment* singleAssignment(const Statement& stmt) {
+        if (auto compound = dynamic_cast<const CompoundStatement*>(&stmt)) {
+            if (compound->block->items.size() != 1) {
+                return nullptr;
+            }
+            auto inner = dynamic_cast<const Statement*>(compound->block->items[0].get());
+            return inner ? singleAssignment(*inner) : nullptr;
+        }
+        auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt);
+        auto a = exprStmt ? dynamic_cast<const Assignment*>(exprStmt->expr.get()) : nullptr;
+        return a && dynamic_cast<const Var*>(a->lhs.get()) ? a : nullptr;
     }
 
     static void emitStatement(
         const Statement& stmt,
-        std::vector<std::unique_ptr<IRInstruction>>& instructions,
-        std::unordered_set<std::string>& pseudos,
+        std::vector<IRInstruction>& instructions,
+        IdTable& ids,
         std::vector<LoopLabels>& loopStack) {
         if (auto ret = dynamic_cast<const Return*>(&stmt)) {
-            auto retVal = emitTacky(*ret->expr, instructions, pseudos);
-            instructions.push_back(std::make_unique<IRMov>(std::move(retVal), std::make_unique<IRReg>(IRRegister::AX)));
-            instructions.push_back(std::make_unique<IRRet>());
+            IROperand retVal = emitTacky(*ret->expr, instructions, ids);
+            instructions.push_back(IRMov(retVal, IROperand::reg(IRRegister::AX)));
+            instructions.push_back(IRRet());
             return;
         }
         if (auto exprStmt = dynamic_cast<const ExpressionStatement*>(&stmt)) {
-            (void)emitTacky(*exprStmt->expr, instructions, pseudos);
+            (void)emitTacky(*exprStmt->expr, instructions, ids);
             return;
         }
         if (auto ifStmt = dynamic_cast<const IfStatement*>(&stmt)) {
-            std::string elseLabel = freshLabelName();
-            std::string endLabel = freshLabelName();
+            // `if (c) x = a; else x = b;`, which is how min, max and abs are
+            // written, becomes `x = c ? a : b`; without else, b is x itself.
+            if (auto thenAssign = singleAssignment(*ifStmt->thenStmt)) {
+                const std::string& name = static_cast<const Var&>(*thenAssign->lhs).name;
+                auto elseAssign = ifStmt->elseStmt ? singleAssignment(*ifStmt->elseStmt) : nullptr;
+                bool sameVariable = !ifStmt->elseStmt
+                    || (elseAssign && static_cast<const Var&>(*elseAssign->lhs).name == name);
+                const Exp& elseValue = elseAssign ? *elseAssign->rhs : *thenAssign->lhs;
+                if (sameVariable && isSelect(*ifStmt->condition, *thenAssign->rhs, elseValue)) {
+                    IROperand value = emitSelect(*ifStmt->condition, *thenAssign->rhs, elseValue, instructions, ids);
+                    instructions.push_back(IRMov(value, ids.variable(name)));
+                    return;
+                }
+            }
+            int elseLabel = ids.label();
+            int endLabel = ids.label();
 
-            auto condVal = emitTacky(*ifStmt->condition, instructions, pseudos);
-            auto cmpDst = ensureCmpDst(std::move(condVal), instructions, pseudos);
-            instructions.push_back(std::make_unique<IRCmp>(std::make_unique<IRImm>(0), std::move(cmpDst)));
-            instructions.push_back(std::make_unique<IRJumpCC>(IRCondCode::E, elseLabel));
+            emitBranch(*ifStmt->condition, false, elseLabel, instructions, ids);
 
-            emitStatement(*ifStmt->thenStmt, instructions, pseudos, loopStack);
+            emitStatement(*ifStmt->thenStmt, instructions, ids, loopStack);
             if (ifStmt->elseStmt) {
-                instructions.push_back(std::make_unique<IRJump>(endLabel));
-                instructions.push_back(std::make_unique<IRLabel>(elseLabel));
-                emitStatement(*ifStmt->elseStmt, instructions, pseudos, loopStack);
-                instructions.push_back(std::make_unique<IRLabel>(endLabel));
+                instructions.push_back(IRJump(endLabel));
+                instructions.push_back(IRLabel(elseLabel));
+                emitStatement(*ifStmt->elseStmt, instructions, ids, loopStack);
+                instructions.push_back(IRLabel(endLabel));
             } else {
-                instructions.push_back(std::make_unique<IRLabel>(elseLabel));
+                instructions.push_back(IRLabel(elseLabel));
             }
             return;
         }
@@ -260,98 +446,97 @@ namespace {
             if (br->label.empty()) {
                 throw std::runtime_error("Lowering error: break missing loop label");
             }
-            instructions.push_back(std::make_unique<IRJump>(breakLabelFor(br->label)));
+            instructions.push_back(IRJump(ids.loop(br->label).breakLabel));
             return;
         }
         if (auto* cont = dynamic_cast<const ContinueStatement*>(&stmt)) {
             if (cont->label.empty()) {
                 throw std::runtime_error("Lowering error: continue missing loop label");
             }
-            instructions.push_back(std::make_unique<IRJump>(continueLabelFor(cont->label)));
+            instructions.push_back(IRJump(ids.loop(cont->label).continueLabel));
             return;
         }
         if (auto* whileStmt = dynamic_cast<const WhileStatement*>(&stmt)) {
             if (whileStmt->label.empty()) {
                 throw std::runtime_error("Lowering error: while missing loop label");
             }
-            std::string condLabel = continueLabelFor(whileStmt->label);
-            std::string breakLabel = breakLabelFor(whileStmt->label);
+            // Rotated: a guard skips the loop, then the body runs with the
+            // condition tested at the bottom, so each iteration takes one branch.
+            int bodyLabel = ids.label();
+            int condLabel = ids.loop(whileStmt->label).continueLabel;
+            int breakLabel = ids.loop(whileStmt->label).breakLabel;
 
-            instructions.push_back(std::make_unique<IRLabel>(condLabel));
-            auto condVal = emitTacky(*whileStmt->condition, instructions, pseudos);
-            auto cmpDst = ensureCmpDst(std::move(condVal), instructions, pseudos);
-            instructions.push_back(std::make_unique<IRCmp>(std::make_unique<IRImm>(0), std::move(cmpDst)));
-            instructions.push_back(std::make_unique<IRJumpCC>(IRCondCode::E, breakLabel));
+            emitBranch(*whileStmt->condition, false, breakLabel, instructions, ids);
+            instructions.push_back(IRLabel(bodyLabel, whileStmt->unroll, whileStmt->line));
 
             loopStack.push_back({breakLabel, condLabel});
-            emitStatement(*whileStmt->body, instructions, pseudos, loopStack);
+            emitStatement(*whileStmt->body, instructions, ids, loopStack);
             loopStack.pop_back();
 
-            instructions.push_back(std::make_unique<IRJump>(condLabel));
-            instructions.push_back(std::make_unique<IRLabel>(breakLabel));
+            instructions.push_back(IRLabel(condLabel));
+            emitBranch(*whileStmt->condition, true, bodyLabel, instructions, ids);
+            instructions.push_back(IRLabel(breakLabel));
             return;
         }
         if (auto* doWhile = dynamic_cast<const DoWhileStatement*>(&stmt)) {
             if (doWhile->label.empty()) {
                 throw std::runtime_error("Lowering error: do-while missing loop label");
             }
-            std::string bodyLabel = freshLabelName();
-            std::string continueLabel = continueLabelFor(doWhile->label);
-            std::string breakLabel = breakLabelFor(doWhile->label);
+            int bodyLabel = ids.label();
+            int continueLabel = ids.loop(doWhile->label).continueLabel;
+            int breakLabel = ids.loop(doWhile->label).breakLabel;
 
-            instructions.push_back(std::make_unique<IRLabel>(bodyLabel));
+            instructions.push_back(IRLabel(bodyLabel, doWhile->unroll, doWhile->line));
             loopStack.push_back({breakLabel, continueLabel});
-            emitStatement(*doWhile->body, instructions, pseudos, loopStack);
+            emitStatement(*doWhile->body, instructions, ids, loopStack);
             loopStack.pop_back();
 
-            instructions.push_back(std::make_unique<IRLabel>(continueLabel));
-            auto condVal = emitTacky(*doWhile->condition, instructions, pseudos);
-            auto cmpDst = ensureCmpDst(std::move(condVal), instructions, pseudos);
-            instructions.push_back(std::make_unique<IRCmp>(std::make_unique<IRImm>(0), std::move(cmpDst)));
-            instructions.push_back(std::make_unique<IRJumpCC>(IRCondCode::NE, bodyLabel));
-            instructions.push_back(std::make_unique<IRLabel>(breakLabel));
+            instructions.push_back(IRLabel(continueLabel));
+            emitBranch(*doWhile->condition, true, bodyLabel, instructions, ids);
+            instructions.push_back(IRLabel(breakLabel));
             return;
         }
         if (auto* forStmt = dynamic_cast<const ForStatement*>(&stmt)) {
             if (forStmt->label.empty()) {
                 throw std::runtime_error("Lowering error: for missing loop label");
             }
-            std::string condLabel = "cond_" + forStmt->label;
-            std::string continueLabel = continueLabelFor(forStmt->label);
-            std::string breakLabel = breakLabelFor(forStmt->label);
+            int condLabel = ids.label();
+            int continueLabel = ids.loop(forStmt->label).continueLabel;
+            int breakLabel = ids.loop(forStmt->label).breakLabel;
 
             if (auto* initDecl = dynamic_cast<const InitDecl*>(forStmt->init.get())) {
                 if (initDecl->decl->init) {
-                    auto initVal = emitTacky(*initDecl->decl->init, instructions, pseudos);
-                    pseudos.insert(initDecl->decl->name);
-                    instructions.push_back(std::make_unique<IRMov>(
-                        std::move(initVal),
-                        std::make_unique<IRPseudo>(initDecl->decl->name)));
+                    IROperand initVal = emitTacky(*initDecl->decl->init, instructions, ids);
+                    instructions.push_back(IRMov(initVal, ids.variable(initDecl->decl->name)));
                 }
             } else if (auto* initExpr = dynamic_cast<const InitExp*>(forStmt->init.get())) {
                 if (initExpr->expr) {
-                    (void)emitTacky(*initExpr->expr, instructions, pseudos);
+                    (void)emitTacky(*initExpr->expr, instructions, ids);
                 }
             }
 
-            instructions.push_back(std::make_unique<IRLabel>(condLabel));
+            // Rotated like while: guard, body, post, bottom test.
+            int bodyLabel = ids.label();
             if (forStmt->condition) {
-                auto condVal = emitTacky(*forStmt->condition, instructions, pseudos);
-                auto cmpDst = ensureCmpDst(std::move(condVal), instructions, pseudos);
-                instructions.push_back(std::make_unique<IRCmp>(std::make_unique<IRImm>(0), std::move(cmpDst)));
-                instructions.push_back(std::make_unique<IRJumpCC>(IRCondCode::E, breakLabel));
+                emitBranch(*forStmt->condition, false, breakLabel, instructions, ids);
             }
+            instructions.push_back(IRLabel(bodyLabel, forStmt->unroll, forStmt->line));
 
             loopStack.push_back({breakLabel, continueLabel});
-            emitStatement(*forStmt->body, instructions, pseudos, loopStack);
+            emitStatement(*forStmt->body, instructions, ids, loopStack);
             loopStack.pop_back();
 
-            instructions.push_back(std::make_unique<IRLabel>(continueLabel));
+            instructions.push_back(IRLabel(continueLabel));
             if (forStmt->post) {
-                (void)emitTacky(*forStmt->post, instructions, pseudos);
+                (void)emitTacky(*forStmt->post, instructions, ids);
             }
-            instructions.push_back(std::make_unique<IRJump>(condLabel));
-            instructions.push_back(std::make_unique<IRLabel>(breakLabel));
+            instructions.push_back(IRLabel(condLabel));
+            if (forStmt->condition) {
+                emitBranch(*forStmt->condition, true, bodyLabel, instructions, ids);
+            } else {
+                instructions.push_back(IRJump(bodyLabel));
+            }
+            instructions.push_back(IRLabel(breakLabel));
             return;
         }
         if (dynamic_cast<const EmptyStatement*>(&stmt)) {
@@ -361,11 +546,8 @@ namespace {
             for (const auto& item : compound->block->items) {
                 if (auto decl = dynamic_cast<const Declaration*>(item.get())) {
                     if (decl->init) {
-                        auto initVal = emitTacky(*decl->init, instructions, pseudos);
-                        pseudos.insert(decl->name);
-                        instructions.push_back(std::make_unique<IRMov>(
-                            std::move(initVal),
-                            std::make_unique<IRPseudo>(decl->name)));
+                        IROperand initVal = emitTacky(*decl->init, instructions, ids);
+                        instructions.push_back(IRMov(initVal, ids.variable(decl->name)));
                     }
                     continue;
                 }
@@ -373,7 +555,7 @@ namespace {
                     continue;
                 }
                 if (auto innerStmt = dynamic_cast<const Statement*>(item.get())) {
-                    emitStatement(*innerStmt, instructions, pseudos, loopStack);
+                    emitStatement(*innerStmt, instructions, ids, loopStack);
                     continue;
                 }
                 throw std::runtime_error("Lowering error: unsupported block item");
@@ -385,8 +567,8 @@ namespace {
 }
 std::unique_ptr<IRProgram> Lowering::toIR(const Program& program) {
     const Function& func = *program.function;
-    std::vector<std::unique_ptr<IRInstruction>> body;
-    std::unordered_set<std::string> pseudos;
+    std::vector<IRInstruction> body;
+    IdTable ids;
     std::vector<LoopLabels> loopStack;
     bool sawReturn = false;
     for (const auto& item : func.body->items) {
@@ -395,11 +577,8 @@ std::unique_ptr<IRProgram> Lowering::toIR(const Program& program) {
         }
         if (auto decl = dynamic_cast<const Declaration*>(item.get())) {
             if (decl->init) {
-                auto initVal = emitTacky(*decl->init, body, pseudos);
-                pseudos.insert(decl->name);
-                body.push_back(std::make_unique<IRMov>(
-                    std::move(initVal),
-                    std::make_unique<IRPseudo>(decl->name)));
+                IROperand initVal = emitTacky(*decl->init, body, ids);
+                body.push_back(IRMov(initVal, ids.variable(decl->name)));
             }
             continue;
         }
@@ -407,7 +586,7 @@ std::unique_ptr<IRProgram> Lowering::toIR(const Program& program) {
             continue;
         }
         if (auto stmt = dynamic_cast<const Statement*>(item.get())) {
-            emitStatement(*stmt, body, pseudos, loopStack);
+            emitStatement(*stmt, body, ids, loopStack);
             if (dynamic_cast<const Return*>(stmt) != nullptr) {
                 sawReturn = true;
             }
@@ -416,16 +595,9 @@ std::unique_ptr<IRProgram> Lowering::toIR(const Program& program) {
         throw std::runtime_error("Lowering error: unsupported block item");
     }
     if (!sawReturn) {
-        body.push_back(std::make_unique<IRMov>(std::make_unique<IRImm>(0), std::make_unique<IRReg>(IRRegister::AX)));
-        body.push_back(std::make_unique<IRRet>());
-    }
-    int stackSize = static_cast<int>(pseudos.size()) * 4;
-    if (stackSize % 16 != 0) {
-        stackSize += (16 - (stackSize % 16));
-    }
-    if (stackSize > 0) {
-        body.insert(body.begin(), std::make_unique<IRAllocateStack>(stackSize));
+        body.push_back(IRMov(IROperand::imm(0), IROperand::reg(IRRegister::AX)));
+        body.push_back(IRRet());
     }
-    auto irFunc = std::make_unique<IRFunction>(func.name, std::move(body));
+    auto irFunc = std::make_unique<IRFunction>(func.name, std::move(body), std::move(ids.names), ids.labelCount);
     return std::make_unique<IRProgram>(std::move(irFunc));
 }
@@ -3,13 +3,18 @@
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <optional>
 #include <cstdlib>
 #include "lexer.h"
 #include "parser.h"
 #include "codegen.h"
+#include "frame_layout.h"
 #include "ast_printer.h"
+#include "instruction_selection.h"
 #include "ir_printer.h"
 #include "lowering.h"
+#include "optimizer.h"
+#include "remarks.h"
 #include "resolver.h"
 
 /*
@@ -28,6 +33,14 @@ void printUsage() {
     std::cout << "  --codegen  Detenerse después de la generación de código\n";
     std::cout << "  --ir       Mostrar IR intermedio y detenerse\n";
     std::cout << "  --tacky    Ejecutar etapa IR y detenerse\n";
+    std::cout << "  -O0, -O1, -O2  Nivel de optimización del IR (por defecto -O2)\n";
+    std::cout << "  --passes=P Ejecutar la secuencia de pases P en lugar de la del nivel\n";
+    std::cout << "             (p. ej. repeat(sccp,dead-code),graph-coloring)\n";
+    std::cout << "  --unroll=N Factor de desenrollado de bucles (por defecto 4; 0 o 1 lo desactiva)\n";
+    std::cout << "  --budget=N Trabajo estimado máximo por pase, en pasos de ~10 ns (por defecto 5e7;\n";
+    std::cout << "             0 sin límite); por encima se usa un pase más barato o se omite\n";
+    std::cout << "  --stats    Mostrar en stderr los contadores de cada pase\n";
+    std::cout << "  --remarks=F Escribir en F (YAML) qué transformaciones se aplicaron o no y por qué\n";
 }
 
 std::string readFile(const std::string& path) {
@@ -82,6 +95,12 @@ int main(int argc, char* argv[]) {
     bool irOnly = false;
     bool tackyOnly = false;
     bool validateOnly = false;
+    int optLevel = 2;
+    std::optional<std::string> passes;
+    int unrollFactor = LoopUnrolling::kDefaultFactor;
+    double budget = PassManager::kDefaultBudget;
+    bool printStats = false;
+    std::optional<std::string> remarksFile;
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -91,6 +110,28 @@ int main(int argc, char* argv[]) {
         else if (arg == "--ir") irOnly = true;
         else if (arg == "--tacky") tackyOnly = true;
         else if (arg == "--validate") validateOnly = true;
+        else if (arg == "-O0") optLevel = 0;
+        else if (arg == "-O1") optLevel = 1;
+        else if (arg == "-O2") optLevel = 2;
+        else if (arg.starts_with("--passes=")) passes = arg.substr(9);
+        else if (arg == "--stats") printStats = true;
+        else if (arg.starts_with("--remarks=")) remarksFile = arg.substr(10);
+        else if (arg.starts_with("--unroll=")) {
+            try {
+                unrollFactor = std::stoi(arg.substr(9));
+            } catch (const std::exception&) {
+                std::cerr << "Error: Factor de desenrollado inválido " << arg << std::endl;
+                return 1;
+            }
+        }
+        else if (arg.starts_with("--budget=")) {
+            try {
+                budget = std::stod(arg.substr(9));
+            } catch (const std::exception&) {
+                std::cerr << "Error: Presupuesto de compilación inválido " << arg << std::endl;
+                return 1;
+            }
+        }
         else if (arg.starts_with("-")) {
             std::cerr << "Error: Opción desconocida " << arg << std::endl;
             return 1;
@@ -131,14 +172,30 @@ int main(int argc, char* argv[]) {
             return 0;
         }
 
+        auto ir = Lowering::toIR(*resolved);
+        OptimizationRemarks remarks(printStats || remarksFile);
+        Optimizer::optimize(*ir, passes ? *passes : Optimizer::pipeline(optLevel), unrollFactor, &remarks,
+                            budget);
+        if (printStats) {
+            remarks.printStatistics(std::cerr);
+        }
+        if (remarksFile) {
+            std::ofstream out(*remarksFile);
+            if (!out.is_open()) {
+                throw std::runtime_error("No se pudo escribir en el archivo: " + *remarksFile);
+            }
+            remarks.writeYaml(out);
+        }
+
         if (irOnly || tackyOnly) {
-            auto ir = Lowering::toIR(*resolved);
             std::cout << IRPrinter::print(*ir) << std::endl;
             return 0;
         }
 
         // 3. Fase de Generación de Código
-        std::string assembly = CodeGenerator::generate(*resolved);
+        FrameLayout::run(*ir->function);
+        InstructionSelection::run(*ir->function);
+        std::string assembly = CodeGenerator::generate(*ir);
         if (codegenOnly) {
             std::cout << assembly << std::endl;
             return 0;
@@ -0,0 +1,113 @@
+#include "optimizer.h"
+#include "copy_propagation.h"
+#include "dead_code.h"
+#include "graph_coloring.h"
+#include "induction_variables.h"
+#include "ir_utils.h"
+#include "licm.h"
+#include "linear_scan.h"
+#include "loop_unswitching.h"
+#include "scalar_evolution.h"
+#include "sccp.h"
+#include "unreachable.h"
+#include "value_numbering.h"
+
+namespace {
+    // Each pass exposes work for the others; iterate until none changes anything.
+    constexpr const char* kScalarPasses =
+        "repeat(unreachable,sccp,value-numbering,licm,scev,induction-variables,copy-propagation,dead-code)";
+
+    // Cost models, in steps of about ten nanoseconds.
+
+    // SCCP and value numbering keep a value per location for every block.
+    static double blocksTimesLocations(const IRFunction&, AnalysisManager& analyses) {
+        return static_cast<double>(analyses.cfg().blocks.size()) * analyses.locations().size();
+    }
+
+    // Dead-code elimination recomputes liveness, up to a bit per block and
+    // location, on each of its sweeps.
+    static double liveSets(const IRFunction&, AnalysisManager& analyses) {
+        return static_cast<double>(analyses.cfg().blocks.size()) * analyses.locations().size() / 16;
+    }
+
+    // Copy propagation carries a bit per block for every copy used outside
+    // its own block.
+    static double reachingCopies(const IRFunction&, AnalysisManager& analyses) {
+        return static_cast<double>(analyses.cfg().blocks.size()) * analyses.locations().size() / 64;
+    }
+
+    // The interference graph may hold an edge for every pair of pseudos, and
+    // building, coalescing and coloring visit each edge tens of times.
+    static double interferenceEdges(const IRFunction& fn, AnalysisManager&) {
+        double pseudos = static_cast<double>(fn.pseudos.size());
+        return 20 * pseudos * pseudos / 2;
+    }
+
+    // The loop passes rescan the function and rebuild the control-flow
+    // analyses and liveness after every loop they rewrite.
+    static double loopsTimesInstructions(const IRFunction& fn, AnalysisManager& analyses) {
+        return 20 * static_cast<double>(analyses.loops().loops.size()) * fn.body.size();
+    }
+}
+
+PassManager Optimizer::passManager(int unrollFactor) {
+    PassManager manager;
+    manager.add({"unreachable", [](IRFunction& fn, AnalysisManager& a) { return UnreachableCodeElimination::run(fn, a); }});
+    manager.add({"sccp", [](IRFunction& fn, AnalysisManager& a) { return SCCP::run(fn, a); },
+                 PreservedAnalyses::none(), blocksTimesLocations});
+    manager.add({"value-numbering", [](IRFunction& fn, AnalysisManager& a) { return ValueNumbering::run(fn, a); },
+                 PreservedAnalyses::none(), blocksTimesLocations, "local-value-numbering"});
+    manager.add({"local-value-numbering",
+                 [](IRFunction& fn, AnalysisManager& a) { return ValueNumbering::runLocal(fn, a); }});
+    manager.add({"licm", [](IRFunction& fn, AnalysisManager& a) { return LoopInvariantCodeMotion::run(fn, a); },
+                 PreservedAnalyses::none(), loopsTimesInstructions});
+    manager.add({"scev", [](IRFunction& fn, AnalysisManager& a) { return ScalarEvolution::run(fn, a); },
+                 PreservedAnalyses::none(), loopsTimesInstructions});
+    manager.add({"induction-variables", [](IRFunction& fn, AnalysisManager& a) { return InductionVariables::run(fn, a); },
+                 PreservedAnalyses::none(), loopsTimesInstructions});
+    manager.add({"copy-propagation", [](IRFunction& fn, AnalysisManager& a) { return CopyPropagation::run(fn, a); },
+                 PreservedAnalyses::none(), reachingCopies, "sparse-copy-propagation"});
+    manager.add({"sparse-copy-propagation",
+                 [](IRFunction& fn, AnalysisManager& a) { return CopyPropagation::runSparse(fn, a); }});
+    manager.add({"dead-code", [](IRFunction& fn, AnalysisManager& a) { return DeadCodeElimination::run(fn, a); },
+                 PreservedAnalyses::none(), liveSets, "unused-definitions"});
+    manager.add({"unused-definitions", [](IRFunction& fn, AnalysisManager&) { return removeUnusedPseudoDefinitions(fn); }});
+    manager.add({"unswitch", [](IRFunction& fn, AnalysisManager& a) { return LoopUnswitching::run(fn, a); }});
+    manager.add({"unroll", [unrollFactor](IRFunction& fn, AnalysisManager& a) {
+        return LoopUnrolling::run(fn, a, unrollFactor);
+    }, PreservedAnalyses::none(), loopsTimesInstructions});
+    manager.add({"graph-coloring", [](IRFunction& fn, AnalysisManager& a) { return GraphColoringAllocator::run(fn, a); },
+                 PreservedAnalyses::none(), interferenceEdges, "linear-scan"});
+    manager.add({"linear-scan", [](IRFunction& fn, AnalysisManager& a) { return LinearScanAllocator::run(fn, a); }});
+    return manager;
+}
+
+std::string Optimizer::pipeline(int level) {
+    // Debug builds skip the IR passes but still keep values in registers.
+    if (level <= 0) {
+        return "linear-scan";
+    }
+    // Register allocation comes last: no pass before it handles the extra registers.
+    std::string scalar = kScalarPasses;
+    if (level == 1) {
+        return scalar + ",graph-coloring";
+    }
+    // Loop duplication runs once, on simplified loops, and the copies are
+    // cleaned up after. Unswitching first leaves smaller bodies to unroll.
+    return scalar + ",unswitch," + scalar + ",unroll," + scalar + ",graph-coloring";
+}
+
+void Optimizer::optimize(IRProgram& program, int level, int unrollFactor, OptimizationRemarks* remarks,
+                         double budget) {
+    optimize(program, pipeline(level), unrollFactor, remarks, budget);
+}
+
+void Optimizer::optimize(IRProgram& program, const std::string& passes, int unrollFactor,
+                         OptimizationRemarks* remarks, double budget) {
+    PassManager manager = passManager(unrollFactor);
+    manager.parse(passes);
+    manager.setBudget(budget);
+    if (program.function) {
+        manager.run(*program.function, remarks);
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef COMPILER_OPTIMIZER_H
+#define COMPILER_OPTIMIZER_H
+
+#include <string>
+#include "ir.h"
+#include "loop_unrolling.h"
+#include "pass_manager.h"
+
+class Optimizer {
+public:
+    // Runs the IR optimization pipeline for the given level in place.
+    // Level 0 only assigns registers, by linear scan. Level 1 iterates the
+    // scalar passes and allocates registers by graph coloring; level 2 also
+    // unswitches and unrolls loops, cleaning up after each. `unrollFactor` is
+    // the default partial unrolling factor; below 2 only `#pragma unroll`
+    // loops unroll. Passes report what they did to `remarks` when given.
+    // Passes estimated to take more than `budget` (see PassManager::setBudget)
+    // give way to a cheaper fallback or are skipped.
+    static void optimize(IRProgram& program, int level, int unrollFactor = LoopUnrolling::kDefaultFactor,
+                         OptimizationRemarks* remarks = nullptr, double budget = PassManager::kDefaultBudget);
+    // Runs a pipeline in PassManager syntax instead of a preset, as
+    // `--passes=` does. Throws std::runtime_error if it does not parse.
+    static void optimize(IRProgram& program, const std::string& passes,
+                         int unrollFactor = LoopUnrolling::kDefaultFactor, OptimizationRemarks* remarks = nullptr,
+                         double budget = PassManager::kDefaultBudget);
+
+    // The preset pipeline of a level.
+    static std::string pipeline(int level);
+    // A pass manager that knows every IR pass by name.
+    static PassManager passManager(int unrollFactor = LoopUnrolling::kDefaultFactor);
+};
+
+#endif // COMPILER_OPTIMIZER_H
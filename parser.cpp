@@ -135,6 +135,9 @@ std::unique_ptr<Statement> Parser::parseStatement() {
     if (peekToken().type == TokenType::FOR_KEYWORD) {
         return parseForStatement();
     }
+    if (peekToken().type == TokenType::PRAGMA_UNROLL) {
+        return parseUnrollPragma();
+    }
     if (peekToken().type == TokenType::BREAK_KEYWORD) {
         return parseBreak();
     }
@@ -187,15 +190,19 @@ std::unique_ptr<Statement> Parser::parseContinue() {
 }
 
 std::unique_ptr<Statement> Parser::parseWhileStatement() {
+    int line = peekToken().line;
     expect(TokenType::WHILE_KEYWORD);
     expect(TokenType::OPEN_PAREN);
     auto condition = parseExp();
     expect(TokenType::CLOSE_PAREN);
     auto body = parseStatement();
-    return std::make_unique<WhileStatement>(std::move(condition), std::move(body));
+    auto loop = std::make_unique<WhileStatement>(std::move(condition), std::move(body));
+    loop->line = line;
+    return loop;
 }
 
 std::unique_ptr<Statement> Parser::parseDoWhileStatement() {
+    int line = peekToken().line;
     expect(TokenType::DO_KEYWORD);
     auto body = parseStatement();
     expect(TokenType::WHILE_KEYWORD);
@@ -203,7 +210,9 @@ std::unique_ptr<Statement> Parser::parseDoWhileStatement() {
     auto condition = parseExp();
     expect(TokenType::CLOSE_PAREN);
     expect(TokenType::SEMICOLON);
-    return std::make_unique<DoWhileStatement>(std::move(body), std::move(condition));
+    auto loop = std::make_unique<DoWhileStatement>(std::move(body), std::move(condition));
+    loop->line = line;
+    return loop;
 }
 
 std::unique_ptr<ForInit> Parser::parseForInit() {
@@ -221,6 +230,7 @@ std::unique_ptr<ForInit> Parser::parseForInit() {
 }
 
 std::unique_ptr<Statement> Parser::parseForStatement() {
+    int line = peekToken().line;
     expect(TokenType::FOR_KEYWORD);
     expect(TokenType::OPEN_PAREN);
     auto init = parseForInit();
@@ -235,11 +245,29 @@ std::unique_ptr<Statement> Parser::parseForStatement() {
     }
     expect(TokenType::CLOSE_PAREN);
     auto body = parseStatement();
-    return std::make_unique<ForStatement>(
+    auto loop = std::make_unique<ForStatement>(
         std::move(init),
         std::move(condition),
         std::move(post),
         std::move(body));
+    loop->line = line;
+    return loop;
+}
+
+std::unique_ptr<Statement> Parser::parseUnrollPragma() {
+    Token pragma = takeToken();
+    int factor = pragma.value.empty() ? -1 : std::stoi(pragma.value);
+    auto statement = parseStatement();
+    if (auto* w = dynamic_cast<WhileStatement*>(statement.get())) {
+        w->unroll = factor;
+    } else if (auto* dw = dynamic_cast<DoWhileStatement*>(statement.get())) {
+        dw->unroll = factor;
+    } else if (auto* f = dynamic_cast<ForStatement*>(statement.get())) {
+        f->unroll = factor;
+    } else {
+        throw std::runtime_error("Syntax error: #pragma unroll must precede a loop");
+    }
+    return statement;
 }
 
 // Top-level entry for expressions
@@ -25,6 +25,7 @@ private:
     std::unique_ptr<Statement> parseWhileStatement();
     std::unique_ptr<Statement> parseDoWhileStatement();
     std::unique_ptr<Statement> parseForStatement();
+    std::unique_ptr<Statement> parseUnrollPragma();
     std::unique_ptr<ForInit> parseForInit();
     std::unique_ptr<Statement> parseBreak();
     std::unique_ptr<Statement> parseContinue();
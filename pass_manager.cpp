@@ -0,0 +1,136 @@
+#include "pass_manager.h"
+
+#include <cctype>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    static void countChange(OptimizationRemarks& remarks, size_t before, size_t after,
+                            const char* removed, const char* added) {
+        if (after < before) remarks.count(removed, static_cast<long>(before - after));
+        if (after > before) remarks.count(added, static_cast<long>(after - before));
+    }
+
+    static std::string amount(double work) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.3g", work);
+        return text;
+    }
+}
+
+void PassManager::add(Pass pass) {
+    byName[pass.name] = static_cast<int>(passes.size());
+    passes.push_back(std::move(pass));
+}
+
+void PassManager::parse(const std::string& text) {
+    size_t pos = 0;
+    auto steps = text.empty() ? std::vector<Step>{} : parseList(text, pos, false);
+    if (pos != text.size()) {
+        throw std::runtime_error("Pass pipeline error: unexpected '" + text.substr(pos, 1) + "'");
+    }
+    pipeline = std::move(steps);
+}
+
+std::vector<PassManager::Step> PassManager::parseList(const std::string& text, size_t& pos, bool nested) const {
+    std::vector<Step> steps;
+    while (true) {
+        size_t start = pos;
+        while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '-')) {
+            ++pos;
+        }
+        std::string name = text.substr(start, pos - start);
+        if (name.empty()) {
+            throw std::runtime_error("Pass pipeline error: expected a pass name at position " + std::to_string(start));
+        }
+        Step step;
+        if (name == "repeat" && pos < text.size() && text[pos] == '(') {
+            ++pos;
+            step.group = parseList(text, pos, true);
+            if (pos >= text.size() || text[pos] != ')') {
+                throw std::runtime_error("Pass pipeline error: missing ')'");
+            }
+            ++pos;
+        } else {
+            auto it = byName.find(name);
+            if (it == byName.end()) {
+                throw std::runtime_error("Pass pipeline error: unknown pass '" + name + "'");
+            }
+            step.pass = it->second;
+            const std::string& fallback = passes[step.pass].fallback;
+            if (!fallback.empty() && !byName.count(fallback)) {
+                throw std::runtime_error("Pass pipeline error: unknown fallback '" + fallback + "' of '" + name + "'");
+            }
+        }
+        step.text = text.substr(start, pos - start);
+        steps.push_back(std::move(step));
+
+        if (pos < text.size() && text[pos] == ',') {
+            ++pos;
+            continue;
+        }
+        if (pos == text.size() || (nested && text[pos] == ')')) {
+            return steps;
+        }
+        throw std::runtime_error("Pass pipeline error: unexpected '" + text.substr(pos, 1) + "'");
+    }
+}
+
+bool PassManager::run(IRFunction& fn, OptimizationRemarks* remarks) const {
+    if (remarks) remarks->setFunction(fn.name);
+    AnalysisManager analyses(fn, remarks);
+    History history;
+    return runSteps(pipeline, fn, analyses, history);
+}
+
+bool PassManager::runSteps(const std::vector<Step>& steps, IRFunction& fn, AnalysisManager& analyses,
+                           History& history) const {
+    bool changed = false;
+    for (const auto& step : steps) {
+        if (step.pass >= 0) {
+            int index = withinBudget(step.pass, fn, analyses, history);
+            if (index < 0) continue;
+            const Pass& pass = passes[index];
+            OptimizationRemarks& remarks = analyses.remarks();
+            remarks.setPass(pass.name);
+            size_t instructions = fn.body.size();
+            size_t blocks = remarks.enabled() ? analyses.cfg().blocks.size() : 0;
+            if (!pass.run(fn, analyses)) continue;
+            analyses.invalidate(pass.preserved);
+            if (remarks.enabled()) {
+                countChange(remarks, instructions, fn.body.size(), "instructions removed", "instructions added");
+                countChange(remarks, blocks, analyses.cfg().blocks.size(), "blocks deleted", "blocks added");
+            }
+            ++history.changes;
+            changed = true;
+            continue;
+        }
+        auto last = history.groups.find(step.text);
+        if (last != history.groups.end() && last->second == history.changes) continue;
+        for (int round = 0; round < kMaxRounds; ++round) {
+            if (!runSteps(step.group, fn, analyses, history)) break;
+            changed = true;
+        }
+        history.groups[step.text] = history.changes;
+    }
+    return changed;
+}
+
+int PassManager::withinBudget(int index, const IRFunction& fn, AnalysisManager& analyses, History& history) const {
+    const Pass& pass = passes[index];
+    if (!pass.cost || budget <= 0) return index;
+    double work = pass.cost(fn, analyses);
+    if (work <= budget) return index;
+
+    int fallback = pass.fallback.empty() ? -1 : byName.at(pass.fallback);
+    OptimizationRemarks& remarks = analyses.remarks();
+    remarks.setPass(pass.name);
+    remarks.count(fallback < 0 ? "runs skipped over budget" : "runs replaced over budget");
+    if (remarks.enabled() && history.overBudget.insert(index).second) {
+        remarks.missed("OverBudget", 0,
+                       "estimated work " + amount(work) + " exceeds the compile-time budget of " + amount(budget)
+                           + (fallback < 0 ? "; skipped" : "; ran " + pass.fallback + " instead"));
+    }
+    return fallback < 0 ? -1 : withinBudget(fallback, fn, analyses, history);
+}
@@ -0,0 +1,93 @@
+#ifndef COMPILER_PASS_MANAGER_H
+#define COMPILER_PASS_MANAGER_H
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "analysis_manager.h"
+#include "ir.h"
+#include "remarks.h"
+
+// An IR pass as the pass manager sees it. `run` returns true if the function
+// changed, in which case the manager drops every analysis outside
+// `preserved`.
+//
+// A pass whose work grows faster than the function declares a `cost`: an
+// estimate of that work in steps of about ten nanoseconds, the unit of
+// PassManager::setBudget. Over the budget the manager runs the `fallback`
+// pass instead, or nothing if there is none. Passes without a cost are
+// linear and always run.
+struct Pass {
+    std::string name;
+    std::function<bool(IRFunction&, AnalysisManager&)> run;
+    PreservedAnalyses preserved = PreservedAnalyses::none();
+    std::function<double(const IRFunction&, AnalysisManager&)> cost{};
+    std::string fallback{};
+};
+
+// Runs a pipeline of registered passes over a function, sharing one
+// AnalysisManager between them so that an analysis is only recomputed after
+// a pass that broke it.
+//
+// A pipeline is a comma-separated list of pass names. `repeat(...)` runs the
+// passes inside it until a whole round changes nothing, at most kMaxRounds
+// times; a group is skipped altogether when the function has not changed
+// since an identical group last ran. For example:
+//
+//   repeat(sccp,dead-code),unroll,repeat(sccp,dead-code),graph-coloring
+//
+// Each run of a pass with a cost model is checked against the compile-time
+// budget, so that huge functions only get the passes that stay linear.
+class PassManager {
+public:
+    static constexpr int kMaxRounds = 8;
+    // About half a second for one run of a pass.
+    static constexpr double kDefaultBudget = 5e7;
+
+    // Registers a pass; a fallback must be registered before the pipeline
+    // is parsed.
+    void add(Pass pass);
+    // The most work a pass may estimate for itself; 0 lifts the limit.
+    void setBudget(double work) { budget = work; }
+
+    // Replaces the pipeline; an empty one runs nothing. Throws std::runtime_error on an unknown pass or
+    // malformed text, leaving the previous pipeline in place.
+    void parse(const std::string& pipeline);
+
+    // Returns true if any pass changed the function. With `remarks`, each
+    // pass reports to it, and the manager counts the instructions and blocks
+    // every pass removed or added.
+    bool run(IRFunction& fn, OptimizationRemarks* remarks = nullptr) const;
+
+private:
+    // A single pass, or a repeat group when `pass` is negative.
+    struct Step {
+        int pass = -1;
+        std::vector<Step> group;
+        std::string text;
+    };
+
+    // How many times the function has changed, the count each group text
+    // last finished at, and the passes already reported over budget.
+    struct History {
+        int changes = 0;
+        std::map<std::string, int> groups;
+        std::set<int> overBudget;
+    };
+
+    std::vector<Step> parseList(const std::string& text, size_t& pos, bool nested) const;
+    bool runSteps(const std::vector<Step>& steps, IRFunction& fn, AnalysisManager& analyses,
+                  History& history) const;
+    // The pass to run in place of `index` on this function: itself, its
+    // fallback when over budget, or -1 to skip it.
+    int withinBudget(int index, const IRFunction& fn, AnalysisManager& analyses, History& history) const;
+
+    std::vector<Pass> passes;
+    std::map<std::string, int> byName;
+    std::vector<Step> pipeline;
+    double budget = kDefaultBudget;
+};
+
+#endif // COMPILER_PASS_MANAGER_H
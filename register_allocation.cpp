@@ -0,0 +1,55 @@
+#include "register_allocation.h"
+
+#include "ir_utils.h"
+
+const std::vector<IRRegister>& allocatableRegisters() {
+    static const std::vector<IRRegister> registers = {
+        IRRegister::CX, IRRegister::SI, IRRegister::DI, IRRegister::R8, IRRegister::R9,
+        IRRegister::AX, IRRegister::DX,
+        IRRegister::BX, IRRegister::R12, IRRegister::R13, IRRegister::R14, IRRegister::R15,
+    };
+    return registers;
+}
+
+bool isCalleeSaved(IRRegister reg) {
+    switch (reg) {
+        case IRRegister::BX:
+        case IRRegister::R12:
+        case IRRegister::R13:
+        case IRRegister::R14:
+        case IRRegister::R15:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void assignRegisters(IRFunction& fn, const RegisterAssignment& assignment) {
+    for (auto& inst : fn.body) {
+        forEachOperand(inst, [&](IROperand& op, OperandRole) {
+            if (op.isPseudo() && assignment[op.asPseudo()]) op = IROperand::reg(*assignment[op.asPseudo()]);
+        });
+        auto* m = std::get_if<IRMov>(&inst);
+        if (m && m->src == m->dst) inst = IRNop{};
+    }
+    eraseNops(fn);
+}
+
+void reportAssignment(const IRFunction& fn, const RegisterAssignment& assignment, OptimizationRemarks& remarks) {
+    if (!remarks.enabled()) return;
+    std::vector<bool> mentioned(fn.pseudos.size(), false);
+    for (const auto& inst : fn.body) {
+        forEachOperand(inst, [&](const IROperand& op, OperandRole) {
+            if (op.isPseudo()) mentioned[op.asPseudo()] = true;
+        });
+    }
+    for (size_t p = 0; p < fn.pseudos.size(); ++p) {
+        if (!mentioned[p]) continue;
+        if (assignment[p]) {
+            remarks.count("pseudos assigned registers");
+            continue;
+        }
+        remarks.count("spills inserted");
+        remarks.missed("Spilled", 0, fn.pseudos[p] + " is kept on the stack: no register was left for it");
+    }
+}
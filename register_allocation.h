@@ -0,0 +1,29 @@
+#ifndef COMPILER_REGISTER_ALLOCATION_H
+#define COMPILER_REGISTER_ALLOCATION_H
+
+#include <optional>
+#include <vector>
+#include "ir.h"
+#include "remarks.h"
+
+// Registers pseudos may be assigned to, in order of preference: caller-saved
+// ones first, since the callee-saved ones cost a push and a pop. R10 and R11
+// stay reserved for the code generator.
+const std::vector<IRRegister>& allocatableRegisters();
+
+// Registers the System V ABI requires a function to preserve.
+bool isCalleeSaved(IRRegister reg);
+
+// Register chosen for each pseudo, indexed by pseudo id.
+using RegisterAssignment = std::vector<std::optional<IRRegister>>;
+
+// Replaces every pseudo with a register in `assignment` by that register and
+// deletes the moves that become `mov r, r`. Pseudos left out stay in memory.
+void assignRegisters(IRFunction& fn, const RegisterAssignment& assignment);
+
+// Counts the pseudos the function still mentions that got a register and
+// those spilled to the stack, with a remark naming each spilled one. Call
+// before assignRegisters.
+void reportAssignment(const IRFunction& fn, const RegisterAssignment& assignment, OptimizationRemarks& remarks);
+
+#endif // COMPILER_REGISTER_ALLOCATION_H
@@ -0,0 +1,51 @@
+#include "remarks.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+    // Single-quoted YAML scalar: only the quote itself needs escaping.
+    static std::string quoted(const std::string& text) {
+        std::string result = "'";
+        for (char c : text) {
+            result += c;
+            if (c == '\'') result += c;
+        }
+        return result + "'";
+    }
+}
+
+void OptimizationRemarks::count(const char* counter, long amount) {
+    if (active && amount != 0) counters[{pass, counter}] += amount;
+}
+
+void OptimizationRemarks::applied(std::string name, int line, std::string reason) {
+    if (active) records.push_back({Kind::Applied, pass, std::move(name), function, line, std::move(reason)});
+}
+
+void OptimizationRemarks::missed(std::string name, int line, std::string reason) {
+    if (active) records.push_back({Kind::Missed, pass, std::move(name), function, line, std::move(reason)});
+}
+
+void OptimizationRemarks::printStatistics(std::ostream& out) const {
+    out << "===" << std::string(73, '-') << "===\n";
+    out << std::string(26, ' ') << "... Statistics Collected ...\n";
+    out << "===" << std::string(73, '-') << "===\n\n";
+    size_t width = 1;
+    for (const auto& [key, value] : counters) width = std::max(width, std::to_string(value).size());
+    for (const auto& [key, value] : counters) {
+        out << std::setw(static_cast<int>(width)) << value << " " << key.first << " - " << key.second << "\n";
+    }
+}
+
+void OptimizationRemarks::writeYaml(std::ostream& out) const {
+    for (const auto& remark : records) {
+        out << (remark.kind == Kind::Applied ? "--- !Passed\n" : "--- !Missed\n");
+        out << "Pass:            " << quoted(remark.pass) << "\n";
+        out << "Name:            " << quoted(remark.name) << "\n";
+        out << "Function:        " << quoted(remark.function) << "\n";
+        if (remark.line > 0) out << "Line:            " << remark.line << "\n";
+        out << "Reason:          " << quoted(remark.reason) << "\n";
+        out << "...\n";
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef COMPILER_REMARKS_H
+#define COMPILER_REMARKS_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A record of what the optimizer did, for `--stats` and `--remarks`:
+// counters per pass, and remarks on single transformations that were
+// applied or that a pass considered and gave up on, with the reason. Passes
+// reach it through AnalysisManager::remarks(); the pass manager names the
+// pass that is running. A disabled log keeps nothing, so passes should
+// check enabled() before spending time on a remark.
+class OptimizationRemarks {
+public:
+    enum class Kind { Applied, Missed };
+
+    struct Remark {
+        Kind kind;
+        std::string pass;
+        std::string name;     // what happened, e.g. "Unrolled"
+        std::string function;
+        int line = 0;         // source line, 0 if unknown
+        std::string reason;
+    };
+
+    explicit OptimizationRemarks(bool enabled = true) : active(enabled) {}
+
+    bool enabled() const { return active; }
+    void setFunction(std::string name) { function = std::move(name); }
+    void setPass(std::string name) { pass = std::move(name); }
+
+    void count(const char* counter, long amount = 1);
+    void applied(std::string name, int line, std::string reason);
+    void missed(std::string name, int line, std::string reason);
+
+    // Counter totals keyed by pass and counter name.
+    const std::map<std::pair<std::string, std::string>, long>& statistics() const { return counters; }
+    const std::vector<Remark>& remarks() const { return records; }
+
+    // One `value pass - counter` line per counter, like LLVM's -stats.
+    void printStatistics(std::ostream& out) const;
+    // A YAML document per remark, in the layout of LLVM's remark files.
+    void writeYaml(std::ostream& out) const;
+
+private:
+    bool active;
+    std::string function;
+    std::string pass;
+    std::map<std::pair<std::string, std::string>, long> counters;
+    std::vector<Remark> records;
+};
+
+#endif // COMPILER_REMARKS_H
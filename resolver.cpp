@@ -109,12 +109,18 @@ namespace {
         if (auto* whileStmt = dynamic_cast<const WhileStatement*>(&stmt)) {
             auto condition = resolveExp(*whileStmt->condition, scopes);
             auto body = resolveStatement(*whileStmt->body, scopes);
-            return std::make_unique<WhileStatement>(std::move(condition), std::move(body), whileStmt->label);
+            auto resolved = std::make_unique<WhileStatement>(std::move(condition), std::move(body), whileStmt->label);
+            resolved->unroll = whileStmt->unroll;
+            resolved->line = whileStmt->line;
+            return resolved;
         }
         if (auto* doWhile = dynamic_cast<const DoWhileStatement*>(&stmt)) {
             auto body = resolveStatement(*doWhile->body, scopes);
             auto condition = resolveExp(*doWhile->condition, scopes);
-            return std::make_unique<DoWhileStatement>(std::move(body), std::move(condition), doWhile->label);
+            auto resolved = std::make_unique<DoWhileStatement>(std::move(body), std::move(condition), doWhile->label);
+            resolved->unroll = doWhile->unroll;
+            resolved->line = doWhile->line;
+            return resolved;
         }
         if (auto* forStmt = dynamic_cast<const ForStatement*>(&stmt)) {
             scopes.push();
@@ -129,12 +135,15 @@ namespace {
             }
             auto body = resolveStatement(*forStmt->body, scopes);
             scopes.pop();
-            return std::make_unique<ForStatement>(
+            auto resolved = std::make_unique<ForStatement>(
                 std::move(init),
                 std::move(cond),
                 std::move(post),
                 std::move(body),
                 forStmt->label);
+            resolved->unroll = forStmt->unroll;
+            resolved->line = forStmt->line;
+            return resolved;
         }
         if (dynamic_cast<const EmptyStatement*>(&stmt)) {
             return std::make_unique<EmptyStatement>();
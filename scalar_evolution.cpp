@@ -0,0 +1,395 @@
+#include "scalar_evolution.h"
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "ir_utils.h"
+#include "liveness.h"
+#include "loops.h"
+
+namespace {
+    constexpr int kMaxDegree = 3;
+
+    // C(k, m) modulo 2^32, dividing out the factorial before multiplying.
+    static uint32_t binomial(uint64_t k, int m) {
+        if (static_cast<uint64_t>(m) > k) return 0;
+        switch (m) {
+            case 0: return 1;
+            case 1: return static_cast<uint32_t>(k);
+            case 2: {
+                uint64_t a = k, b = k - 1;
+                (a % 2 == 0 ? a : b) /= 2;
+                return static_cast<uint32_t>(a * b);
+            }
+            case 3: {
+                uint64_t f[3] = {k, k - 1, k - 2};
+                for (auto& x : f) if (x % 3 == 0) { x /= 3; break; }
+                for (auto& x : f) if (x % 2 == 0) { x /= 2; break; }
+                return static_cast<uint32_t>(f[0] * f[1] * f[2]);
+            }
+        }
+        return 0;
+    }
+
+    // The constant 1, a pseudo's value on loop entry, or its value at the
+    // start of the current iteration.
+    struct Symbol {
+        int pseudo = -1; // -1 for the constant
+        bool iterationStart = false;
+
+        auto operator<=>(const Symbol&) const = default;
+    };
+    constexpr Symbol kOne{};
+
+    // A value as a function of the iteration number k:
+    //   sum over symbols s of (c0 + c1*C(k,1) + c2*C(k,2) + c3*C(k,3)) * s
+    // Coefficients wrap like 32-bit registers.
+    struct Chrec {
+        using Coefficients = std::array<uint32_t, kMaxDegree + 1>;
+        std::map<Symbol, Coefficients> terms;
+
+        static Chrec constant(uint32_t c) {
+            Chrec r;
+            if (c != 0) r.terms[kOne] = {c, 0, 0, 0};
+            return r;
+        }
+        static Chrec symbol(Symbol s) {
+            Chrec r;
+            r.terms[s] = {1, 0, 0, 0};
+            return r;
+        }
+
+        std::optional<uint32_t> asConstant() const {
+            if (terms.empty()) return 0;
+            auto it = terms.find(kOne);
+            if (terms.size() != 1 || it == terms.end()) return std::nullopt;
+            for (int m = 1; m <= kMaxDegree; ++m) {
+                if (it->second[m] != 0) return std::nullopt;
+            }
+            return it->second[0];
+        }
+
+        void addScaled(const Chrec& other, uint32_t scale) {
+            for (const auto& [symbol, coeffs] : other.terms) {
+                auto& mine = terms[symbol];
+                for (int m = 0; m <= kMaxDegree; ++m) mine[m] += coeffs[m] * scale;
+            }
+            normalize();
+        }
+
+        void normalize() {
+            std::erase_if(terms, [](const auto& term) {
+                for (uint32_t c : term.second) if (c != 0) return false;
+                return true;
+            });
+        }
+
+        bool mentionsIterationStart() const {
+            for (const auto& term : terms) {
+                if (term.first.iterationStart) return true;
+            }
+            return false;
+        }
+
+        // Evaluates the polynomial part at k, leaving a constant per symbol.
+        std::map<Symbol, uint32_t> at(uint64_t k) const {
+            std::map<Symbol, uint32_t> result;
+            for (const auto& [symbol, coeffs] : terms) {
+                uint32_t v = 0;
+                for (int m = 0; m <= kMaxDegree; ++m) v += coeffs[m] * binomial(k, m);
+                if (v != 0) result[symbol] = v;
+            }
+            return result;
+        }
+    };
+
+    static int32_t asSigned(uint32_t v) {
+        return static_cast<int32_t>(v);
+    }
+
+    class LoopEvaluator {
+    public:
+        LoopEvaluator(IRFunction& fn, const CFG& cfg, const Dominators& dominators, const LoopForest& forest,
+                      const LocationIndex& locations, const Liveness& liveness, const Loop& loop)
+            : fn(fn), cfg(cfg), dominators(dominators), forest(forest), locations(locations), liveness(liveness),
+              loop(loop), block(cfg.blocks[loop.header]) {}
+
+        // Closed-form replacement for the loop body, or nullopt.
+        std::optional<std::vector<IRInstruction>> evaluate() {
+            if (loop.blocks.size() != 1 || loop.exits.size() != 1) return std::nullopt;
+            auto test = findExitTest(fn, cfg, loop);
+            if (!test || !test->bound.isImm()) return std::nullopt;
+            testBegin = test->compare;
+            // The test's own temporaries are not recomputed.
+            for (size_t i = testBegin; i < block.end; ++i) {
+                bool liveOut = false;
+                forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole role) {
+                    int loc = locations.find(op);
+                    if (loc >= 0 && role != OperandRole::Read && liveness.isLiveIn(loop.exits[0], loc)) liveOut = true;
+                });
+                if (liveOut) return std::nullopt;
+            }
+            for (size_t i = block.begin + 1; i < testBegin; ++i) {
+                if (!execute(fn.body[i])) return std::nullopt;
+            }
+            if (!solveRecurrences()) return std::nullopt;
+
+            // The counter the test reads must be a + b*k after iteration k.
+            auto counter = valueAfterIteration(test->counter.asPseudo());
+            if (counter) substituteEntryConstants(*counter);
+            if (!counter || (!counter->terms.empty() && (counter->terms.size() != 1 || !counter->terms.count(kOne)))) {
+                return std::nullopt;
+            }
+            auto coeffs = counter->terms.empty() ? Chrec::Coefficients{} : counter->terms.at(kOne);
+            if (coeffs[2] != 0 || coeffs[3] != 0) return std::nullopt;
+            auto iterations = iterationsUntilExit(test->continueCond, asSigned(coeffs[0]), asSigned(coeffs[1]), test->bound.asImm());
+            if (!iterations) return std::nullopt;
+            return emit(static_cast<uint64_t>(*iterations));
+        }
+
+    private:
+        IRFunction& fn;
+        const CFG& cfg;
+        const Dominators& dominators;
+        const LoopForest& forest;
+        const LocationIndex& locations;
+        const Liveness& liveness;
+        const Loop& loop;
+        const BasicBlock& block;
+        size_t testBegin = 0;
+        std::map<int, Chrec> env;        // pseudo -> value at the end of the body
+        std::map<int, Chrec> closedForm; // carried pseudo -> value at start of iteration k
+
+        Chrec read(const IROperand& op) {
+            if (op.isImm()) {
+                return Chrec::constant(static_cast<uint32_t>(op.asImm()));
+            }
+            int pseudo = op.asPseudo();
+            auto it = env.find(pseudo);
+            if (it != env.end()) return it->second;
+            return Chrec::symbol(Symbol{pseudo, definedInLoop(op)});
+        }
+
+        bool definedInLoop(const IROperand& pseudo) const {
+            for (size_t i = block.begin; i < testBegin; ++i) {
+                bool defines = false;
+                forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole role) {
+                    if (op == pseudo && role != OperandRole::Read) defines = true;
+                });
+                if (defines) return true;
+            }
+            return false;
+        }
+
+        // Symbolically executes one body instruction; false if it is not affine.
+        bool execute(const IRInstruction& inst) {
+            bool ok = true;
+            forEachOperand(inst, [&](const IROperand& op, OperandRole) {
+                if (!op.isImm() && !op.isPseudo()) ok = false;
+            });
+            if (!ok) return false;
+            if (auto* m = std::get_if<IRMov>(&inst)) {
+                env[m->dst.asPseudo()] = read(m->src);
+                return true;
+            }
+            if (auto* u = std::get_if<IRUnary>(&inst)) {
+                Chrec value = read(u->operand);
+                Chrec result = u->op == IRUnaryOperator::Not ? Chrec::constant(0xFFFFFFFFu) : Chrec{};
+                result.addScaled(value, 0xFFFFFFFFu); // -x, or ~x = -x - 1
+                env[u->operand.asPseudo()] = result;
+                return true;
+            }
+            if (auto* b = std::get_if<IRBinary>(&inst)) {
+                Chrec dst = read(b->dst);
+                Chrec src = read(b->src);
+                switch (b->op) {
+                    case IRBinaryOperator::Add: dst.addScaled(src, 1); break;
+                    case IRBinaryOperator::Sub: dst.addScaled(src, 0xFFFFFFFFu); break;
+                    case IRBinaryOperator::Mul: {
+                        auto lhs = dst.asConstant();
+                        auto rhs = src.asConstant();
+                        if (rhs) {
+                            Chrec r;
+                            r.addScaled(dst, *rhs);
+                            dst = r;
+                        } else if (lhs) {
+                            Chrec r;
+                            r.addScaled(src, *lhs);
+                            dst = r;
+                        } else {
+                            return false;
+                        }
+                        break;
+                    }
+                }
+                env[b->dst.asPseudo()] = dst;
+                return true;
+            }
+            return false;
+        }
+
+        // Replaces every iteration-start symbol of a pseudo q in value by q's
+        // closed form. False if some q is unsolved or appears with a
+        // coefficient depending on k.
+        bool substitute(Chrec& value) const {
+            Chrec result;
+            for (const auto& [symbol, coeffs] : value.terms) {
+                if (!symbol.iterationStart) {
+                    Chrec single;
+                    single.terms[symbol] = coeffs;
+                    result.addScaled(single, 1);
+                    continue;
+                }
+                auto it = closedForm.find(symbol.pseudo);
+                if (it == closedForm.end() || coeffs[1] != 0 || coeffs[2] != 0 || coeffs[3] != 0) return false;
+                result.addScaled(it->second, coeffs[0]);
+            }
+            value = result;
+            return true;
+        }
+
+        // Every pseudo carried around the loop must be p(k+1) = p(k) + d(k)
+        // with d of degree at most 2 once the other recurrences are known.
+        bool solveRecurrences() {
+            std::set<int> pending;
+            for (const auto& [pseudo, value] : env) {
+                if (liveness.isLiveIn(block.id, locations.pseudo(pseudo))) pending.insert(pseudo);
+            }
+            bool progress = true;
+            while (!pending.empty() && progress) {
+                progress = false;
+                for (auto it = pending.begin(); it != pending.end();) {
+                    Chrec delta = env.at(*it);
+                    auto self = delta.terms.find(Symbol{*it, true});
+                    if (self == delta.terms.end() || self->second != Chrec::Coefficients{1, 0, 0, 0}) return false;
+                    delta.terms.erase(self);
+                    bool ready = true;
+                    for (const auto& term : delta.terms) {
+                        if (term.first.iterationStart && !closedForm.count(term.first.pseudo)) {
+                            ready = false;
+                        }
+                    }
+                    if (!ready) {
+                        ++it;
+                        continue;
+                    }
+                    if (!substitute(delta)) return false;
+                    // p(k) = p(0) + sum_{j<k} d(j), and sum_{j<k} C(j, m) = C(k, m + 1).
+                    Chrec form = Chrec::symbol(Symbol{*it, false});
+                    for (const auto& [symbol, coeffs] : delta.terms) {
+                        if (coeffs[kMaxDegree] != 0) return false;
+                        auto& target = form.terms[symbol];
+                        for (int m = kMaxDegree; m > 0; --m) target[m] += coeffs[m - 1];
+                    }
+                    form.normalize();
+                    closedForm.emplace(*it, std::move(form));
+                    it = pending.erase(it);
+                    progress = true;
+                }
+            }
+            return pending.empty();
+        }
+
+        // Replaces symbols whose value on entry to the loop is a known constant.
+        void substituteEntryConstants(Chrec& value) const {
+            Chrec result;
+            for (const auto& [symbol, coeffs] : value.terms) {
+                Chrec single;
+                auto constant = symbol.pseudo < 0 || symbol.iterationStart
+                    ? std::nullopt
+                    : constantOnEntry(fn, cfg, dominators, forest, loop, IROperand::pseudo(symbol.pseudo));
+                single.terms[constant ? kOne : symbol] = coeffs;
+                result.addScaled(single, constant ? static_cast<uint32_t>(*constant) : 1);
+            }
+            value = result;
+        }
+
+        // Value of a pseudo at the end of iteration k (before the test).
+        std::optional<Chrec> valueAfterIteration(int pseudo) const {
+            auto it = env.find(pseudo);
+            if (it == env.end()) return std::nullopt;
+            Chrec value = it->second;
+            if (!substitute(value)) return std::nullopt;
+            return value;
+        }
+
+        std::vector<IRInstruction> emit(uint64_t iterations) {
+            std::vector<IRInstruction> code;
+            code.push_back(IRLabel(std::get_if<IRLabel>(&fn.body[block.begin])->id));
+
+            std::vector<std::pair<IROperand, IROperand>> finals;
+            for (const auto& [pseudo, value] : env) {
+                if (!liveness.isLiveIn(loop.exits[0], locations.pseudo(pseudo))) continue;
+                auto last = closedForm.count(pseudo) ? closedForm.at(pseudo).at(iterations)
+                                                     : valueAfterIteration(pseudo)->at(iterations - 1);
+                IROperand temp = makePassTemp(fn, "scev");
+                auto constant = last.find(kOne);
+                code.push_back(IRMov(
+                    IROperand::imm(asSigned(constant == last.end() ? 0 : constant->second)), temp));
+                for (const auto& [symbol, coeff] : last) {
+                    if (symbol == kOne) continue;
+                    IROperand entry = IROperand::pseudo(symbol.pseudo);
+                    if (coeff == 1) {
+                        code.push_back(IRBinary(IRBinaryOperator::Add, entry, temp));
+                        continue;
+                    }
+                    IROperand product = makePassTemp(fn, "scev");
+                    code.push_back(IRMov(entry, product));
+                    code.push_back(IRBinary(IRBinaryOperator::Mul, IROperand::imm(asSigned(coeff)), product));
+                    code.push_back(IRBinary(IRBinaryOperator::Add, product, temp));
+                }
+                finals.emplace_back(IROperand::pseudo(pseudo), temp);
+            }
+            // Symbols name entry values, so assign only after computing every final value.
+            for (const auto& [pseudo, temp] : finals) {
+                code.push_back(IRMov(temp, pseudo));
+            }
+            return code;
+        }
+    };
+}
+
+bool ScalarEvolution::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool ScalarEvolution::run(IRFunction& fn, AnalysisManager& analyses) {
+    bool changed = false;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        const CFG& cfg = analyses.cfg();
+        if (cfg.blocks.empty()) break;
+        const Dominators& dominators = analyses.dominators();
+        const LoopForest& forest = analyses.loops();
+        const LocationIndex& locations = analyses.locations();
+        const Liveness& liveness = analyses.liveness();
+        for (const auto& loop : forest.loops) {
+            LoopEvaluator evaluator(fn, cfg, dominators, forest, locations, liveness, loop);
+            auto code = evaluator.evaluate();
+            if (!code) continue;
+            analyses.remarks().count("loops replaced by closed forms");
+            analyses.remarks().applied("ClosedForm", sourceLine(fn, cfg, loop),
+                                       "replaced the loop by the final values it computes");
+            const auto& block = cfg.blocks[loop.header];
+            std::vector<IRInstruction> body;
+            body.reserve(fn.body.size());
+            for (size_t i = 0; i < block.begin; ++i) body.push_back(std::move(fn.body[i]));
+            for (auto& inst : *code) body.push_back(std::move(inst));
+            for (size_t i = block.end; i < fn.body.size(); ++i) body.push_back(std::move(fn.body[i]));
+            fn.body = std::move(body);
+            analyses.invalidate();
+            progress = changed = true;
+            break;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,21 @@
+#ifndef COMPILER_SCALAR_EVOLUTION_H
+#define COMPILER_SCALAR_EVOLUTION_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class ScalarEvolution {
+public:
+    // Describes the pseudos of single-block loops as polynomial recurrences
+    // in the iteration number ({start, +, step} chains of up to third
+    // degree). When the exit test compares an affine counter with a constant
+    // and the trip count follows without the counter overflowing, the loop
+    // is replaced by the final values of the pseudos it leaves live.
+    // Arithmetic is exact modulo 2^32, i.e. it produces the same bits the
+    // loop would. Returns true if the function changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_SCALAR_EVOLUTION_H
@@ -0,0 +1,481 @@
+#include "sccp.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <utility>
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "ir_utils.h"
+#include "loops.h"
+
+namespace {
+    // Three-level lattice: Top (no value seen yet) > Const(c) > Bottom (varies).
+    struct LatticeValue {
+        enum class State { Top, Const, Bottom };
+        State state = State::Top;
+        int value = 0;
+
+        static LatticeValue top() { return {State::Top, 0}; }
+        static LatticeValue constant(int v) { return {State::Const, v}; }
+        static LatticeValue bottom() { return {State::Bottom, 0}; }
+
+        bool isTop() const { return state == State::Top; }
+        bool isConst() const { return state == State::Const; }
+        bool isBottom() const { return state == State::Bottom; }
+
+        bool operator==(const LatticeValue& other) const {
+            return state == other.state && (state != State::Const || value == other.value);
+        }
+    };
+
+    static LatticeValue meet(const LatticeValue& a, const LatticeValue& b) {
+        if (a.isTop()) return b;
+        if (b.isTop()) return a;
+        if (a.isBottom() || b.isBottom()) return LatticeValue::bottom();
+        return a.value == b.value ? a : LatticeValue::bottom();
+    }
+
+    // Flags produced by `cmp src, dst`, as the pair of compared values.
+    struct FlagsValue {
+        LatticeValue dst = LatticeValue::bottom();
+        LatticeValue src = LatticeValue::bottom();
+
+        bool isTop() const { return dst.isTop() || src.isTop(); }
+        bool isConst() const { return dst.isConst() && src.isConst(); }
+    };
+
+    static int wrap(int64_t v) {
+        return static_cast<int>(static_cast<uint32_t>(static_cast<uint64_t>(v)));
+    }
+
+    static int foldUnary(IRUnaryOperator op, int v) {
+        switch (op) {
+            case IRUnaryOperator::Neg: return wrap(-static_cast<int64_t>(v));
+            case IRUnaryOperator::Not: return ~v;
+        }
+        return v;
+    }
+
+    // Result of `op src, dst`, i.e. dst = dst op src with x86 wrap-around.
+    static int foldBinary(IRBinaryOperator op, int dst, int src) {
+        switch (op) {
+            case IRBinaryOperator::Add: return wrap(static_cast<int64_t>(dst) + src);
+            case IRBinaryOperator::Sub: return wrap(static_cast<int64_t>(dst) - src);
+            case IRBinaryOperator::Mul: return wrap(static_cast<int64_t>(dst) * src);
+        }
+        return dst;
+    }
+
+    // Quotient and remainder of idiv, or false when the division would trap.
+    static bool foldDivision(int ax, int dx, int divisor, int& quotient, int& remainder) {
+        if (divisor == 0) {
+            return false;
+        }
+        int64_t dividend = static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(dx)) << 32)
+                                                | static_cast<uint32_t>(ax));
+        int64_t q = dividend / divisor;
+        if (q < INT32_MIN || q > INT32_MAX) {
+            return false;
+        }
+        quotient = static_cast<int>(q);
+        remainder = static_cast<int>(dividend % divisor);
+        return true;
+    }
+
+    using LocationState = std::vector<LatticeValue>;
+
+    class Evaluator {
+    public:
+        Evaluator(const LocationIndex& locations, LocationState& state)
+            : locations(locations), state(state) {}
+
+        LatticeValue valueOf(const IROperand& op) const {
+            if (op.isImm()) {
+                return LatticeValue::constant(op.asImm());
+            }
+            int loc = locations.find(op);
+            return loc < 0 ? LatticeValue::bottom() : state[loc];
+        }
+
+        LatticeValue valueOf(IRRegister reg) const {
+            return state[locations.reg(reg)];
+        }
+
+        void set(const IROperand& op, LatticeValue value) {
+            int loc = locations.find(op);
+            if (loc >= 0) {
+                state[loc] = value;
+            }
+        }
+
+        void set(IRRegister reg, LatticeValue value) {
+            state[locations.reg(reg)] = value;
+        }
+
+        // Result of a binary instruction given the lattice values of its operands.
+        static LatticeValue binary(IRBinaryOperator op, LatticeValue dst, LatticeValue src) {
+            if (op == IRBinaryOperator::Mul
+                && ((dst.isConst() && dst.value == 0) || (src.isConst() && src.value == 0))) {
+                return LatticeValue::constant(0);
+            }
+            if (dst.isBottom() || src.isBottom()) return LatticeValue::bottom();
+            if (dst.isTop() || src.isTop()) return LatticeValue::top();
+            return LatticeValue::constant(foldBinary(op, dst.value, src.value));
+        }
+
+        // Value of a SetCC destination after writing the condition into its low byte.
+        LatticeValue setcc(const IRSetCC& s) const {
+            LatticeValue old = valueOf(s.dst);
+            if (flags.isTop() || old.isTop()) return LatticeValue::top();
+            if (!flags.isConst() || old.isBottom()) return LatticeValue::bottom();
+            int bit = evaluateCondition(s.cond, flags.dst.value, flags.src.value) ? 1 : 0;
+            return LatticeValue::constant((old.value & ~0xFF) | bit);
+        }
+
+        // Value of a CMov destination: the source if the flags pick it, the
+        // old value if they do not, and their meet if the flags are unknown.
+        LatticeValue cmov(const IRCMov& c) const {
+            LatticeValue old = valueOf(c.dst);
+            LatticeValue src = valueOf(c.src);
+            if (flags.isTop()) return LatticeValue::top();
+            if (flags.isConst()) return evaluateCondition(c.cond, flags.dst.value, flags.src.value) ? src : old;
+            return meet(old, src);
+        }
+
+        void apply(const IRInstruction& inst) {
+            if (auto* m = std::get_if<IRMov>(&inst)) {
+                set(m->dst, valueOf(m->src));
+            } else if (auto* u = std::get_if<IRUnary>(&inst)) {
+                LatticeValue v = valueOf(u->operand);
+                if (v.isConst()) v = LatticeValue::constant(foldUnary(u->op, v.value));
+                set(u->operand, v);
+            } else if (auto* b = std::get_if<IRBinary>(&inst)) {
+                set(b->dst, binary(b->op, valueOf(b->dst), valueOf(b->src)));
+            } else if (auto* c = std::get_if<IRCmp>(&inst)) {
+                flags = FlagsValue{valueOf(c->dst), valueOf(c->src)};
+            } else if (auto* s = std::get_if<IRSetCC>(&inst)) {
+                set(s->dst, setcc(*s));
+            } else if (auto* c = std::get_if<IRCMov>(&inst)) {
+                set(c->dst, cmov(*c));
+            } else if (std::get_if<IRCdq>(&inst)) {
+                LatticeValue ax = valueOf(IRRegister::AX);
+                set(IRRegister::DX, ax.isConst() ? LatticeValue::constant(ax.value < 0 ? -1 : 0) : ax);
+            } else if (auto* d = std::get_if<IRIdiv>(&inst)) {
+                LatticeValue ax = valueOf(IRRegister::AX);
+                LatticeValue dx = valueOf(IRRegister::DX);
+                LatticeValue divisor = valueOf(d->divisor);
+                int q = 0;
+                int r = 0;
+                if (ax.isConst() && dx.isConst() && divisor.isConst()
+                    && foldDivision(ax.value, dx.value, divisor.value, q, r)) {
+                    set(IRRegister::AX, LatticeValue::constant(q));
+                    set(IRRegister::DX, LatticeValue::constant(r));
+                } else if (ax.isTop() || dx.isTop() || divisor.isTop()) {
+                    set(IRRegister::AX, LatticeValue::top());
+                    set(IRRegister::DX, LatticeValue::top());
+                } else {
+                    set(IRRegister::AX, LatticeValue::bottom());
+                    set(IRRegister::DX, LatticeValue::bottom());
+                }
+            }
+            if (writesFlags(inst) && std::get_if<IRCmp>(&inst) == nullptr) {
+                flags = FlagsValue{};
+            }
+        }
+
+        const LocationIndex& locations;
+        LocationState& state;
+        FlagsValue flags;
+    };
+
+    class Solver {
+    public:
+        Solver(const IRFunction& fn, const CFG& cfg, const LocationIndex& locations)
+            : fn(fn), cfg(cfg), locations(locations),
+              in(cfg.blocks.size(), LocationState(locations.size(), LatticeValue::top())),
+              visited(cfg.blocks.size(), false) {}
+
+        void solve() {
+            if (cfg.blocks.empty()) {
+                return;
+            }
+            std::deque<int> worklist{0};
+            std::vector<bool> queued(cfg.blocks.size(), false);
+            queued[0] = true;
+            // Nothing is known about any location on function entry.
+            std::fill(in[0].begin(), in[0].end(), LatticeValue::bottom());
+            while (!worklist.empty()) {
+                int id = worklist.front();
+                worklist.pop_front();
+                queued[id] = false;
+                visited[id] = true;
+
+                LocationState state = in[id];
+                Evaluator eval(locations, state);
+                const auto& block = cfg.blocks[id];
+                for (size_t i = block.begin; i < block.end; ++i) {
+                    eval.apply(fn.body[i]);
+                }
+
+                for (int succ : executableSuccessors(block, eval.flags)) {
+                    bool newEdge = executable.insert({id, succ}).second;
+                    bool changed = false;
+                    for (size_t loc = 0; loc < state.size(); ++loc) {
+                        LatticeValue merged = meet(in[succ][loc], state[loc]);
+                        if (!(merged == in[succ][loc])) {
+                            in[succ][loc] = merged;
+                            changed = true;
+                        }
+                    }
+                    if ((newEdge || changed) && !queued[succ]) {
+                        queued[succ] = true;
+                        worklist.push_back(succ);
+                    }
+                }
+            }
+        }
+
+        bool isExecutable(int block) const { return visited[block]; }
+        const LocationState& entryState(int block) const { return in[block]; }
+
+    private:
+        std::vector<int> executableSuccessors(const BasicBlock& block, const FlagsValue& flags) const {
+            const auto& last = fn.body[block.end - 1];
+            if (auto* j = std::get_if<IRJumpCC>(&last)) {
+                int target = cfg.labelToBlock[j->target];
+                if (flags.isTop()) {
+                    return {};
+                }
+                if (flags.isConst()) {
+                    bool taken = evaluateCondition(j->cond, flags.dst.value, flags.src.value);
+                    if (taken) return {target};
+                    return block.fallthrough >= 0 ? std::vector<int>{block.fallthrough} : std::vector<int>{};
+                }
+            }
+            return block.succs;
+        }
+
+        const IRFunction& fn;
+        const CFG& cfg;
+        const LocationIndex& locations;
+        std::vector<LocationState> in;
+        std::vector<bool> visited;
+        std::set<std::pair<int, int>> executable;
+    };
+
+    // What rewriting folded, for the statistics.
+    struct Folds {
+        long constants = 0; // operands and instructions replaced by constants
+        long branches = 0;  // conditional jumps decided
+    };
+
+    // Replaces a register/pseudo read operand by its constant value.
+    static void foldOperand(IROperand& op, const Evaluator& eval, Folds& folds) {
+        if (op.isImm()) {
+            return;
+        }
+        LatticeValue v = eval.valueOf(op);
+        if (v.isConst()) {
+            op = IROperand::imm(v.value);
+            ++folds.constants;
+        }
+    }
+
+    // Rewrites one executable block using the solved entry state, appending the result to out.
+    static bool rewriteBlock(IRFunction& fn, const BasicBlock& block, const LocationIndex& locations,
+                             LocationState state, std::vector<IRInstruction>& out, Folds& folds) {
+        Folds before = folds;
+        Evaluator eval(locations, state);
+        for (size_t i = block.begin; i < block.end; ++i) {
+            auto& inst = fn.body[i];
+            std::optional<IRInstruction> replacement;
+            std::optional<IRInstruction> extra;
+
+            if (auto* m = std::get_if<IRMov>(&inst)) {
+                foldOperand(m->src, eval, folds);
+            } else if (auto* u = std::get_if<IRUnary>(&inst)) {
+                LatticeValue v = eval.valueOf(u->operand);
+                if (v.isConst()) {
+                    replacement = IRMov(IROperand::imm(foldUnary(u->op, v.value)), u->operand);
+                }
+            } else if (auto* b = std::get_if<IRBinary>(&inst)) {
+                LatticeValue v = Evaluator::binary(b->op, eval.valueOf(b->dst), eval.valueOf(b->src));
+                if (v.isConst()) {
+                    replacement = IRMov(IROperand::imm(v.value), b->dst);
+                } else {
+                    foldOperand(b->src, eval, folds);
+                }
+            } else if (auto* c = std::get_if<IRCmp>(&inst)) {
+                foldOperand(c->src, eval, folds);
+                foldOperand(c->dst, eval, folds);
+            } else if (auto* j = std::get_if<IRJumpCC>(&inst)) {
+                if (eval.flags.isConst()) {
+                    if (evaluateCondition(j->cond, eval.flags.dst.value, eval.flags.src.value)) {
+                        replacement = IRJump(j->target);
+                    } else {
+                        inst = IRNop{};
+                        ++folds.branches;
+                        continue;
+                    }
+                }
+            } else if (auto* s = std::get_if<IRSetCC>(&inst)) {
+                LatticeValue v = eval.setcc(*s);
+                if (v.isConst()) {
+                    replacement = IRMov(IROperand::imm(v.value), s->dst);
+                }
+            } else if (auto* c = std::get_if<IRCMov>(&inst)) {
+                LatticeValue v = eval.cmov(*c);
+                if (v.isConst()) {
+                    replacement = IRMov(IROperand::imm(v.value), c->dst);
+                } else if (eval.flags.isConst()) {
+                    if (!evaluateCondition(c->cond, eval.flags.dst.value, eval.flags.src.value)) {
+                        inst = IRNop{};
+                        ++folds.constants;
+                        continue;
+                    }
+                    replacement = IRMov(c->src, c->dst);
+                } else {
+                    foldOperand(c->src, eval, folds);
+                }
+            } else if (std::get_if<IRCdq>(&inst)) {
+                LatticeValue ax = eval.valueOf(IRRegister::AX);
+                if (ax.isConst()) {
+                    replacement = IRMov(IROperand::imm(ax.value < 0 ? -1 : 0), IROperand::reg(IRRegister::DX));
+                }
+            } else if (auto* d = std::get_if<IRIdiv>(&inst)) {
+                LatticeValue ax = eval.valueOf(IRRegister::AX);
+                LatticeValue dx = eval.valueOf(IRRegister::DX);
+                LatticeValue divisor = eval.valueOf(d->divisor);
+                int q = 0;
+                int r = 0;
+                if (ax.isConst() && dx.isConst() && divisor.isConst()
+                    && foldDivision(ax.value, dx.value, divisor.value, q, r)) {
+                    replacement = IRMov(IROperand::imm(q), IROperand::reg(IRRegister::AX));
+                    extra = IRMov(IROperand::imm(r), IROperand::reg(IRRegister::DX));
+                } else {
+                    foldOperand(d->divisor, eval, folds);
+                }
+            }
+
+            // Advance the lattice state with the original instruction.
+            eval.apply(inst);
+            if (replacement) {
+                out.push_back(*replacement);
+                if (std::get_if<IRJump>(&*replacement)) {
+                    ++folds.branches;
+                } else {
+                    ++folds.constants;
+                }
+            } else {
+                out.push_back(inst);
+            }
+            if (extra) {
+                out.push_back(*extra);
+            }
+        }
+        return folds.constants != before.constants || folds.branches != before.branches;
+    }
+
+    // Removes compares whose flags are never consumed in their block.
+    static bool removeDeadCompares(IRFunction& fn) {
+        bool changed = false;
+        bool flagsNeeded = false;
+        for (size_t i = fn.body.size(); i-- > 0;) {
+            auto& inst = fn.body[i];
+            if (std::get_if<IRLabel>(&inst) || isTerminator(inst)) {
+                // Flags never cross block boundaries.
+                flagsNeeded = readsFlags(inst);
+                continue;
+            }
+            if (std::get_if<IRCmp>(&inst) && !flagsNeeded) {
+                fn.body[i] = IRNop{};
+                changed = true;
+                continue;
+            }
+            if (writesFlags(inst)) {
+                flagsNeeded = false;
+            }
+            if (readsFlags(inst)) {
+                flagsNeeded = true;
+            }
+        }
+        eraseNops(fn);
+        return changed;
+    }
+
+    // Removes constant register writes that are overwritten before being read
+    // in the same block (left behind by folded divisions).
+    static bool removeDeadRegisterWrites(IRFunction& fn) {
+        bool changed = false;
+        std::vector<bool> live(kIRRegisterCount, true);
+        for (size_t i = fn.body.size(); i-- > 0;) {
+            auto& inst = fn.body[i];
+            if (std::get_if<IRLabel>(&inst) || isTerminator(inst)) {
+                std::fill(live.begin(), live.end(), true);
+            }
+            if (auto* m = std::get_if<IRMov>(&inst)) {
+                if (m->dst.isReg() && m->src.isImm() && !live[static_cast<int>(m->dst.asReg())]) {
+                    fn.body[i] = IRNop{};
+                    changed = true;
+                    continue;
+                }
+            }
+            forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+                if (op.isReg() && role == OperandRole::Write) live[static_cast<int>(op.asReg())] = false;
+            });
+            for (IRRegister r : implicitWrites(inst)) live[static_cast<int>(r)] = false;
+            forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+                if (op.isReg() && role != OperandRole::Write) live[static_cast<int>(op.asReg())] = true;
+            });
+            for (IRRegister r : implicitReads(inst)) live[static_cast<int>(r)] = true;
+        }
+        eraseNops(fn);
+        return changed;
+    }
+}
+
+bool SCCP::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool SCCP::run(IRFunction& fn, AnalysisManager& analyses) {
+    const CFG& cfg = analyses.cfg();
+    if (cfg.blocks.empty()) {
+        return false;
+    }
+    const LocationIndex& locations = analyses.locations();
+    Solver solver(fn, cfg, locations);
+    solver.solve();
+
+    OptimizationRemarks& remarks = analyses.remarks();
+    bool changed = false;
+    Folds folds;
+    std::vector<IRInstruction> body;
+    body.reserve(fn.body.size());
+    for (const auto& block : cfg.blocks) {
+        if (!solver.isExecutable(block.id)) {
+            changed = true;
+            continue;
+        }
+        long branches = folds.branches;
+        changed |= rewriteBlock(fn, block, locations, solver.entryState(block.id), body, folds);
+        if (folds.branches != branches && remarks.enabled()) {
+            int loop = analyses.loops().innermost[block.id];
+            int line = loop < 0 ? 0 : sourceLine(fn, cfg, analyses.loops().loops[loop]);
+            remarks.applied("BranchFolded", line, "the branch condition is always the same");
+        }
+    }
+    fn.body = std::move(body);
+    remarks.count("constants folded", folds.constants);
+    remarks.count("branches folded", folds.branches);
+
+    changed |= removeDeadCompares(fn);
+    changed |= removeJumpsToNext(fn);
+    changed |= removeUnusedPseudoDefinitions(fn);
+    changed |= removeDeadRegisterWrites(fn);
+    return changed;
+}
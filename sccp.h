@@ -0,0 +1,18 @@
+#ifndef COMPILER_SCCP_H
+#define COMPILER_SCCP_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class SCCP {
+public:
+    // Sparse conditional constant propagation. Propagates constants through
+    // pseudos and registers along executable CFG edges only, folds constant
+    // instructions and conditional jumps, and deletes unreachable blocks.
+    // Returns true if the function changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_SCCP_H
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "copy_propagation.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+size_t countMoves(const IRFunction& fn) {
+    size_t count = 0;
+    for (const auto& inst : fn.body) {
+        if (std::get_if<IRMov>(&inst) != nullptr) {
+            ++count;
+        }
+    }
+    return count;
+}
+}
+
+TEST(CopyPropagationTests, CoalescesTemporaryIntoAssignedVariable) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int i = 0;
+        while (i < 10)
+            i = i + 1;
+        return i;
+    })");
+
+    EXPECT_TRUE(CopyPropagation::run(*ir->function));
+
+    // `mov i, tmp; add $1, tmp; mov tmp, i` becomes a single in-place add.
+    bool sawInPlaceAdd = false;
+    for (const auto& inst : ir->function->body) {
+        auto* b = std::get_if<IRBinary>(&inst);
+        if (b == nullptr) continue;
+        ASSERT_TRUE(b->dst.isPseudo());
+        EXPECT_EQ(ir->function->pseudos[b->dst.asPseudo()].rfind("tmp.", 0), std::string::npos);
+        sawInPlaceAdd = true;
+    }
+    EXPECT_TRUE(sawInPlaceAdd);
+}
+
+TEST(CopyPropagationTests, ForwardsCopiesAndDropsDeadOnes) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 4;
+        int b = a;
+        int c = b;
+        return c * c;
+    })");
+    size_t before = countMoves(*ir->function);
+
+    CopyPropagation::run(*ir->function);
+
+    // Only the constant feeding the multiply and the return value remain.
+    EXPECT_LT(countMoves(*ir->function), before);
+    for (const auto& inst : ir->function->body) {
+        if (auto* b = std::get_if<IRBinary>(&inst)) {
+            EXPECT_EQ(b->src, IROperand::imm(4));
+        }
+    }
+}
+
+TEST(CopyPropagationTests, DoesNotForwardAcrossRedefinition) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 1;
+        int b = a;
+        int i = 0;
+        while (i < 3) {
+            a = a + b;
+            b = a;
+            i = i + 1;
+        }
+        return b;
+    })");
+
+    CopyPropagation::run(*ir->function);
+
+    // b is redefined inside the loop, so the return must still read a pseudo.
+    const auto& body = ir->function->body;
+    ASSERT_GE(body.size(), 2u);
+    auto* ret = std::get_if<IRMov>(&body[body.size() - 2]);
+    ASSERT_NE(ret, nullptr);
+    EXPECT_TRUE(ret->src.isPseudo());
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <climits>
+#include "cfg.h"
+#include "dataflow.h"
+
+namespace {
+// B0: mov $1, a; cmp $0, a; je L0
+// B1: mov $2, b; jmp L1
+// B2: L0: mov $3, b
+// B3: L1: add $1, a; cmp $10, a; jl L1
+// B4: mov b, %eax; ret
+IRFunction makeFunction() {
+    IROperand a = IROperand::pseudo(0);
+    IROperand b = IROperand::pseudo(1);
+    std::vector<IRInstruction> body;
+    body.push_back(IRMov(IROperand::imm(1), a));
+    body.push_back(IRCmp(IROperand::imm(0), a));
+    body.push_back(IRJumpCC(IRCondCode::E, 0));
+    body.push_back(IRMov(IROperand::imm(2), b));
+    body.push_back(IRJump(1));
+    body.push_back(IRLabel(0));
+    body.push_back(IRMov(IROperand::imm(3), b));
+    body.push_back(IRLabel(1));
+    body.push_back(IRBinary(IRBinaryOperator::Add, IROperand::imm(1), a));
+    body.push_back(IRCmp(IROperand::imm(10), a));
+    body.push_back(IRJumpCC(IRCondCode::L, 1));
+    body.push_back(IRMov(b, IROperand::reg(IRRegister::AX)));
+    body.push_back(IRRet());
+    return IRFunction("main", std::move(body), {"a", "b"}, 2);
+}
+
+// Fewest blocks entered before reaching each block: a lattice of integers
+// met by min, to exercise the solver on something other than bit vectors.
+struct DistanceProblem {
+    using Value = int;
+    DataflowDirection direction() const { return DataflowDirection::Forward; }
+    int boundary() const { return 0; }
+    int top() const { return INT_MAX; }
+    void meet(int& into, int other) const { into = std::min(into, other); }
+    bool transfer(int, int input, int& output) const {
+        int value = input == INT_MAX ? INT_MAX : input + 1;
+        bool changed = value != output;
+        output = value;
+        return changed;
+    }
+};
+}
+
+TEST(DataflowTests, ForwardIntersectionKeepsFactsHoldingOnEveryPath) {
+    IRFunction fn = makeFunction();
+    CFG cfg = CFG::build(fn);
+    ASSERT_EQ(cfg.blocks.size(), 5u);
+
+    // Fact 0 comes from the entry and dies in B2; fact 1 is made on both arms.
+    GenKillProblem problem(DataflowDirection::Forward, DataflowMeet::Intersection, cfg.blocks.size(), 2);
+    problem.gen(0).set(0);
+    problem.kill(2).set(0);
+    problem.gen(1).set(1);
+    problem.gen(2).set(1);
+    auto result = solveDataflow(cfg, problem);
+
+    EXPECT_EQ(result.in[0].count(), 0);
+    EXPECT_TRUE(result.in[1].test(0));
+    for (int block : {3, 4}) {
+        EXPECT_FALSE(result.in[block].test(0)) << "block " << block;
+        // The loop back edge must not make fact 1 look unavailable.
+        EXPECT_TRUE(result.in[block].test(1)) << "block " << block;
+    }
+}
+
+TEST(DataflowTests, BackwardUnionFlowsAgainstTheEdges) {
+    IRFunction fn = makeFunction();
+    CFG cfg = CFG::build(fn);
+
+    // Read in B4 and redefined in B1, like b.
+    GenKillProblem problem(DataflowDirection::Backward, DataflowMeet::Union, cfg.blocks.size(), 1);
+    problem.gen(4).set(0);
+    problem.kill(1).set(0);
+    auto result = solveDataflow(cfg, problem);
+
+    EXPECT_EQ(result.out[4].count(), 0);
+    EXPECT_TRUE(result.in[3].test(0));
+    EXPECT_TRUE(result.out[3].test(0));
+    EXPECT_FALSE(result.in[1].test(0));
+    EXPECT_TRUE(result.in[2].test(0));
+    EXPECT_TRUE(result.out[0].test(0));
+}
+
+TEST(DataflowTests, SolvesProblemsOverOtherLattices) {
+    IRFunction fn = makeFunction();
+    CFG cfg = CFG::build(fn);
+
+    auto result = solveDataflow(cfg, DistanceProblem{});
+
+    EXPECT_EQ(result.in[0], 0);
+    EXPECT_EQ(result.in[1], 1);
+    EXPECT_EQ(result.in[2], 1);
+    EXPECT_EQ(result.in[3], 2);
+    EXPECT_EQ(result.in[4], 3);
+}
+
+TEST(DataflowTests, BitVectorOperationsLeaveBitsPastTheSizeClear) {
+    BitVector all(70);
+    all.setAll();
+    EXPECT_EQ(all.count(), 70);
+
+    BitVector gen(70);
+    BitVector kill(70);
+    gen.set(69);
+    kill.set(0);
+    BitVector result(70);
+    EXPECT_TRUE(result.assignGenKill(all, gen, kill));
+    EXPECT_EQ(result.count(), 69);
+    EXPECT_FALSE(result.test(0));
+    EXPECT_FALSE(result.assignGenKill(all, gen, kill));
+    EXPECT_FALSE(result.intersectWith(all));
+    EXPECT_TRUE(result.intersectWith(gen));
+    EXPECT_EQ(result.count(), 1);
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "dead_code.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+template <typename T>
+size_t countInstructions(const IRFunction& fn) {
+    size_t count = 0;
+    for (const auto& inst : fn.body) {
+        if (std::holds_alternative<T>(inst)) {
+            ++count;
+        }
+    }
+    return count;
+}
+}
+
+TEST(DeadCodeTests, RemovesExpressionStatementWithoutEffects) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 2;
+        int b = 3;
+        a * b + a;
+        return a;
+    })");
+
+    EXPECT_TRUE(DeadCodeElimination::run(*ir->function));
+
+    EXPECT_EQ(countInstructions<IRBinary>(*ir->function), 0u);
+}
+
+TEST(DeadCodeTests, RemovesOverwrittenAssignment) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 2;
+        a = a * 7;
+        a = 5;
+        return a;
+    })");
+
+    DeadCodeElimination::run(*ir->function);
+
+    // Both the multiply and the initial store are dead once a = 5.
+    EXPECT_EQ(countInstructions<IRBinary>(*ir->function), 0u);
+    for (const auto& inst : ir->function->body) {
+        if (auto* m = std::get_if<IRMov>(&inst)) {
+            EXPECT_TRUE(!m->src.isImm() || m->src.asImm() == 5);
+        }
+    }
+}
+
+TEST(DeadCodeTests, KeepsDivisionThatMayTrapAndLoopCarriedValues) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int x = 10;
+        int y = 0;
+        int sum = 0;
+        for (int i = 0; i < 3; i = i + 1)
+            sum = sum + i;
+        x / y;
+        return sum;
+    })");
+
+    DeadCodeElimination::run(*ir->function);
+
+    EXPECT_EQ(countInstructions<IRIdiv>(*ir->function), 1u);
+    EXPECT_GE(countInstructions<IRBinary>(*ir->function), 2u);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include "def_use.h"
+
+namespace {
+// mov $1, a; mov a, b; add a, b; mov b, %eax; ret
+IRFunction makeFunction() {
+    std::vector<IRInstruction> body;
+    IROperand a = IROperand::pseudo(0);
+    IROperand b = IROperand::pseudo(1);
+    body.push_back(IRMov(IROperand::imm(1), a));
+    body.push_back(IRMov(a, b));
+    body.push_back(IRBinary(IRBinaryOperator::Add, a, b));
+    body.push_back(IRMov(b, IROperand::reg(IRRegister::AX)));
+    body.push_back(IRRet());
+    return IRFunction("main", std::move(body), {"a", "b"});
+}
+}
+
+TEST(DefUseTests, InPlaceUpdatesAreDefinitions) {
+    IRFunction fn = makeFunction();
+    auto chains = DefUseChains::build(fn);
+
+    EXPECT_EQ(chains.uses(0).size(), 2u);
+    EXPECT_EQ(chains.defs(0).size(), 1u);
+    EXPECT_EQ(chains.uses(1).size(), 1u);
+    EXPECT_EQ(chains.defs(1).size(), 2u);
+    EXPECT_EQ(chains.uses(1)[0].inst, 3u);
+    EXPECT_EQ(chains.operand(chains.uses(1)[0]), IROperand::pseudo(1));
+}
+
+TEST(DefUseTests, ReplaceAllUsesMovesReadsToTheNewValue) {
+    IRFunction fn = makeFunction();
+    auto chains = DefUseChains::build(fn);
+
+    chains.replaceAllUses(IROperand::pseudo(0), IROperand::imm(7));
+
+    EXPECT_TRUE(chains.uses(0).empty());
+    EXPECT_EQ(chains.defs(0).size(), 1u);
+    EXPECT_EQ(std::get_if<IRMov>(&fn.body[1])->src, IROperand::imm(7));
+    EXPECT_EQ(std::get_if<IRBinary>(&fn.body[2])->src, IROperand::imm(7));
+
+    chains.replaceAllUses(IROperand::pseudo(1), IROperand::pseudo(0));
+    EXPECT_EQ(std::get_if<IRMov>(&fn.body[3])->src, IROperand::pseudo(0));
+    EXPECT_EQ(chains.uses(0).size(), 1u);
+    EXPECT_TRUE(chains.uses(1).empty());
+}
+
+TEST(DefUseTests, ErasingTheLastUseCascadesThroughDefinitions) {
+    IRFunction fn = makeFunction();
+    auto chains = DefUseChains::build(fn);
+
+    chains.replace(3, IRMov(IROperand::imm(0), IROperand::reg(IRRegister::AX)));
+    EXPECT_TRUE(chains.eraseUnusedDefinitions({1}));
+
+    for (size_t i = 0; i < 3; ++i) EXPECT_TRUE(isNop(fn.body[i])) << i;
+    EXPECT_TRUE(chains.uses(0).empty());
+    EXPECT_TRUE(chains.defs(0).empty());
+    EXPECT_TRUE(chains.defs(1).empty());
+    EXPECT_FALSE(chains.eraseUnusedDefinitions({0, 1}));
+}
+
+TEST(DefUseTests, InsertShiftsLaterReferences) {
+    IRFunction fn = makeFunction();
+    auto chains = DefUseChains::build(fn);
+
+    chains.insert(1, IRUnary(IRUnaryOperator::Neg, IROperand::pseudo(0)));
+
+    ASSERT_EQ(fn.body.size(), 6u);
+    EXPECT_EQ(chains.defs(0).size(), 2u);
+    for (const auto& ref : chains.uses(0)) {
+        EXPECT_EQ(chains.operand(ref), IROperand::pseudo(0));
+        EXPECT_GE(ref.inst, 2u);
+    }
+    for (const auto& ref : chains.defs(1)) {
+        EXPECT_EQ(chains.operand(ref), IROperand::pseudo(1));
+    }
+    chains.erase(1);
+    EXPECT_EQ(chains.defs(0).size(), 1u);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "frame_layout.h"
+#include "ir_utils.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+int frameSize(const IRFunction& fn) {
+    auto* a = fn.body.empty() ? nullptr : std::get_if<IRAllocateStack>(&fn.body.front());
+    return a ? a->amount : 0;
+}
+
+std::vector<int> slotsUsed(const IRFunction& fn) {
+    std::vector<int> offsets;
+    for (const auto& inst : fn.body) {
+        forEachOperand(inst, [&](const IROperand& op, OperandRole) {
+            if (op.isStack() && std::find(offsets.begin(), offsets.end(), op.asStack()) == offsets.end()) {
+                offsets.push_back(op.asStack());
+            }
+        });
+    }
+    return offsets;
+}
+}
+
+TEST(FrameLayoutTests, ReplacesEveryPseudoWithAnAlignedStackSlot) {
+    auto program = lowerProgram(R"(int main(void) {
+        int a = 5;
+        int b = a * 3;
+        return a + b;
+    })");
+    auto& fn = *program->function;
+
+    EXPECT_TRUE(FrameLayout::run(fn));
+
+    for (const auto& inst : fn.body) {
+        forEachOperand(inst, [](const IROperand& op, OperandRole) { EXPECT_FALSE(op.isPseudo()); });
+    }
+    auto offsets = slotsUsed(fn);
+    ASSERT_FALSE(offsets.empty());
+    for (int offset : offsets) {
+        EXPECT_LT(offset, 0);
+        EXPECT_EQ(offset % 4, 0);
+        EXPECT_GE(offset, -frameSize(fn));
+    }
+    EXPECT_EQ(frameSize(fn) % 16, 0);
+}
+
+TEST(FrameLayoutTests, TemporariesWithDisjointLifetimesShareSlots) {
+    // Each statement's temporaries die before the next statement starts.
+    std::string source = "int main(void) {\nint s = 0;\n";
+    for (int i = 0; i < 50; ++i) source += "s = s + (s * " + std::to_string(i) + " - 1) * 2;\n";
+    source += "return s;\n}";
+    auto program = lowerProgram(source);
+    auto& fn = *program->function;
+
+    FrameLayout::run(fn);
+
+    EXPECT_LE(slotsUsed(fn).size(), 4u);
+    EXPECT_LE(frameSize(fn), 16);
+}
+
+TEST(FrameLayoutTests, ValuesLiveAtTheSameTimeGetDistinctSlots) {
+    auto program = lowerProgram(R"(int main(void) {
+        int a = 1;
+        int b = 2;
+        int c = 3;
+        for (int i = 0; i < 10; i = i + 1) {
+            a = a + b;
+            b = b + c;
+            c = c + i;
+        }
+        return a + b + c;
+    })");
+    auto& fn = *program->function;
+
+    FrameLayout::run(fn);
+
+    EXPECT_GE(slotsUsed(fn).size(), 4u);
+}
+
+TEST(FrameLayoutTests, LeavesFunctionsWithoutPseudosAlone) {
+    auto program = lowerProgram("int main(void) { return 3; }");
+    auto& fn = *program->function;
+    size_t before = fn.body.size();
+
+    EXPECT_FALSE(FrameLayout::run(fn));
+
+    EXPECT_EQ(fn.body.size(), before);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "cfg.h"
+#include "codegen.h"
+#include "graph_coloring.h"
+#include "ir_utils.h"
+#include "loops.h"
+#include "register_allocation.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+size_t countPseudos(const IRFunction& fn, bool insideLoopsOnly) {
+    CFG cfg = CFG::build(fn);
+    auto forest = LoopForest::build(cfg, Dominators::compute(cfg));
+    size_t count = 0;
+    for (const auto& block : cfg.blocks) {
+        if (insideLoopsOnly && forest.innermost[block.id] < 0) continue;
+        for (size_t i = block.begin; i < block.end; ++i) {
+            forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole) {
+                if (op.isPseudo()) ++count;
+            });
+        }
+    }
+    return count;
+}
+
+bool usesCalleeSavedRegister(const IRFunction& fn) {
+    bool found = false;
+    for (const auto& inst : fn.body) {
+        forEachOperand(inst, [&](const IROperand& op, OperandRole) {
+            found = found || (op.isReg() && isCalleeSaved(op.asReg()));
+        });
+    }
+    return found;
+}
+
+// `count` variables that all stay live until the final sum.
+std::string manyLiveValues(int count, const std::string& loop) {
+    std::string source = "int main(void) {\n";
+    for (int i = 0; i < count; ++i) {
+        source += "int a" + std::to_string(i) + " = " + std::to_string(i * 7 + 1) + ";\n";
+    }
+    source += loop + "return s";
+    for (int i = 0; i < count; ++i) source += " + a" + std::to_string(i);
+    return source + ";\n}";
+}
+}
+
+TEST(GraphColoringTests, AssignsEveryPseudoOfASmallFunctionToCallerSavedRegisters) {
+    auto program = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 10; i = i + 1)
+            s = s + i * i;
+        return s / 3;
+    })");
+    auto& fn = *program->function;
+
+    EXPECT_TRUE(GraphColoringAllocator::run(fn));
+
+    EXPECT_EQ(countPseudos(fn, false), 0u);
+    EXPECT_FALSE(usesCalleeSavedRegister(fn));
+}
+
+TEST(GraphColoringTests, CoalescesTheReturnValueIntoAX) {
+    auto program = lowerProgram(R"(int main(void) {
+        int a = 6;
+        int b = a * 7;
+        return b;
+    })");
+    auto& fn = *program->function;
+
+    GraphColoringAllocator::run(fn);
+
+    ASSERT_GE(fn.body.size(), 2u);
+    ASSERT_TRUE(std::get_if<IRRet>(&fn.body.back()));
+    auto* last = std::get_if<IRMov>(&fn.body[fn.body.size() - 2]);
+    // The product is computed in %eax rather than copied there.
+    EXPECT_TRUE(last == nullptr || last->src.isImm());
+}
+
+TEST(GraphColoringTests, SpillsValuesOutsideLoopsBeforeLoopCarriedOnes) {
+    auto program = lowerProgram(manyLiveValues(16, R"(
+        int s = 0;
+        for (int i = 0; i < 100; i = i + 1)
+            s = s + i;
+    )"));
+    auto& fn = *program->function;
+
+    GraphColoringAllocator::run(fn);
+
+    EXPECT_GT(countPseudos(fn, false), 0u);
+    EXPECT_EQ(countPseudos(fn, true), 0u);
+}
+
+TEST(GraphColoringTests, CodegenPreservesCalleeSavedRegisters) {
+    auto program = lowerProgram(manyLiveValues(10, "int s = 0;\n"));
+    auto& fn = *program->function;
+
+    GraphColoringAllocator::run(fn);
+    ASSERT_TRUE(usesCalleeSavedRegister(fn));
+    std::string assembly = CodeGenerator::generate(*program);
+
+    EXPECT_NE(assembly.find("pushq %rbx"), std::string::npos);
+    EXPECT_NE(assembly.find("popq %rbx"), std::string::npos);
+    EXPECT_EQ(assembly.find("(%rbp)"), std::string::npos);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "cfg.h"
+#include "copy_propagation.h"
+#include "induction_variables.h"
+#include "loops.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    auto ir = Lowering::toIR(*resolved);
+    while (CopyPropagation::run(*ir->function)) {
+    }
+    return ir;
+}
+
+size_t countInLoops(const IRFunction& fn, IRBinaryOperator op) {
+    CFG cfg = CFG::build(fn);
+    auto forest = LoopForest::build(cfg, Dominators::compute(cfg));
+    size_t count = 0;
+    for (const auto& block : cfg.blocks) {
+        if (forest.innermost[block.id] < 0) continue;
+        for (size_t i = block.begin; i < block.end; ++i) {
+            auto* b = std::get_if<IRBinary>(&fn.body[i]);
+            if (b != nullptr && b->op == op) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+}
+
+TEST(InductionVariablesTests, ReducesMultiplicationByConstant) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 100; i = i + 1)
+            s = s + i * 7;
+        return s;
+    })");
+    ASSERT_EQ(countInLoops(*ir->function, IRBinaryOperator::Mul), 1u);
+
+    EXPECT_TRUE(InductionVariables::run(*ir->function));
+
+    EXPECT_EQ(countInLoops(*ir->function, IRBinaryOperator::Mul), 0u);
+}
+
+TEST(InductionVariablesTests, ReplacesExitTestAndDropsOriginalCounter) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 100; i = i + 1)
+            s = s + i * 7;
+        return s;
+    })");
+
+    InductionVariables::run(*ir->function);
+
+    // Only `s += iv` and `iv += 7` remain; the test compares iv with 700.
+    EXPECT_EQ(countInLoops(*ir->function, IRBinaryOperator::Add), 2u);
+    bool sawScaledBound = false;
+    for (const auto& inst : ir->function->body) {
+        if (auto* c = std::get_if<IRCmp>(&inst)) {
+            sawScaledBound |= c->src == IROperand::imm(700);
+        }
+    }
+    EXPECT_TRUE(sawScaledBound);
+}
+
+TEST(InductionVariablesTests, ReducesMultiplicationByInvariantPseudo) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int k = 0;
+        for (int j = 0; j < 3; j = j + 1)
+            k = k + j;
+        int s = 0;
+        for (int i = 0; i < 100; i = i + 2)
+            s = s + k * i;
+        return s;
+    })");
+
+    InductionVariables::run(*ir->function);
+
+    EXPECT_EQ(countInLoops(*ir->function, IRBinaryOperator::Mul), 0u);
+}
+
+TEST(InductionVariablesTests, KeepsCounterThatIsUsedElsewhere) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        int i = 0;
+        while (i < 50) {
+            s = s + i * 3 + i;
+            i = i + 1;
+        }
+        return s + i;
+    })");
+
+    InductionVariables::run(*ir->function);
+
+    EXPECT_EQ(countInLoops(*ir->function, IRBinaryOperator::Mul), 0u);
+    // i still feeds the sum, so its update stays alongside the reduced IV's.
+    EXPECT_GE(countInLoops(*ir->function, IRBinaryOperator::Add), 3u);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "cfg.h"
+#include "licm.h"
+#include "loops.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+// Counts instructions of type T inside any loop.
+template <typename T>
+size_t countInLoops(const IRFunction& fn) {
+    CFG cfg = CFG::build(fn);
+    auto forest = LoopForest::build(cfg, Dominators::compute(cfg));
+    size_t count = 0;
+    for (const auto& block : cfg.blocks) {
+        if (forest.innermost[block.id] < 0) continue;
+        for (size_t i = block.begin; i < block.end; ++i) {
+            if (std::holds_alternative<T>(fn.body[i])) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+}
+
+TEST(LicmTests, HoistsInvariantArithmeticOutOfLoop) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 3;
+        int b = 4;
+        int s = 0;
+        for (int i = 0; i < 10; i = i + 1) {
+            s = s + a * b;
+        }
+        return s;
+    })");
+    ASSERT_EQ(countInLoops<IRBinary>(*ir->function), 3u);
+
+    EXPECT_TRUE(LoopInvariantCodeMotion::run(*ir->function));
+
+    // Only the updates of s and i remain in the loop.
+    EXPECT_EQ(countInLoops<IRBinary>(*ir->function), 2u);
+}
+
+TEST(LicmTests, HoistsInvariantConditionTogetherWithItsComparison) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int n = 5;
+        int m = 7;
+        int s = 0;
+        int i = 0;
+        while (i < 10) {
+            int flag = n < m;
+            s = s + flag;
+            i = i + 1;
+        }
+        return s;
+    })");
+    ASSERT_EQ(countInLoops<IRSetCC>(*ir->function), 1u);
+
+    LoopInvariantCodeMotion::run(*ir->function);
+
+    EXPECT_EQ(countInLoops<IRSetCC>(*ir->function), 0u);
+}
+
+TEST(LicmTests, HoistsDivisionOnlyWhenItCannotTrap) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 100;
+        int d = 0;
+        int s = 0;
+        for (int i = 0; i < 10; i = i + 1) {
+            s = s + a / 7;
+            if (d != 0)
+                s = s + a / d;
+        }
+        return s;
+    })");
+    ASSERT_EQ(countInLoops<IRIdiv>(*ir->function), 2u);
+
+    LoopInvariantCodeMotion::run(*ir->function);
+
+    // a / 7 moves out; a / d stays guarded by its condition.
+    EXPECT_EQ(countInLoops<IRIdiv>(*ir->function), 1u);
+}
+
+TEST(LicmTests, KeepsValuesModifiedInTheLoop) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 3;
+        int s = 0;
+        for (int i = 0; i < 10; i = i + 1) {
+            s = s + a * 2;
+            a = a + 1;
+        }
+        return s;
+    })");
+
+    EXPECT_FALSE(LoopInvariantCodeMotion::run(*ir->function));
+}
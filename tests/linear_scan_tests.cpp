@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "cfg.h"
+#include "ir_utils.h"
+#include "linear_scan.h"
+#include "loops.h"
+#include "register_allocation.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+size_t countPseudos(const IRFunction& fn) {
+    size_t count = 0;
+    for (const auto& inst : fn.body) {
+        forEachOperand(inst, [&](const IROperand& op, OperandRole) {
+            if (op.isPseudo()) ++count;
+        });
+    }
+    return count;
+}
+
+std::vector<IRRegister> registersUsed(const IRFunction& fn) {
+    std::vector<IRRegister> used;
+    for (const auto& inst : fn.body) {
+        forEachOperand(inst, [&](const IROperand& op, OperandRole) {
+            if (op.isReg() && std::find(used.begin(), used.end(), op.asReg()) == used.end()) used.push_back(op.asReg());
+        });
+    }
+    return used;
+}
+}
+
+TEST(LinearScanTests, AssignsEveryPseudoOfASmallFunction) {
+    auto program = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 10; i = i + 1)
+            s = s + i * i;
+        return s / 3;
+    })");
+    auto& fn = *program->function;
+
+    EXPECT_TRUE(LinearScanAllocator::run(fn));
+
+    EXPECT_EQ(countPseudos(fn), 0u);
+    for (IRRegister r : registersUsed(fn)) EXPECT_FALSE(isCalleeSaved(r));
+}
+
+TEST(LinearScanTests, ReusesRegistersOfValuesThatDied) {
+    // Forty short-lived temporaries fit in a handful of registers.
+    std::string source = "int main(void) {\nint s = 0;\n";
+    for (int i = 0; i < 40; ++i) source += "s = s + " + std::to_string(i) + " * 3;\n";
+    source += "return s;\n}";
+    auto program = lowerProgram(source);
+    auto& fn = *program->function;
+
+    LinearScanAllocator::run(fn);
+
+    EXPECT_EQ(countPseudos(fn), 0u);
+    EXPECT_LE(registersUsed(fn).size(), 4u);
+}
+
+TEST(LinearScanTests, KeepsValuesLiveAcrossTheLoopApart) {
+    // Every variable is live around the back edge, so all need distinct registers.
+    auto program = lowerProgram(R"(int main(void) {
+        int a = 1;
+        int b = 2;
+        int c = 3;
+        for (int i = 0; i < 10; i = i + 1) {
+            a = a + b;
+            b = b + c;
+            c = c + i;
+        }
+        return a + b + c;
+    })");
+    auto& fn = *program->function;
+
+    LinearScanAllocator::run(fn);
+
+    EXPECT_EQ(countPseudos(fn), 0u);
+    EXPECT_GE(registersUsed(fn).size(), 4u);
+}
+
+TEST(LinearScanTests, LeavesIntervalsEndingLastInMemoryUnderPressure) {
+    std::string source = "int main(void) {\n";
+    for (int i = 0; i < 16; ++i) source += "int a" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+    source += "return a0";
+    for (int i = 1; i < 16; ++i) source += " + a" + std::to_string(i);
+    source += ";\n}";
+    auto program = lowerProgram(source);
+    auto& fn = *program->function;
+
+    LinearScanAllocator::run(fn);
+
+    EXPECT_GT(countPseudos(fn), 0u);
+    EXPECT_EQ(registersUsed(fn).size(), allocatableRegisters().size());
+}
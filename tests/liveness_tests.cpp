@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "cfg.h"
+#include "liveness.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+}
+
+TEST(LivenessTests, NothingIsLiveAtEntryOfStraightLineProgram) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 1;
+        int b = a + 2;
+        return b;
+    })");
+    const auto& fn = *ir->function;
+    CFG cfg = CFG::build(fn);
+    LocationIndex locations(fn);
+    auto liveness = Liveness::compute(fn, cfg, locations);
+
+    int liveAtEntry = 0;
+    liveness.forEachLiveIn(0, [&](int) { ++liveAtEntry; });
+    EXPECT_EQ(liveAtEntry, 0);
+    // The return value register is live right before `ret`.
+    bool checkedRet = false;
+    liveness.forEachInstructionBackward(0, [&](size_t i, const BitVector& liveAfter) {
+        if (i + 2 == fn.body.size()) {
+            EXPECT_TRUE(liveAfter.test(locations.reg(IRRegister::AX)));
+            checkedRet = true;
+        }
+    });
+    EXPECT_TRUE(checkedRet);
+}
+
+TEST(LivenessTests, LoopCarriedVariableIsLiveAroundTheLoop) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int i = 0;
+        int unused = 5;
+        while (i < 10)
+            i = i + 1;
+        return i;
+    })");
+    const auto& fn = *ir->function;
+    CFG cfg = CFG::build(fn);
+    LocationIndex locations(fn);
+    auto liveness = Liveness::compute(fn, cfg, locations);
+
+    // Resolver names are unique per process, so find the variables by their initializers.
+    int i = -1;
+    int unused = -1;
+    for (const auto& inst : fn.body) {
+        auto* m = std::get_if<IRMov>(&inst);
+        if (m && m->src == IROperand::imm(0) && i < 0) i = locations.find(m->dst);
+        if (m && m->src == IROperand::imm(5)) unused = locations.find(m->dst);
+    }
+    ASSERT_GE(i, 0);
+    ASSERT_GE(unused, 0);
+    for (const auto& block : cfg.blocks) {
+        if (block.id == 0) continue;
+        EXPECT_TRUE(liveness.isLiveIn(block.id, i)) << "block " << block.id;
+        EXPECT_FALSE(liveness.isLiveIn(block.id, unused)) << "block " << block.id;
+    }
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "cfg.h"
+#include "copy_propagation.h"
+#include "loop_unrolling.h"
+#include "loops.h"
+#include "unreachable.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    auto ir = Lowering::toIR(*resolved);
+    while (CopyPropagation::run(*ir->function)) {
+    }
+    UnreachableCodeElimination::run(*ir->function);
+    return ir;
+}
+
+size_t countLoops(const IRFunction& fn) {
+    CFG cfg = CFG::build(fn);
+    return LoopForest::build(cfg, Dominators::compute(cfg)).loops.size();
+}
+
+template <typename T>
+size_t count(const IRFunction& fn) {
+    size_t n = 0;
+    for (const auto& inst : fn.body) {
+        if (std::holds_alternative<T>(inst)) ++n;
+    }
+    return n;
+}
+
+// Squares do not form an add-recurrence, so these loops survive scalar evolution.
+const char* kConstantTrips = R"(int main(void) {
+    int s = 0;
+    for (int i = 0; i < 10; i = i + 1)
+        s = s + i * i;
+    return s;
+})";
+}
+
+TEST(LoopUnrollingTests, UnrollsSmallConstantLoopsFully) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 4; i = i + 1)
+            s = s + i * i;
+        return s;
+    })");
+
+    EXPECT_TRUE(LoopUnrolling::run(*ir->function));
+
+    EXPECT_EQ(countLoops(*ir->function), 0u);
+    EXPECT_EQ(count<IRJumpCC>(*ir->function), 1u); // the guard
+}
+
+TEST(LoopUnrollingTests, PeelsRemainderOfConstantTripCount) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 30; i = i + 1)
+            s = s + i * i;
+        return s;
+    })");
+
+    EXPECT_TRUE(LoopUnrolling::run(*ir->function, 4));
+
+    // 30 = 2 + 7*4: two peeled iterations, then a loop over four copies with one test.
+    EXPECT_EQ(countLoops(*ir->function), 1u);
+    EXPECT_EQ(count<IRJumpCC>(*ir->function), 2u);
+    size_t multiplies = 0;
+    for (const auto& inst : ir->function->body) {
+        auto* b = std::get_if<IRBinary>(&inst);
+        if (b && b->op == IRBinaryOperator::Mul) ++multiplies;
+    }
+    EXPECT_EQ(multiplies, 6u);
+}
+
+TEST(LoopUnrollingTests, RunsLeftoverIterationsOfUnknownCountInRemainderLoop) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int n = 0;
+        int k = 1;
+        while (k < 1000) {
+            k = k * 3;
+            n = n + 5;
+        }
+        int s = 0;
+        for (int i = 0; i < n; i = i + 1)
+            s = s + i * i;
+        return s;
+    })");
+    size_t before = countLoops(*ir->function);
+
+    EXPECT_TRUE(LoopUnrolling::run(*ir->function, 2));
+
+    // The counted loop became the unrolled loop plus its remainder loop;
+    // the geometric one has no counter and stays.
+    EXPECT_EQ(countLoops(*ir->function), before + 1);
+}
+
+TEST(LoopUnrollingTests, FactorBelowTwoDisablesUnrolling) {
+    auto ir = lowerProgram(kConstantTrips);
+
+    EXPECT_FALSE(LoopUnrolling::run(*ir->function, 1));
+    EXPECT_EQ(countLoops(*ir->function), 1u);
+}
+
+TEST(LoopUnrollingTests, PragmaOverridesFactor) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+#pragma unroll 10
+        for (int i = 0; i < 10; i = i + 1)
+            s = s + i * i;
+        return s;
+    })");
+
+    EXPECT_TRUE(LoopUnrolling::run(*ir->function, 0));
+    EXPECT_EQ(countLoops(*ir->function), 0u);
+}
+
+TEST(LoopUnrollingTests, PragmaOneKeepsLoop) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        #pragma GCC unroll 1
+        for (int i = 0; i < 2; i = i + 1)
+            s = s + i * i;
+        return s;
+    })");
+
+    EXPECT_FALSE(LoopUnrolling::run(*ir->function));
+}
+
+TEST(LoopUnrollingTests, KeepsLoopsWithoutCountedExit) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int x = 27;
+        int steps = 0;
+        while (x != 1) {
+            if (x % 2 == 0) x = x / 2;
+            else x = 3 * x + 1;
+            steps = steps + 1;
+        }
+        return steps;
+    })");
+
+    EXPECT_FALSE(LoopUnrolling::run(*ir->function));
+}
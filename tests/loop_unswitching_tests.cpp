@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "cfg.h"
+#include "copy_propagation.h"
+#include "licm.h"
+#include "loop_unswitching.h"
+#include "loops.h"
+#include "unreachable.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    auto ir = Lowering::toIR(*resolved);
+    while (CopyPropagation::run(*ir->function)) {
+    }
+    UnreachableCodeElimination::run(*ir->function);
+    return ir;
+}
+
+// Conditional branches inside loops.
+size_t countBranchesInLoops(const IRFunction& fn) {
+    CFG cfg = CFG::build(fn);
+    auto forest = LoopForest::build(cfg, Dominators::compute(cfg));
+    size_t count = 0;
+    for (const auto& block : cfg.blocks) {
+        if (forest.innermost[block.id] < 0) continue;
+        for (size_t i = block.begin; i < block.end; ++i) {
+            if (std::get_if<IRJumpCC>(&fn.body[i])) ++count;
+        }
+    }
+    return count;
+}
+
+size_t countLoops(const IRFunction& fn) {
+    CFG cfg = CFG::build(fn);
+    return LoopForest::build(cfg, Dominators::compute(cfg)).loops.size();
+}
+
+// `mode` comes out of a loop, so constant propagation cannot settle the test.
+// The division keeps the if a branch rather than a cmov.
+const char* kModeLoop = R"(int main(void) {
+    int mode = 0;
+    int k = 1;
+    while (k < 1000) {
+        k = k * 3;
+        mode = mode + 1;
+    }
+    int s = 0;
+    for (int i = 0; i < 100; i = i + 1) {
+        if (mode == 7)
+            s = s + i / 3;
+        else
+            s = s - i;
+    }
+    return s;
+})";
+}
+
+TEST(LoopUnswitchingTests, HoistsInvariantTestOutOfLoop) {
+    auto ir = lowerProgram(kModeLoop);
+    LoopInvariantCodeMotion::run(*ir->function);
+    ASSERT_EQ(countLoops(*ir->function), 2u);
+    ASSERT_EQ(countBranchesInLoops(*ir->function), 3u);
+
+    EXPECT_TRUE(LoopUnswitching::run(*ir->function));
+
+    // The first loop's test, and one exit test in each version of the second.
+    EXPECT_EQ(countLoops(*ir->function), 3u);
+    EXPECT_EQ(countBranchesInLoops(*ir->function), 3u);
+}
+
+TEST(LoopUnswitchingTests, UnswitchesComparisonOfInvariantOperands) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int mode = 0;
+        int k = 1;
+        while (k < 1000) {
+            k = k * 3;
+            mode = mode + 1;
+        }
+        int s = 0;
+        int i = 0;
+        do {
+            if (mode > 3) s = s + 2;
+            i = i + 1;
+        } while (i < 10);
+        return s;
+    })");
+    LoopInvariantCodeMotion::run(*ir->function);
+
+    EXPECT_TRUE(LoopUnswitching::run(*ir->function));
+    EXPECT_EQ(countLoops(*ir->function), 3u);
+}
+
+TEST(LoopUnswitchingTests, UnswitchesSelectsOnInvariantConditions) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int mode = 0;
+        int k = 1;
+        while (k < 1000) {
+            k = k * 3;
+            mode = mode + 1;
+        }
+        int s = 0;
+        for (int i = 0; i < 100; i = i + 1) {
+            if (mode == 7) s = s + i;
+            else s = s - i;
+        }
+        return s;
+    })");
+    LoopInvariantCodeMotion::run(*ir->function);
+    auto countSelects = [&] {
+        size_t count = 0;
+        for (const auto& inst : ir->function->body) count += std::holds_alternative<IRCMov>(inst);
+        return count;
+    };
+    ASSERT_EQ(countSelects(), 1u);
+
+    EXPECT_TRUE(LoopUnswitching::run(*ir->function));
+
+    // One copy moves unconditionally, the other not at all.
+    EXPECT_EQ(countLoops(*ir->function), 3u);
+    EXPECT_EQ(countSelects(), 0u);
+}
+
+TEST(LoopUnswitchingTests, KeepsBranchesOnValuesTheLoopChanges) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 100; i = i + 1) {
+            if (s > 50) s = s - i;
+            else s = s + i;
+        }
+        return s;
+    })");
+
+    EXPECT_FALSE(LoopUnswitching::run(*ir->function));
+}
+
+TEST(LoopUnswitchingTests, RespectsLoopSizeLimit) {
+    std::string body;
+    for (int i = 0; i < 80; ++i) body += "s = s * 3 + i;\n";
+    auto ir = lowerProgram(R"(int main(void) {
+        int mode = 0;
+        int k = 1;
+        while (k < 1000) {
+            k = k * 3;
+            mode = mode + 1;
+        }
+        int s = 0;
+        for (int i = 0; i < 100; i = i + 1) {
+            if (mode == 7) s = s + 1;
+            )" + body + R"(
+        }
+        return s;
+    })");
+    LoopInvariantCodeMotion::run(*ir->function);
+
+    EXPECT_FALSE(LoopUnswitching::run(*ir->function));
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "cfg.h"
+#include "loops.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+}
+
+TEST(LoopsTests, EntryDominatesEveryReachableBlock) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 0;
+        if (a) a = 1; else a = 2;
+        return a;
+    })");
+    CFG cfg = CFG::build(*ir->function);
+    auto dominators = Dominators::compute(cfg);
+    auto reachable = cfg.reachable();
+
+    for (const auto& block : cfg.blocks) {
+        if (reachable[block.id]) {
+            EXPECT_TRUE(dominators.dominates(0, block.id));
+        }
+    }
+    EXPECT_TRUE(LoopForest::build(cfg, dominators).loops.empty());
+}
+
+TEST(LoopsTests, BuildsNestedLoopForest) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 4; i = i + 1) {
+            int j = 0;
+            while (j < i) {
+                s = s + j;
+                j = j + 1;
+            }
+        }
+        do {
+            s = s - 1;
+        } while (s > 10);
+        return s;
+    })");
+    CFG cfg = CFG::build(*ir->function);
+    auto forest = LoopForest::build(cfg, Dominators::compute(cfg));
+
+    ASSERT_EQ(forest.loops.size(), 3u);
+    int outermost = 0;
+    int nested = 0;
+    for (const auto& loop : forest.loops) {
+        if (loop.parent < 0) {
+            ++outermost;
+            EXPECT_EQ(loop.depth, 1);
+        } else {
+            ++nested;
+            EXPECT_EQ(loop.depth, 2);
+            const auto& parent = forest.loops[loop.parent];
+            for (int block : loop.blocks) {
+                EXPECT_TRUE(parent.contains(block));
+            }
+        }
+        EXPECT_FALSE(loop.latches.empty());
+        EXPECT_FALSE(loop.exits.empty());
+    }
+    EXPECT_EQ(outermost, 2);
+    EXPECT_EQ(nested, 1);
+    // Inner loops come first.
+    EXPECT_EQ(forest.loops[forest.innermostFirst().front()].depth, 2);
+}
@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+template <typename T>
+size_t countInstructions(const IRFunction& fn) {
+    size_t count = 0;
+    for (const auto& inst : fn.body) {
+        if (std::holds_alternative<T>(inst)) {
+            ++count;
+        }
+    }
+    return count;
+}
+}
+
+TEST(LoweringTests, WhileLoopIsGuardedAndBottomTested) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int i = 0;
+        while (i < 10)
+            i = i + 1;
+        return i;
+    })");
+    const auto& body = ir->function->body;
+
+    // Guard `jge break`, then a single `jl body` per iteration and no jmp.
+    EXPECT_EQ(countInstructions<IRJump>(*ir->function), 0u);
+    ASSERT_EQ(countInstructions<IRJumpCC>(*ir->function), 2u);
+    std::vector<IRCondCode> conds;
+    for (const auto& inst : body) {
+        if (auto* j = std::get_if<IRJumpCC>(&inst)) conds.push_back(j->cond);
+    }
+    EXPECT_EQ(conds, (std::vector<IRCondCode>{IRCondCode::GE, IRCondCode::L}));
+}
+
+TEST(LoweringTests, ForLoopContinueRunsPostBeforeBottomTest) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 10; i = i + 1) {
+            if (i == 3)
+                continue;
+            s = s + i;
+        }
+        return s;
+    })");
+    const auto& body = ir->function->body;
+
+    // The `continue` is the only unconditional jump.
+    ASSERT_EQ(countInstructions<IRJump>(*ir->function), 1u);
+    int continueLabel = -1;
+    for (const auto& inst : body) {
+        if (auto* j = std::get_if<IRJump>(&inst)) continueLabel = j->target;
+    }
+
+    size_t continueAt = body.size();
+    size_t postAt = body.size();
+    size_t bottomTestAt = body.size();
+    for (size_t i = 0; i < body.size(); ++i) {
+        if (auto* l = std::get_if<IRLabel>(&body[i]); l && l->id == continueLabel) {
+            continueAt = i;
+        }
+        if (auto* b = std::get_if<IRBinary>(&body[i]); b && i > continueAt && postAt == body.size()) {
+            postAt = i;
+        }
+        if (auto* j = std::get_if<IRJumpCC>(&body[i]); j && j->cond == IRCondCode::L) {
+            bottomTestAt = i;
+        }
+    }
+    EXPECT_LT(continueAt, postAt);
+    EXPECT_LT(postAt, bottomTestAt);
+    EXPECT_LT(bottomTestAt, body.size());
+}
+
+TEST(LoweringTests, ConditionsBranchOnTheFlagsOfTheirComparison) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 1;
+        int b = 2;
+        if (a < b && !(b == 3 || a > 4))
+            a = 5;
+        return a ? b / 2 : a;
+    })");
+    const auto& body = ir->function->body;
+
+    // No 0/1 values: each comparison is a cmp and a jump.
+    EXPECT_EQ(countInstructions<IRSetCC>(*ir->function), 0u);
+    EXPECT_EQ(countInstructions<IRCmp>(*ir->function), 4u);
+    std::vector<IRCondCode> conds;
+    for (const auto& inst : body) {
+        if (auto* j = std::get_if<IRJumpCC>(&inst)) conds.push_back(j->cond);
+    }
+    // a >= b and b == 3 or a > 4 skip the assignment; a == 0 picks the else value.
+    EXPECT_EQ(conds, (std::vector<IRCondCode>{IRCondCode::GE, IRCondCode::E, IRCondCode::G, IRCondCode::E}));
+}
+
+TEST(LoweringTests, LogicalValuesShortCircuitWithoutIntermediateFlags) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 1;
+        int b = 2;
+        return a < b || b < 0;
+    })");
+
+    // Both comparisons jump to the `mov $1` of the result directly.
+    EXPECT_EQ(countInstructions<IRSetCC>(*ir->function), 0u);
+    EXPECT_EQ(countInstructions<IRJumpCC>(*ir->function), 2u);
+}
+
+TEST(LoweringTests, CheapConditionalsBecomeSelects) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 1;
+        int b = 2;
+        int lo = a < b ? a : b;
+        int hi;
+        if (a > b) hi = a; else { hi = b; }
+        if (a < 0) a = -a;
+        int c = !(a == b) ? a * 2 + 1 : b;
+        return lo + hi + a + c;
+    })");
+
+    // min, max, abs and the ?: all pick their value with a cmov, no jumps.
+    EXPECT_EQ(countInstructions<IRJump>(*ir->function), 0u);
+    EXPECT_EQ(countInstructions<IRJumpCC>(*ir->function), 0u);
+    std::vector<IRCondCode> conds;
+    for (const auto& inst : ir->function->body) {
+        if (auto* c = std::get_if<IRCMov>(&inst)) conds.push_back(c->cond);
+    }
+    EXPECT_EQ(conds, (std::vector<IRCondCode>{IRCondCode::L, IRCondCode::G, IRCondCode::L, IRCondCode::NE}));
+}
+
+TEST(LoweringTests, ArmsThatMayTrapOrCostMoreStayBranches) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 1;
+        int b = 2;
+        int q = a ? b / a : 0;
+        int r = a < b ? a * b * a * b : b;
+        if (a < b) a = b; else b = a;
+        return q + r + a + b;
+    })");
+
+    EXPECT_EQ(countInstructions<IRCMov>(*ir->function), 0u);
+    EXPECT_EQ(countInstructions<IRJumpCC>(*ir->function), 3u);
+}
+
+TEST(LoweringTests, BooleansAreZeroedBeforeTheirComparisonAndSet) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 1;
+        int b = 2;
+        return a < b;
+    })");
+    const auto& body = ir->function->body;
+
+    // `mov $0` comes first so codegen can zero with xor before the flags are set.
+    size_t set = 0;
+    while (set < body.size() && !std::holds_alternative<IRSetCC>(body[set])) ++set;
+    ASSERT_GE(set, 2u);
+    ASSERT_LT(set, body.size());
+    auto* zero = std::get_if<IRMov>(&body[set - 2]);
+    ASSERT_NE(zero, nullptr);
+    EXPECT_EQ(zero->src, IROperand::imm(0));
+    EXPECT_EQ(zero->dst, std::get<IRSetCC>(body[set]).dst);
+    EXPECT_TRUE(std::holds_alternative<IRCmp>(body[set - 1]));
+    EXPECT_EQ(std::get<IRSetCC>(body[set]).cond, IRCondCode::L);
+}
+
+TEST(LoweringTests, NegationsAndZeroTestsFoldIntoTheCondition) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 1;
+        int b = 2;
+        int x = !(a < b);
+        int y = (a < b) == 0;
+        int z = !!a;
+        int w = (a == b) != 0;
+        return x + y + z + w;
+    })");
+
+    // One cmp and setcc per boolean, with the negation in the condition code.
+    EXPECT_EQ(countInstructions<IRCmp>(*ir->function), 4u);
+    std::vector<IRCondCode> conds;
+    for (const auto& inst : ir->function->body) {
+        if (auto* s = std::get_if<IRSetCC>(&inst)) conds.push_back(s->cond);
+    }
+    EXPECT_EQ(conds, (std::vector<IRCondCode>{IRCondCode::GE, IRCondCode::GE, IRCondCode::NE, IRCondCode::E}));
+}
@@ -111,3 +111,31 @@ TEST(ParserTests, ParsesBreakStatement) {
     auto* br = dynamic_cast<BreakStatement*>(program->function->body->items[0].get());
     ASSERT_NE(br, nullptr);
 }
+
+TEST(ParserTests, AttachesUnrollPragmaToFollowingLoop) {
+    const std::string source = R"(int main(void) {
+#pragma unroll 8
+        while (1) break;
+        #pragma unroll
+        do ; while (0);
+        return 0;
+    })";
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+
+    ASSERT_EQ(program->function->body->items.size(), 3u);
+    auto* whileStmt = dynamic_cast<WhileStatement*>(program->function->body->items[0].get());
+    ASSERT_NE(whileStmt, nullptr);
+    EXPECT_EQ(whileStmt->unroll, 8);
+    auto* doWhile = dynamic_cast<DoWhileStatement*>(program->function->body->items[1].get());
+    ASSERT_NE(doWhile, nullptr);
+    EXPECT_EQ(doWhile->unroll, -1);
+}
+
+TEST(ParserTests, RejectsUnrollPragmaBeforeNonLoop) {
+    const std::string source = "int main(void) {\n#pragma unroll 2\n return 0; }";
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    EXPECT_THROW(parser.parseProgram(), std::runtime_error);
+}
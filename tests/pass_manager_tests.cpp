@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "cfg.h"
+#include "loops.h"
+#include "optimizer.h"
+#include "pass_manager.h"
+#include "remarks.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+size_t countLoops(const IRFunction& fn) {
+    CFG cfg = CFG::build(fn);
+    return LoopForest::build(cfg, Dominators::compute(cfg)).loops.size();
+}
+
+IRFunction makeFunction() {
+    std::vector<IRInstruction> body;
+    body.push_back(IRMov(IROperand::imm(1), IROperand::reg(IRRegister::AX)));
+    body.push_back(IRRet());
+    return IRFunction("main", std::move(body), {}, 0);
+}
+
+// A function of `statements` statements over a handful of variables, mixing
+// branches, loops and arithmetic the way generated code does.
+std::string hugeFunction(int statements) {
+    std::string source = "int main(void) {\n    int a = 1;\n    int b = 2;\n    int c = 3;\n";
+    for (int i = 0; i < statements; ++i) {
+        std::string k = std::to_string(i % 7 + 1);
+        switch (i % 4) {
+            case 0: source += "    if (a < b) c = a + " + k + "; else c = b * " + k + ";\n"; break;
+            case 1: source += "    for (int i = 0; i < " + k + "; i = i + 1) a = a + (b + c) * i;\n"; break;
+            case 2: source += "    while (b > 1000) b = b / " + k + ";\n"; break;
+            default: source += "    b = (a + c) * " + k + " - b;\n"; break;
+        }
+    }
+    return source + "    return a + b + c;\n}\n";
+}
+
+double secondsToOptimize(const std::string& source, double budget) {
+    auto program = lowerProgram(source);
+    auto start = std::chrono::steady_clock::now();
+    Optimizer::optimize(*program, 2, LoopUnrolling::kDefaultFactor, nullptr, budget);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A pass that reports a change the first `changes` times it runs.
+Pass countingPass(const std::string& name, int& runs, int changes) {
+    return {name, [&runs, changes](IRFunction&, AnalysisManager&) { return ++runs <= changes; }};
+}
+}
+
+TEST(PassManagerTests, RejectsUnknownPassesAndMalformedPipelines) {
+    int runs = 0;
+    PassManager manager;
+    manager.add(countingPass("a", runs, 0));
+
+    EXPECT_THROW(manager.parse("a,b"), std::runtime_error);
+    EXPECT_THROW(manager.parse("a,"), std::runtime_error);
+    EXPECT_THROW(manager.parse("repeat(a"), std::runtime_error);
+    EXPECT_THROW(manager.parse("a)"), std::runtime_error);
+    EXPECT_NO_THROW(manager.parse("a,repeat(a,repeat(a))"));
+    EXPECT_NO_THROW(manager.parse(""));
+}
+
+TEST(PassManagerTests, RepeatsGroupsUntilNothingChanges) {
+    int aRuns = 0;
+    int bRuns = 0;
+    PassManager manager;
+    manager.add(countingPass("a", aRuns, 3));
+    manager.add(countingPass("b", bRuns, 0));
+    manager.parse("repeat(a,b),b");
+
+    IRFunction fn = makeFunction();
+    EXPECT_TRUE(manager.run(fn));
+    // Three changing rounds and a quiet one, then b once more.
+    EXPECT_EQ(aRuns, 4);
+    EXPECT_EQ(bRuns, 5);
+}
+
+TEST(PassManagerTests, StopsRepeatingAfterMaxRounds) {
+    int runs = 0;
+    PassManager manager;
+    manager.add(countingPass("a", runs, 100));
+    manager.parse("repeat(a)");
+
+    IRFunction fn = makeFunction();
+    EXPECT_TRUE(manager.run(fn));
+    EXPECT_EQ(runs, PassManager::kMaxRounds);
+}
+
+TEST(PassManagerTests, SkipsGroupsWhenNothingChangedSinceTheLastRun) {
+    int aRuns = 0;
+    int bRuns = 0;
+    PassManager manager;
+    manager.add(countingPass("a", aRuns, 1));
+    manager.add(countingPass("b", bRuns, 0));
+    manager.parse("repeat(a),b,repeat(a)");
+
+    IRFunction fn = makeFunction();
+    manager.run(fn);
+    EXPECT_EQ(aRuns, 2);
+
+    // A change in between makes the second group run again.
+    aRuns = 0;
+    int cRuns = 0;
+    manager.add(countingPass("c", cRuns, 1));
+    manager.parse("repeat(a),c,repeat(a)");
+    manager.run(fn);
+    EXPECT_EQ(aRuns, 3);
+}
+
+TEST(PassManagerTests, KeepsAnalysesUntilAPassChangesTheFunction) {
+    std::vector<size_t> blockEnds;
+    auto observe = [&](IRFunction&, AnalysisManager& analyses) {
+        blockEnds.push_back(analyses.cfg().blocks.back().end);
+        return false;
+    };
+    // Grows the function without telling anyone, so only a fresh CFG sees it.
+    auto grow = [](bool report) {
+        return [report](IRFunction& fn, AnalysisManager&) {
+            fn.body.insert(fn.body.begin(), IRMov(IROperand::imm(0), IROperand::reg(IRRegister::CX)));
+            return report;
+        };
+    };
+    PassManager manager;
+    manager.add({"observe", observe});
+    manager.add({"grow-quietly", grow(false)});
+    manager.add({"grow", grow(true)});
+    manager.add({"grow-in-place", grow(true), PreservedAnalyses::all()});
+    manager.parse("observe,grow-quietly,observe,grow,observe,grow-in-place,observe");
+
+    IRFunction fn = makeFunction();
+    manager.run(fn);
+    EXPECT_EQ(blockEnds, (std::vector<size_t>{2, 2, 4, 4}));
+}
+
+TEST(PassManagerTests, OnlyLevelTwoDuplicatesLoops) {
+    const char* source = R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 4; i = i + 1)
+            s = s + i * i;
+        return s;
+    })";
+    auto o1 = lowerProgram(source);
+    auto o2 = lowerProgram(source);
+
+    Optimizer::optimize(*o1, 1);
+    Optimizer::optimize(*o2, 2);
+
+    EXPECT_EQ(countLoops(*o1->function), 1u);
+    EXPECT_EQ(countLoops(*o2->function), 0u);
+}
+
+TEST(PassManagerTests, PassesOverrideThePreset) {
+    auto program = lowerProgram(R"(int main(void) {
+        int a = 2;
+        return a * 3;
+    })");
+
+    Optimizer::optimize(*program, "sccp,dead-code");
+
+    ASSERT_EQ(program->function->body.size(), 2u);
+    auto* mov = std::get_if<IRMov>(&program->function->body[0]);
+    ASSERT_NE(mov, nullptr);
+    EXPECT_EQ(mov->src, IROperand::imm(6));
+    EXPECT_THROW(Optimizer::optimize(*program, "sccp,inline"), std::runtime_error);
+}
+
+TEST(PassManagerTests, RunsTheFallbackOfAPassOverBudget) {
+    int expensiveRuns = 0;
+    int cheapRuns = 0;
+    PassManager manager;
+    manager.add({"expensive", [&](IRFunction&, AnalysisManager&) { return ++expensiveRuns, false; },
+                 PreservedAnalyses::none(), [](const IRFunction& fn, AnalysisManager&) {
+                     return 1000.0 * fn.body.size();
+                 }, "cheap"});
+    manager.add(countingPass("cheap", cheapRuns, 0));
+    manager.parse("expensive,expensive");
+    manager.setBudget(1000);
+
+    IRFunction fn = makeFunction();
+    OptimizationRemarks remarks;
+    manager.run(fn, &remarks);
+    EXPECT_EQ(expensiveRuns, 0);
+    EXPECT_EQ(cheapRuns, 2);
+    EXPECT_EQ(remarks.statistics().at({"expensive", "runs replaced over budget"}), 2);
+    // One remark per pass and function, however often it is replaced.
+    ASSERT_EQ(remarks.remarks().size(), 1u);
+    EXPECT_EQ(remarks.remarks()[0].name, "OverBudget");
+    EXPECT_NE(remarks.remarks()[0].reason.find("ran cheap instead"), std::string::npos);
+
+    manager.setBudget(0);
+    manager.run(fn);
+    EXPECT_EQ(expensiveRuns, 2);
+    EXPECT_EQ(cheapRuns, 2);
+}
+
+TEST(PassManagerTests, SkipsAPassOverBudgetWithoutFallback) {
+    int runs = 0;
+    PassManager manager;
+    manager.add({"expensive", [&](IRFunction&, AnalysisManager&) { return ++runs, false; },
+                 PreservedAnalyses::none(), [](const IRFunction&, AnalysisManager&) { return 2.0; }});
+    manager.add({"broken", [](IRFunction&, AnalysisManager&) { return false; },
+                 PreservedAnalyses::none(), {}, "missing"});
+    EXPECT_THROW(manager.parse("broken"), std::runtime_error);
+    manager.parse("expensive");
+
+    IRFunction fn = makeFunction();
+    OptimizationRemarks remarks;
+    manager.setBudget(1);
+    manager.run(fn, &remarks);
+    EXPECT_EQ(runs, 0);
+    EXPECT_EQ(remarks.statistics().at({"expensive", "runs skipped over budget"}), 1);
+    manager.setBudget(2);
+    manager.run(fn);
+    EXPECT_EQ(runs, 1);
+}
+
+TEST(PassManagerTests, ATinyBudgetStillAllocatesEveryPseudo) {
+    const char* source = R"(int main(void) {
+        int a = 7;
+        int s = 0;
+        for (int i = 0; i < 10; i = i + 1) {
+            int t = a;
+            if (i % 3 == 0) s = s + t * i;
+            else s = s - 1;
+        }
+        return s;
+    })";
+    auto program = lowerProgram(source);
+    OptimizationRemarks remarks;
+    Optimizer::optimize(*program, 2, LoopUnrolling::kDefaultFactor, &remarks, 1);
+
+    for (const char* pass : {"sccp", "value-numbering", "copy-propagation", "dead-code", "graph-coloring"}) {
+        bool reported = false;
+        for (const auto& remark : remarks.remarks()) reported |= remark.pass == pass && remark.name == "OverBudget";
+        EXPECT_TRUE(reported) << pass;
+    }
+    for (const auto& instruction : program->function->body) {
+        if (auto* mov = std::get_if<IRMov>(&instruction)) {
+            EXPECT_FALSE(mov->src.isPseudo() || mov->dst.isPseudo());
+        }
+    }
+}
+
+// Scaled down from the functions of millions of instructions the budget is
+// for (see bench/compile_time_bench.cpp): with a budget that the smaller
+// function already exceeds, eight times the code may take at most about
+// eight times as long.
+TEST(PassManagerTests, CompileTimeStaysLinearOverBudget) {
+    const double budget = 1e4;
+    // The best of a few runs, so that noise on the short one does not count.
+    double small = secondsToOptimize(hugeFunction(250), budget);
+    for (int run = 0; run < 2; ++run) small = std::min(small, secondsToOptimize(hugeFunction(250), budget));
+    double large = secondsToOptimize(hugeFunction(2000), budget);
+    EXPECT_LT(large, 16 * small);
+}
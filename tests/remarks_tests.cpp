@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "optimizer.h"
+#include "remarks.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+const OptimizationRemarks::Remark* findRemark(const OptimizationRemarks& remarks, const std::string& name) {
+    for (const auto& remark : remarks.remarks()) {
+        if (remark.name == name) return &remark;
+    }
+    return nullptr;
+}
+}
+
+TEST(RemarksTests, TokensCarryTheirSourceLine) {
+    auto tokens = Lexer::tokenize("int main(void) {\n  return\n\n 2;\n}\n");
+
+    ASSERT_GE(tokens.size(), 8u);
+    EXPECT_EQ(tokens[0].line, 1);
+    EXPECT_EQ(tokens[6].value, "return");
+    EXPECT_EQ(tokens[6].line, 2);
+    EXPECT_EQ(tokens[7].line, 4);
+}
+
+TEST(RemarksTests, CountsPerPassAndPrintsThemLikeLLVM) {
+    OptimizationRemarks remarks;
+    remarks.setPass("sccp");
+    remarks.count("constants folded", 2);
+    remarks.count("constants folded");
+    remarks.count("branches folded", 0);
+    remarks.setPass("licm");
+    remarks.count("instructions hoisted", 12);
+
+    std::ostringstream out;
+    remarks.printStatistics(out);
+
+    EXPECT_EQ(remarks.statistics().size(), 2u);
+    EXPECT_NE(out.str().find("... Statistics Collected ..."), std::string::npos);
+    EXPECT_NE(out.str().find(" 3 sccp - constants folded\n"), std::string::npos);
+    EXPECT_NE(out.str().find("12 licm - instructions hoisted\n"), std::string::npos);
+}
+
+TEST(RemarksTests, WritesOneYamlDocumentPerRemark) {
+    OptimizationRemarks remarks;
+    remarks.setFunction("main");
+    remarks.setPass("unroll");
+    remarks.applied("Unrolled", 3, "unrolled by 4");
+    remarks.missed("NotUnrolled", 0, "the loop isn't counted");
+
+    std::ostringstream out;
+    remarks.writeYaml(out);
+
+    EXPECT_EQ(out.str(),
+              "--- !Passed\n"
+              "Pass:            'unroll'\n"
+              "Name:            'Unrolled'\n"
+              "Function:        'main'\n"
+              "Line:            3\n"
+              "Reason:          'unrolled by 4'\n"
+              "...\n"
+              "--- !Missed\n"
+              "Pass:            'unroll'\n"
+              "Name:            'NotUnrolled'\n"
+              "Function:        'main'\n"
+              "Reason:          'the loop isn''t counted'\n"
+              "...\n");
+}
+
+TEST(RemarksTests, DisabledRemarksKeepNothing) {
+    OptimizationRemarks remarks(false);
+    remarks.setPass("sccp");
+    remarks.count("constants folded");
+    remarks.applied("BranchFolded", 1, "always taken");
+
+    EXPECT_TRUE(remarks.statistics().empty());
+    EXPECT_TRUE(remarks.remarks().empty());
+}
+
+TEST(RemarksTests, LoopRemarksPointAtTheLoopLine) {
+    auto program = lowerProgram(R"(int main(void) {
+        int x = 27;
+        int s = 0;
+        while (x != 1) {
+            if (x % 2) x = 3 * x + 1;
+            else x = x / 2;
+            s = s + 1;
+        }
+        int t = 0;
+        for (int i = 0; i < 100; i = i + 1)
+            t = t + i / s;
+        return t + s;
+    })");
+
+    OptimizationRemarks remarks;
+    Optimizer::optimize(*program, 2, LoopUnrolling::kDefaultFactor, &remarks);
+
+    const auto* missed = findRemark(remarks, "NotUnrolled");
+    ASSERT_NE(missed, nullptr);
+    EXPECT_EQ(missed->kind, OptimizationRemarks::Kind::Missed);
+    EXPECT_EQ(missed->function, "main");
+    EXPECT_EQ(missed->line, 4);
+
+    const auto* unrolled = findRemark(remarks, "Unrolled");
+    ASSERT_NE(unrolled, nullptr);
+    EXPECT_EQ(unrolled->pass, "unroll");
+    EXPECT_EQ(unrolled->line, 10);
+    EXPECT_EQ(remarks.statistics().at({"unroll", "loops unrolled"}), 1);
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "cfg.h"
+#include "copy_propagation.h"
+#include "loops.h"
+#include "optimizer.h"
+#include "scalar_evolution.h"
+#include "unreachable.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    auto ir = Lowering::toIR(*resolved);
+    while (CopyPropagation::run(*ir->function)) {
+    }
+    UnreachableCodeElimination::run(*ir->function);
+    return ir;
+}
+
+size_t countLoops(const IRFunction& fn) {
+    CFG cfg = CFG::build(fn);
+    return LoopForest::build(cfg, Dominators::compute(cfg)).loops.size();
+}
+
+// The immediate moved into AX right before the return, if the optimizer got that far.
+std::optional<int> returnedConstant(const IRFunction& fn) {
+    for (size_t i = 1; i < fn.body.size(); ++i) {
+        if (!std::get_if<IRRet>(&fn.body[i])) continue;
+        auto* m = std::get_if<IRMov>(&fn.body[i - 1]);
+        if (m && m->src.isImm()) return m->src.asImm();
+    }
+    return std::nullopt;
+}
+}
+
+TEST(ScalarEvolutionTests, ReplacesArithmeticSeriesByItsSum) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 100; i = i + 1)
+            s = s + i;
+        return s;
+    })");
+    ASSERT_EQ(countLoops(*ir->function), 1u);
+
+    EXPECT_TRUE(ScalarEvolution::run(*ir->function));
+
+    EXPECT_EQ(countLoops(*ir->function), 0u);
+}
+
+TEST(ScalarEvolutionTests, FoldsNestedRecurrencesToConstants) {
+    auto program = lowerProgram(R"(int main(void) {
+        int s = 0;
+        int t = 0;
+        int i = 10;
+        while (i <= 250) {
+            s = s + 3 * i + 1;
+            t = t + s;
+            i = i + 4;
+        }
+        return t - s;
+    })");
+    int64_t s = 0, t = 0;
+    for (int64_t i = 10; i <= 250; i += 4) {
+        s += 3 * i + 1;
+        t += s;
+    }
+
+    Optimizer::optimize(*program, 1);
+
+    EXPECT_EQ(countLoops(*program->function), 0u);
+    EXPECT_EQ(returnedConstant(*program->function), static_cast<int>(t - s));
+}
+
+TEST(ScalarEvolutionTests, WrapsAccumulatorsLikeTheLoop) {
+    auto program = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i < 100000; i = i + 1)
+            s = s + i;
+        return s;
+    })");
+    uint32_t s = 0;
+    for (uint32_t i = 0; i < 100000; ++i) s += i;
+
+    Optimizer::optimize(*program, 1);
+
+    EXPECT_EQ(returnedConstant(*program->function), static_cast<int>(s));
+}
+
+TEST(ScalarEvolutionTests, CountsDownwardAndInequalityLoops) {
+    auto program = lowerProgram(R"(int main(void) {
+        int s = 7;
+        int i = 60;
+        do {
+            s = s - i;
+            i = i - 5;
+        } while (i != 0);
+        return s;
+    })");
+
+    Optimizer::optimize(*program, 1);
+
+    EXPECT_EQ(returnedConstant(*program->function), 7 - (60 + 5) * 12 / 2);
+}
+
+TEST(ScalarEvolutionTests, KeepsLoopsWithoutComputableTripCount) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 0; i != 7; i = i + 2)
+            s = s + i;
+        return s;
+    })");
+
+    EXPECT_FALSE(ScalarEvolution::run(*ir->function));
+    EXPECT_EQ(countLoops(*ir->function), 1u);
+}
+
+TEST(ScalarEvolutionTests, KeepsLoopsWhoseCounterWouldOverflow) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int s = 0;
+        for (int i = 2147483600; i <= 2147483647; i = i + 1)
+            s = s + 1;
+        return s;
+    })");
+
+    EXPECT_FALSE(ScalarEvolution::run(*ir->function));
+}
+
+TEST(ScalarEvolutionTests, KeepsNonAffineRecurrences) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int p = 1;
+        for (int i = 0; i < 10; i = i + 1)
+            p = p * 2;
+        return p;
+    })");
+
+    EXPECT_FALSE(ScalarEvolution::run(*ir->function));
+}
+
+TEST(ScalarEvolutionTests, UsesSymbolicStartValues) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 0;
+        int s = 0;
+        while (a < 5)
+            a = a + 1;
+        s = a;
+        for (int i = 0; i < 10; i = i + 1)
+            s = s + a;
+        return s;
+    })");
+
+    // Both loops close; the second one's result depends on the first one's.
+    EXPECT_TRUE(ScalarEvolution::run(*ir->function));
+    EXPECT_EQ(countLoops(*ir->function), 0u);
+}
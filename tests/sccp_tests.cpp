@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "sccp.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+template <typename T>
+size_t countInstructions(const IRFunction& fn) {
+    size_t count = 0;
+    for (const auto& inst : fn.body) {
+        if (std::holds_alternative<T>(inst)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Value moved into %eax by the first ret of the function, or -1.
+int returnedConstant(const IRFunction& fn) {
+    for (size_t i = 1; i < fn.body.size(); ++i) {
+        if (std::get_if<IRRet>(&fn.body[i]) == nullptr) {
+            continue;
+        }
+        auto* mov = std::get_if<IRMov>(&fn.body[i - 1]);
+        if (mov == nullptr) return -1;
+        return mov->src.isImm() ? mov->src.asImm() : -1;
+    }
+    return -1;
+}
+}
+
+TEST(SCCPTests, FoldsStraightLineProgramToConstantReturn) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 5;
+        int b = 3;
+        int c;
+        c = (a * b) + (a - b);
+        if (a < b) {
+            c = c + 10;
+        } else {
+            c = c - 2;
+        }
+        int d = (c > 10) ? (c + 1) : (c - 1);
+        if (d != 0)
+            return d;
+        return 0;
+    })");
+
+    EXPECT_TRUE(SCCP::run(*ir->function));
+
+    const auto& fn = *ir->function;
+    EXPECT_EQ(returnedConstant(fn), 16);
+    EXPECT_EQ(countInstructions<IRCmp>(fn), 0u);
+    EXPECT_EQ(countInstructions<IRJumpCC>(fn), 0u);
+    EXPECT_EQ(countInstructions<IRJump>(fn), 0u);
+    EXPECT_EQ(countInstructions<IRBinary>(fn), 0u);
+    EXPECT_EQ(countInstructions<IRRet>(fn), 1u);
+}
+
+TEST(SCCPTests, KeepsLoopCarriedValuesButPrunesConstantBranches) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int i = 0;
+        int s = 0;
+        while (i < 10) {
+            if (1) s = s + i; else s = s - 100;
+            i = i + 1;
+        }
+        return s;
+    })");
+
+    SCCP::run(*ir->function);
+
+    const auto& fn = *ir->function;
+    // The loop test survives, the constant if does not.
+    EXPECT_EQ(countInstructions<IRJumpCC>(fn), 1u);
+    for (const auto& inst : fn.body) {
+        if (auto* b = std::get_if<IRBinary>(&inst)) {
+            EXPECT_NE(b->op, IRBinaryOperator::Sub);
+        }
+    }
+}
+
+TEST(SCCPTests, FoldsDivisionAndRemainder) {
+    auto ir = lowerProgram("int main(void) { return 7 / 2 + 7 % 2 + (-7) / 2; }");
+
+    SCCP::run(*ir->function);
+
+    EXPECT_EQ(returnedConstant(*ir->function), 1);
+    EXPECT_EQ(countInstructions<IRIdiv>(*ir->function), 0u);
+}
+
+TEST(SCCPTests, DoesNotFoldTrappingDivision) {
+    auto ir = lowerProgram("int main(void) { return 1 / 0; }");
+
+    SCCP::run(*ir->function);
+
+    EXPECT_EQ(countInstructions<IRIdiv>(*ir->function), 1u);
+}
+
+TEST(SCCPTests, FoldsSelectsOnKnownConditions) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 3;
+        int b = 5;
+        int lo = a < b ? a : b;
+        int hi = a > b ? a : b;
+        return lo * 10 + hi;
+    })");
+    ASSERT_EQ(countInstructions<IRCMov>(*ir->function), 2u);
+
+    SCCP::run(*ir->function);
+
+    EXPECT_EQ(returnedConstant(*ir->function), 35);
+    EXPECT_EQ(countInstructions<IRCMov>(*ir->function), 0u);
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "unreachable.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+template <typename T>
+size_t countInstructions(const IRFunction& fn) {
+    size_t count = 0;
+    for (const auto& inst : fn.body) {
+        if (std::holds_alternative<T>(inst)) {
+            ++count;
+        }
+    }
+    return count;
+}
+}
+
+TEST(UnreachableTests, RemovesCodeAfterNestedReturn) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 3;
+        if (a) {
+            return 1;
+            a = a * 5;
+        } else {
+            return 2;
+            a = a * 7;
+        }
+        return a * 9;
+    })");
+
+    EXPECT_TRUE(UnreachableCodeElimination::run(*ir->function));
+
+    EXPECT_EQ(countInstructions<IRBinary>(*ir->function), 0u);
+    EXPECT_EQ(countInstructions<IRRet>(*ir->function), 2u);
+}
+
+TEST(UnreachableTests, RemovesCodeAfterBreakAndContinue) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int sum = 0;
+        for (int i = 0; i < 10; i = i + 1) {
+            if (i > 5) {
+                break;
+                sum = sum * 3;
+            }
+            continue;
+            sum = sum - 1;
+        }
+        return sum;
+    })");
+
+    UnreachableCodeElimination::run(*ir->function);
+
+    for (const auto& inst : ir->function->body) {
+        auto* b = std::get_if<IRBinary>(&inst);
+        if (b != nullptr) {
+            EXPECT_EQ(b->op, IRBinaryOperator::Add);
+        }
+    }
+}
+
+TEST(UnreachableTests, DropsJumpsToNextAndUnusedLabels) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 1;
+        if (a)
+            a = 2;
+        else
+            a = 3;
+        return a;
+    })");
+
+    UnreachableCodeElimination::run(*ir->function);
+
+    const auto& body = ir->function->body;
+    for (size_t i = 0; i < body.size(); ++i) {
+        if (auto* l = std::get_if<IRLabel>(&body[i])) {
+            bool referenced = false;
+            for (const auto& inst : body) {
+                auto* j = std::get_if<IRJump>(&inst);
+                auto* jcc = std::get_if<IRJumpCC>(&inst);
+                referenced |= (j && j->target == l->id) || (jcc && jcc->target == l->id);
+            }
+            EXPECT_TRUE(referenced) << l->id;
+        }
+        if (i + 1 < body.size()) {
+            auto* j = std::get_if<IRJump>(&body[i]);
+            auto* l = std::get_if<IRLabel>(&body[i + 1]);
+            EXPECT_FALSE(j && l && j->target == l->id);
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "lowering.h"
+#include "value_numbering.h"
+
+namespace {
+std::unique_ptr<IRProgram> lowerProgram(const std::string& source) {
+    auto tokens = Lexer::tokenize(source);
+    Parser parser(tokens);
+    auto program = parser.parseProgram();
+    auto resolved = Resolver::resolve(*program);
+    return Lowering::toIR(*resolved);
+}
+
+size_t countBinary(const IRFunction& fn, IRBinaryOperator op) {
+    size_t count = 0;
+    for (const auto& inst : fn.body) {
+        auto* b = std::get_if<IRBinary>(&inst);
+        if (b != nullptr && b->op == op) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+template <typename T>
+size_t countInstructions(const IRFunction& fn) {
+    size_t count = 0;
+    for (const auto& inst : fn.body) {
+        if (std::holds_alternative<T>(inst)) {
+            ++count;
+        }
+    }
+    return count;
+}
+}
+
+TEST(ValueNumberingTests, ReusesRepeatedProduct) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 6;
+        int b = 7;
+        return (a * b) + (a * b);
+    })");
+
+    EXPECT_TRUE(ValueNumbering::run(*ir->function));
+
+    EXPECT_EQ(countBinary(*ir->function, IRBinaryOperator::Mul), 1u);
+    EXPECT_EQ(countBinary(*ir->function, IRBinaryOperator::Add), 1u);
+}
+
+TEST(ValueNumberingTests, MatchesCommutedOperands) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 6;
+        int b = 7;
+        int x = a * b + (b + a);
+        int y = b * a + (a + b);
+        return x - y;
+    })");
+
+    ValueNumbering::run(*ir->function);
+
+    EXPECT_EQ(countBinary(*ir->function, IRBinaryOperator::Mul), 1u);
+    // a + b, x = a*b + (b+a); y is entirely redundant.
+    EXPECT_EQ(countBinary(*ir->function, IRBinaryOperator::Add), 2u);
+    EXPECT_EQ(countBinary(*ir->function, IRBinaryOperator::Sub), 1u);
+}
+
+TEST(ValueNumberingTests, MatchesSwappedComparisons) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 6;
+        int b = 7;
+        int x = a < b;
+        int y = b > a;
+        return x + y;
+    })");
+
+    ValueNumbering::run(*ir->function);
+
+    EXPECT_EQ(countInstructions<IRSetCC>(*ir->function), 1u);
+}
+
+TEST(ValueNumberingTests, KeepsComputationAfterOperandChanges) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 6;
+        int c = a + 1;
+        a = a * 3;
+        int d = a + 1;
+        return c - d;
+    })");
+
+    EXPECT_FALSE(ValueNumbering::run(*ir->function));
+
+    EXPECT_EQ(countBinary(*ir->function, IRBinaryOperator::Add), 2u);
+}
+
+TEST(ValueNumberingTests, ReusesValuesFromDominatingBlockOnlyAlongSinglePredecessorEdges) {
+    auto ir = lowerProgram(R"(int main(void) {
+        int a = 6;
+        int c = a - 1;
+        if (c > 3) {
+            c = a - 1;
+        } else {
+            a = a + 2;
+        }
+        return c + (a - 1);
+    })");
+
+    ValueNumbering::run(*ir->function);
+
+    // The then-arm reuses `a - 1`; after the join `a` may have changed.
+    EXPECT_EQ(countBinary(*ir->function, IRBinaryOperator::Sub), 2u);
+}
@@ -0,0 +1,64 @@
+#include "unreachable.h"
+
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "ir_utils.h"
+
+namespace {
+    static bool removeUnreachableBlocks(IRFunction& fn, AnalysisManager& analyses) {
+        const CFG& cfg = analyses.cfg();
+        auto reachable = cfg.reachable();
+        bool changed = false;
+        for (const auto& block : cfg.blocks) {
+            if (reachable[block.id]) continue;
+            for (size_t i = block.begin; i < block.end; ++i) {
+                fn.body[i] = IRNop{};
+            }
+            changed = true;
+        }
+        eraseNops(fn);
+        return changed;
+    }
+
+    static bool removeUnusedLabels(IRFunction& fn) {
+        std::vector<bool> targets(fn.labelCount, false);
+        for (const auto& inst : fn.body) {
+            if (auto target = jumpTarget(inst)) {
+                targets[*target] = true;
+            }
+        }
+        bool changed = false;
+        for (auto& inst : fn.body) {
+            auto* l = std::get_if<IRLabel>(&inst);
+            if (l && !targets[l->id]) {
+                inst = IRNop{};
+                changed = true;
+            }
+        }
+        eraseNops(fn);
+        return changed;
+    }
+}
+
+bool UnreachableCodeElimination::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool UnreachableCodeElimination::run(IRFunction& fn, AnalysisManager& analyses) {
+    bool changed = false;
+    // Each cleanup can enable the others: dropping a block can leave a jump to
+    // the next label, and dropping that jump can leave the label unused.
+    while (true) {
+        bool round = false;
+        round |= removeUnreachableBlocks(fn, analyses);
+        round |= removeJumpsToNext(fn);
+        round |= removeUnusedLabels(fn);
+        if (!round) {
+            return changed;
+        }
+        analyses.invalidate();
+        changed = true;
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef COMPILER_UNREACHABLE_H
+#define COMPILER_UNREACHABLE_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class UnreachableCodeElimination {
+public:
+    // Deletes basic blocks that cannot be reached from the entry (code after
+    // return, break or continue at any nesting depth), jumps to the
+    // instruction that follows them, and labels no jump refers to.
+    // Returns true if the function changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_UNREACHABLE_H
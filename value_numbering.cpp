@@ -0,0 +1,343 @@
+#include "value_numbering.h"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "analysis_manager.h"
+#include "cfg.h"
+#include "ir_utils.h"
+#include "liveness.h"
+
+namespace {
+    // Expression kinds in a value-number key.
+    enum class ExprKind {
+        Neg,
+        Not,
+        Add,
+        Sub,
+        Mul,
+        Cdq,
+        Quotient,
+        Remainder,
+        SetCC // + condition code
+    };
+
+    using ExprKey = std::array<int, 4>;
+
+    static ExprKey key(ExprKind kind, int a, int b = -1, int c = -1) {
+        return {static_cast<int>(kind), a, b, c};
+    }
+
+    static ExprKey setccKey(IRCondCode cond, int dst, int src) {
+        // cmp is commutative up to swapping the condition.
+        if (dst > src) {
+            std::swap(dst, src);
+            cond = swapCondition(cond);
+        }
+        return {static_cast<int>(ExprKind::SetCC) + static_cast<int>(cond), dst, src, -1};
+    }
+
+    // Values known along the current path of an extended basic block.
+    struct State {
+        std::vector<int> location;                       // location -> value number, -1 unknown
+        std::map<ExprKey, int> exprs;                    // expression -> value number
+        std::unordered_map<int, std::vector<int>> holders; // value number -> locations assigned it
+        int flagsDst = -1;                               // operands of the last cmp
+        int flagsSrc = -1;
+    };
+
+    class ValueNumberer {
+    public:
+        // Without liveness, a division's results count as live unless
+        // overwritten before the end of its block.
+        ValueNumberer(IRFunction& fn, const CFG& cfg, const LocationIndex& locations, const Liveness* liveness)
+            : fn(fn), cfg(cfg), locations(locations) {
+            for (const auto& block : cfg.blocks) {
+                if (liveness == nullptr) {
+                    for (size_t i = block.begin; i < block.end; ++i) {
+                        if (std::get_if<IRIdiv>(&fn.body[i])) {
+                            divisionResultsLive[i] = {readBeforeWrite(block, i, IRRegister::AX),
+                                                      readBeforeWrite(block, i, IRRegister::DX)};
+                        }
+                    }
+                    continue;
+                }
+                liveness->forEachInstructionBackward(block.id, [&](size_t i, const BitVector& live) {
+                    if (std::get_if<IRIdiv>(&fn.body[i])) {
+                        divisionResultsLive[i] = {live.test(locations.reg(IRRegister::AX)),
+                                                  live.test(locations.reg(IRRegister::DX))};
+                    }
+                });
+            }
+        }
+
+        // Numbers each reachable block on its own, reusing one state and
+        // forgetting only what the block assigned.
+        void runLocal() {
+            auto reachable = cfg.reachable();
+            State state{std::vector<int>(locations.size(), -1), {}, {}, -1, -1};
+            for (const auto& block : cfg.blocks) {
+                if (!reachable[block.id]) continue;
+                for (size_t i = block.begin; i < block.end; ++i) {
+                    visit(block, i, state);
+                }
+                for (const auto& [value, holders] : state.holders) {
+                    for (int loc : holders) state.location[loc] = -1;
+                }
+                state.holders.clear();
+                state.exprs.clear();
+                state.flagsDst = state.flagsSrc = -1;
+            }
+        }
+
+        void run() {
+            auto reachable = cfg.reachable();
+            std::vector<std::pair<int, State>> worklist;
+            for (const auto& block : cfg.blocks) {
+                if (reachable[block.id] && (block.id == 0 || block.preds.size() != 1)) {
+                    worklist.emplace_back(block.id, State{std::vector<int>(locations.size(), -1), {}, {}, -1, -1});
+                }
+            }
+            while (!worklist.empty()) {
+                auto [id, state] = std::move(worklist.back());
+                worklist.pop_back();
+                const auto& block = cfg.blocks[id];
+                for (size_t i = block.begin; i < block.end; ++i) {
+                    visit(block, i, state);
+                }
+                // Flags never live across an edge.
+                state.flagsDst = state.flagsSrc = -1;
+                for (int succ : block.succs) {
+                    if (succ != 0 && cfg.blocks[succ].preds.size() == 1) {
+                        worklist.emplace_back(succ, state);
+                    }
+                }
+            }
+        }
+
+        // Instructions found to recompute a value already available.
+        size_t redundant() const { return replacements.size(); }
+
+        bool apply() {
+            if (replacements.empty()) return false;
+            std::vector<IRInstruction> body;
+            body.reserve(fn.body.size());
+            for (size_t i = 0; i < fn.body.size(); ++i) {
+                auto it = replacements.find(i);
+                if (it == replacements.end()) {
+                    body.push_back(std::move(fn.body[i]));
+                    continue;
+                }
+                for (auto& inst : it->second) body.push_back(std::move(inst));
+            }
+            fn.body = std::move(body);
+            return true;
+        }
+
+    private:
+        IRFunction& fn;
+        const CFG& cfg;
+        const LocationIndex& locations;
+        int nextValue = 0;
+        std::unordered_map<int, int> constantValues; // constant -> value number
+        std::unordered_map<int, int> valueConstants; // value number -> constant
+        std::unordered_map<size_t, std::pair<bool, bool>> divisionResultsLive;
+        std::unordered_map<size_t, std::vector<IRInstruction>> replacements;
+
+        int fresh() { return nextValue++; }
+
+        bool readBeforeWrite(const BasicBlock& block, size_t index, IRRegister reg) const {
+            IROperand target = IROperand::reg(reg);
+            for (size_t i = index + 1; i < block.end; ++i) {
+                bool read = false;
+                bool written = false;
+                forEachOperand(fn.body[i], [&](const IROperand& op, OperandRole role) {
+                    if (op != target) return;
+                    if (role != OperandRole::Write) read = true;
+                    else written = true;
+                });
+                for (IRRegister r : implicitReads(fn.body[i])) read = read || r == reg;
+                for (IRRegister r : implicitWrites(fn.body[i])) written = written || r == reg;
+                if (read) return true;
+                if (written) return false;
+            }
+            return true;
+        }
+
+        int valueOf(const IROperand& op, State& s) {
+            if (op.isImm()) {
+                auto [it, inserted] = constantValues.emplace(op.asImm(), nextValue);
+                if (inserted) valueConstants[fresh()] = op.asImm();
+                return it->second;
+            }
+            int loc = locations.find(op);
+            if (loc < 0) return fresh();
+            if (s.location[loc] < 0) assign(s, loc, fresh());
+            return s.location[loc];
+        }
+
+        void assign(State& s, int loc, int value) {
+            s.location[loc] = value;
+            s.holders[value].push_back(loc);
+        }
+
+        void assign(State& s, const IROperand& op, int value) {
+            int loc = locations.find(op);
+            if (loc >= 0) assign(s, loc, value);
+        }
+
+        // An immediate or a pseudo other than `exclude` currently holding the value.
+        std::optional<IROperand> holderOf(const State& s, int value, int exclude) const {
+            auto c = valueConstants.find(value);
+            if (c != valueConstants.end()) {
+                return IROperand::imm(c->second);
+            }
+            auto it = s.holders.find(value);
+            if (it == s.holders.end()) return std::nullopt;
+            for (int loc : it->second) {
+                if (loc != exclude && !locations.isRegister(loc) && s.location[loc] == value) {
+                    return IROperand::pseudo(locations.pseudoAt(loc));
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Replacing a flag-writing instruction with a move is only safe if
+        // nothing reads its flags before they are written again.
+        bool flagsUnused(const BasicBlock& block, size_t index) const {
+            for (size_t i = index + 1; i < block.end; ++i) {
+                if (readsFlags(fn.body[i])) return false;
+                if (writesFlags(fn.body[i])) return true;
+            }
+            return true;
+        }
+
+        // Looks up `k`; on a hit with an available holder, replaces the
+        // instruction by `mov holder, dst`. Returns the value number of dst.
+        int computeInto(const BasicBlock& block, size_t i, State& s, const ExprKey& k, const IROperand& dst) {
+            auto it = s.exprs.find(k);
+            if (it != s.exprs.end()) {
+                auto holder = holderOf(s, it->second, locations.find(dst));
+                if (holder && flagsUnused(block, i)) {
+                    std::vector<IRInstruction> mov;
+                    mov.push_back(IRMov(*holder, dst));
+                    replacements[i] = std::move(mov);
+                }
+                return it->second;
+            }
+            int value = fresh();
+            s.exprs.emplace(k, value);
+            return value;
+        }
+
+        void visit(const BasicBlock& block, size_t i, State& s) {
+            auto& inst = fn.body[i];
+            if (auto* m = std::get_if<IRMov>(&inst)) {
+                assign(s, m->dst, valueOf(m->src, s));
+            } else if (auto* u = std::get_if<IRUnary>(&inst)) {
+                ExprKind kind = u->op == IRUnaryOperator::Neg ? ExprKind::Neg : ExprKind::Not;
+                int a = valueOf(u->operand, s);
+                assign(s, u->operand, computeInto(block, i, s, key(kind, a), u->operand));
+            } else if (auto* b = std::get_if<IRBinary>(&inst)) {
+                int lhs = valueOf(b->dst, s);
+                int rhs = valueOf(b->src, s);
+                ExprKind kind = ExprKind::Add;
+                switch (b->op) {
+                    case IRBinaryOperator::Add: kind = ExprKind::Add; break;
+                    case IRBinaryOperator::Sub: kind = ExprKind::Sub; break;
+                    case IRBinaryOperator::Mul: kind = ExprKind::Mul; break;
+                }
+                if (b->op != IRBinaryOperator::Sub && lhs > rhs) std::swap(lhs, rhs);
+                assign(s, b->dst, computeInto(block, i, s, key(kind, lhs, rhs), b->dst));
+            } else if (auto* c = std::get_if<IRCmp>(&inst)) {
+                s.flagsDst = valueOf(c->dst, s);
+                s.flagsSrc = valueOf(c->src, s);
+                return;
+            } else if (auto* set = std::get_if<IRSetCC>(&inst)) {
+                // setcc only writes the low byte; the result is 0/1 only after `mov $0, dst`.
+                int before = valueOf(set->dst, s);
+                auto zero = valueConstants.find(before);
+                if (s.flagsDst < 0 || zero == valueConstants.end() || zero->second != 0) {
+                    assign(s, set->dst, fresh());
+                } else {
+                    auto k = setccKey(set->cond, s.flagsDst, s.flagsSrc);
+                    assign(s, set->dst, computeInto(block, i, s, k, set->dst));
+                }
+            } else if (std::get_if<IRCdq>(&inst)) {
+                int ax = valueOf(IROperand::reg(IRRegister::AX), s);
+                assign(s, locations.reg(IRRegister::DX), s.exprs.try_emplace(key(ExprKind::Cdq, ax), fresh()).first->second);
+            } else if (auto* d = std::get_if<IRIdiv>(&inst)) {
+                visitDivision(block, i, *d, s);
+            } else {
+                forEachOperand(inst, [&](const IROperand& op, OperandRole role) {
+                    if (role != OperandRole::Read) assign(s, op, fresh());
+                });
+                for (IRRegister r : implicitWrites(inst)) assign(s, locations.reg(r), fresh());
+            }
+            if (writesFlags(inst)) {
+                s.flagsDst = s.flagsSrc = -1;
+            }
+        }
+
+        void visitDivision(const BasicBlock& block, size_t i, const IRIdiv& d, State& s) {
+            int ax = valueOf(IROperand::reg(IRRegister::AX), s);
+            int dx = valueOf(IROperand::reg(IRRegister::DX), s);
+            int divisor = valueOf(d.divisor, s);
+            auto quotientKey = key(ExprKind::Quotient, ax, dx, divisor);
+            auto remainderKey = key(ExprKind::Remainder, ax, dx, divisor);
+            auto q = s.exprs.find(quotientKey);
+            auto r = s.exprs.find(remainderKey);
+            if (q != s.exprs.end() && r != s.exprs.end() && flagsUnused(block, i)) {
+                // The same division already ran (and did not trap); reuse its results.
+                auto [axLive, dxLive] = divisionResultsLive[i];
+                auto quotient = axLive ? holderOf(s, q->second, -1) : std::nullopt;
+                auto remainder = dxLive ? holderOf(s, r->second, -1) : std::nullopt;
+                if ((!axLive || quotient) && (!dxLive || remainder)) {
+                    std::vector<IRInstruction> movs;
+                    if (quotient) {
+                        movs.push_back(IRMov(*quotient, IROperand::reg(IRRegister::AX)));
+                    }
+                    if (remainder) {
+                        movs.push_back(IRMov(*remainder, IROperand::reg(IRRegister::DX)));
+                    }
+                    replacements[i] = std::move(movs);
+                }
+            }
+            int quotient = q != s.exprs.end() ? q->second : s.exprs.emplace(quotientKey, fresh()).first->second;
+            int remainder = r != s.exprs.end() ? r->second : s.exprs.emplace(remainderKey, fresh()).first->second;
+            assign(s, locations.reg(IRRegister::AX), quotient);
+            assign(s, locations.reg(IRRegister::DX), remainder);
+        }
+    };
+}
+
+bool ValueNumbering::run(IRFunction& fn) {
+    AnalysisManager analyses(fn);
+    return run(fn, analyses);
+}
+
+bool ValueNumbering::run(IRFunction& fn, AnalysisManager& analyses) {
+    const CFG& cfg = analyses.cfg();
+    if (cfg.blocks.empty()) {
+        return false;
+    }
+    ValueNumberer numberer(fn, cfg, analyses.locations(), &analyses.liveness());
+    numberer.run();
+    analyses.remarks().count("redundant computations eliminated", static_cast<long>(numberer.redundant()));
+    return numberer.apply();
+}
+
+bool ValueNumbering::runLocal(IRFunction& fn, AnalysisManager& analyses) {
+    const CFG& cfg = analyses.cfg();
+    if (cfg.blocks.empty()) {
+        return false;
+    }
+    ValueNumberer numberer(fn, cfg, analyses.locations(), nullptr);
+    numberer.runLocal();
+    analyses.remarks().count("redundant computations eliminated", static_cast<long>(numberer.redundant()));
+    return numberer.apply();
+}
@@ -0,0 +1,25 @@
+#ifndef COMPILER_VALUE_NUMBERING_H
+#define COMPILER_VALUE_NUMBERING_H
+
+#include "ir.h"
+
+class AnalysisManager;
+
+class ValueNumbering {
+public:
+    // Hash-based value numbering over extended basic blocks (trees of blocks
+    // with a single predecessor, walked from the dominating head). A
+    // computation whose value is already held by a pseudo is replaced with a
+    // move from it. Add, Mul and comparisons are matched up to operand order.
+    // Returns true if the function changed.
+    static bool run(IRFunction& fn);
+    static bool run(IRFunction& fn, AnalysisManager& analyses);
+
+    // The same within each basic block only, and without liveness. Copying
+    // the known values from block to block costs time in proportion to
+    // blocks times locations; this variant stays linear in the size of the
+    // function.
+    static bool runLocal(IRFunction& fn, AnalysisManager& analyses);
+};
+
+#endif // COMPILER_VALUE_NUMBERING_H